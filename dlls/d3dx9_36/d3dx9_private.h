@@ -182,6 +182,8 @@ struct d3dx_preshader
     struct d3dx_pres_ins *ins;
 
     struct d3dx_const_tab inputs;
+    /* The registers hold the results for the current inputs. */
+    BOOL results_valid;
 };
 
 struct d3dx_param_eval
@@ -25,6 +25,17 @@
 #include "config.h"
 #include "wine/port.h"
 
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef __SSE__
+#  define SSE_FUNC
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define SSE_FUNC __attribute__((target("sse")))  /* selected at run time */
+# endif
+# ifdef SSE_FUNC
+#  include <xmmintrin.h>
+# endif
+#endif
+
 #include "d3dx9_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
@@ -39,6 +50,79 @@ struct ID3DXMatrixStackImpl
   D3DXMATRIX *stack;
 };
 
+#ifdef SSE_FUNC
+
+static BOOL sse_supported(void)
+{
+#ifdef __SSE__
+    return TRUE;
+#else
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE);
+    return supported;
+#endif
+}
+
+/* The SSE versions keep the order of the additions of the C code, one matrix
+ * row per vector. */
+static SSE_FUNC void multiply_matrix_sse(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2)
+{
+    const __m128 r0 = _mm_loadu_ps(m2->u.m[0]), r1 = _mm_loadu_ps(m2->u.m[1]);
+    const __m128 r2 = _mm_loadu_ps(m2->u.m[2]), r3 = _mm_loadu_ps(m2->u.m[3]);
+    __m128 row[4];
+    unsigned int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        row[i] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m1->u.m[i][0]), r0),
+                _mm_mul_ps(_mm_set1_ps(m1->u.m[i][1]), r1)),
+                _mm_mul_ps(_mm_set1_ps(m1->u.m[i][2]), r2)),
+                _mm_mul_ps(_mm_set1_ps(m1->u.m[i][3]), r3));
+    }
+    for (i = 0; i < 4; ++i)
+        _mm_storeu_ps(out->u.m[i], row[i]);
+}
+
+static SSE_FUNC void vec3_transform_array_sse(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR3 *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements)
+{
+    const __m128 r0 = _mm_loadu_ps(matrix->u.m[0]), r1 = _mm_loadu_ps(matrix->u.m[1]);
+    const __m128 r2 = _mm_loadu_ps(matrix->u.m[2]), r3 = _mm_loadu_ps(matrix->u.m[3]);
+    UINT i;
+
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 *v = (const D3DXVECTOR3 *)((const char *)in + instride * i);
+        __m128 o;
+
+        o = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, _mm_set1_ps(v->x)),
+                _mm_mul_ps(r1, _mm_set1_ps(v->y))), _mm_mul_ps(r2, _mm_set1_ps(v->z))), r3);
+        _mm_storeu_ps(&((D3DXVECTOR4 *)((char *)out + outstride * i))->x, o);
+    }
+}
+
+static SSE_FUNC void vec4_transform_array_sse(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR4 *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements)
+{
+    const __m128 r0 = _mm_loadu_ps(matrix->u.m[0]), r1 = _mm_loadu_ps(matrix->u.m[1]);
+    const __m128 r2 = _mm_loadu_ps(matrix->u.m[2]), r3 = _mm_loadu_ps(matrix->u.m[3]);
+    UINT i;
+
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR4 *v = (const D3DXVECTOR4 *)((const char *)in + instride * i);
+        __m128 o;
+
+        o = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, _mm_set1_ps(v->x)),
+                _mm_mul_ps(r1, _mm_set1_ps(v->y))), _mm_mul_ps(r2, _mm_set1_ps(v->z))),
+                _mm_mul_ps(r3, _mm_set1_ps(v->w)));
+        _mm_storeu_ps(&((D3DXVECTOR4 *)((char *)out + outstride * i))->x, o);
+    }
+}
+
+#endif  /* SSE_FUNC */
+
 static const unsigned int INITIAL_STACK_SIZE = 32;
 
 /*_________________D3DXColor____________________*/
@@ -253,67 +337,52 @@ FLOAT WINAPI D3DXMatrixDeterminant(const D3DXMATRIX *pm)
 
 D3DXMATRIX* WINAPI D3DXMatrixInverse(D3DXMATRIX *pout, FLOAT *pdeterminant, const D3DXMATRIX *pm)
 {
-    FLOAT det, t[3], v[16];
+    FLOAT det, s[6], c[6], v[16];
     UINT i, j;
 
     TRACE("pout %p, pdeterminant %p, pm %p\n", pout, pdeterminant, pm);
 
-    t[0] = pm->u.m[2][2] * pm->u.m[3][3] - pm->u.m[2][3] * pm->u.m[3][2];
-    t[1] = pm->u.m[1][2] * pm->u.m[3][3] - pm->u.m[1][3] * pm->u.m[3][2];
-    t[2] = pm->u.m[1][2] * pm->u.m[2][3] - pm->u.m[1][3] * pm->u.m[2][2];
-    v[0] = pm->u.m[1][1] * t[0] - pm->u.m[2][1] * t[1] + pm->u.m[3][1] * t[2];
-    v[4] = -pm->u.m[1][0] * t[0] + pm->u.m[2][0] * t[1] - pm->u.m[3][0] * t[2];
-
-    t[0] = pm->u.m[1][0] * pm->u.m[2][1] - pm->u.m[2][0] * pm->u.m[1][1];
-    t[1] = pm->u.m[1][0] * pm->u.m[3][1] - pm->u.m[3][0] * pm->u.m[1][1];
-    t[2] = pm->u.m[2][0] * pm->u.m[3][1] - pm->u.m[3][0] * pm->u.m[2][1];
-    v[8] = pm->u.m[3][3] * t[0] - pm->u.m[2][3] * t[1] + pm->u.m[1][3] * t[2];
-    v[12] = -pm->u.m[3][2] * t[0] + pm->u.m[2][2] * t[1] - pm->u.m[1][2] * t[2];
-
-    det = pm->u.m[0][0] * v[0] + pm->u.m[0][1] * v[4] +
-        pm->u.m[0][2] * v[8] + pm->u.m[0][3] * v[12];
+    /* 2x2 minors of the upper and lower row pairs, each used by several
+     * cofactors. */
+    s[0] = pm->u.m[0][0] * pm->u.m[1][1] - pm->u.m[1][0] * pm->u.m[0][1];
+    s[1] = pm->u.m[0][0] * pm->u.m[1][2] - pm->u.m[1][0] * pm->u.m[0][2];
+    s[2] = pm->u.m[0][0] * pm->u.m[1][3] - pm->u.m[1][0] * pm->u.m[0][3];
+    s[3] = pm->u.m[0][1] * pm->u.m[1][2] - pm->u.m[1][1] * pm->u.m[0][2];
+    s[4] = pm->u.m[0][1] * pm->u.m[1][3] - pm->u.m[1][1] * pm->u.m[0][3];
+    s[5] = pm->u.m[0][2] * pm->u.m[1][3] - pm->u.m[1][2] * pm->u.m[0][3];
+
+    c[0] = pm->u.m[2][0] * pm->u.m[3][1] - pm->u.m[3][0] * pm->u.m[2][1];
+    c[1] = pm->u.m[2][0] * pm->u.m[3][2] - pm->u.m[3][0] * pm->u.m[2][2];
+    c[2] = pm->u.m[2][0] * pm->u.m[3][3] - pm->u.m[3][0] * pm->u.m[2][3];
+    c[3] = pm->u.m[2][1] * pm->u.m[3][2] - pm->u.m[3][1] * pm->u.m[2][2];
+    c[4] = pm->u.m[2][1] * pm->u.m[3][3] - pm->u.m[3][1] * pm->u.m[2][3];
+    c[5] = pm->u.m[2][2] * pm->u.m[3][3] - pm->u.m[3][2] * pm->u.m[2][3];
+
+    det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
     if (det == 0.0f)
         return NULL;
     if (pdeterminant)
         *pdeterminant = det;
 
-    t[0] = pm->u.m[2][2] * pm->u.m[3][3] - pm->u.m[2][3] * pm->u.m[3][2];
-    t[1] = pm->u.m[0][2] * pm->u.m[3][3] - pm->u.m[0][3] * pm->u.m[3][2];
-    t[2] = pm->u.m[0][2] * pm->u.m[2][3] - pm->u.m[0][3] * pm->u.m[2][2];
-    v[1] = -pm->u.m[0][1] * t[0] + pm->u.m[2][1] * t[1] - pm->u.m[3][1] * t[2];
-    v[5] = pm->u.m[0][0] * t[0] - pm->u.m[2][0] * t[1] + pm->u.m[3][0] * t[2];
+    v[0] = pm->u.m[1][1] * c[5] - pm->u.m[1][2] * c[4] + pm->u.m[1][3] * c[3];
+    v[1] = -pm->u.m[0][1] * c[5] + pm->u.m[0][2] * c[4] - pm->u.m[0][3] * c[3];
+    v[2] = pm->u.m[3][1] * s[5] - pm->u.m[3][2] * s[4] + pm->u.m[3][3] * s[3];
+    v[3] = -pm->u.m[2][1] * s[5] + pm->u.m[2][2] * s[4] - pm->u.m[2][3] * s[3];
 
-    t[0] = pm->u.m[0][0] * pm->u.m[2][1] - pm->u.m[2][0] * pm->u.m[0][1];
-    t[1] = pm->u.m[3][0] * pm->u.m[0][1] - pm->u.m[0][0] * pm->u.m[3][1];
-    t[2] = pm->u.m[2][0] * pm->u.m[3][1] - pm->u.m[3][0] * pm->u.m[2][1];
-    v[9] = -pm->u.m[3][3] * t[0] - pm->u.m[2][3] * t[1]- pm->u.m[0][3] * t[2];
-    v[13] = pm->u.m[3][2] * t[0] + pm->u.m[2][2] * t[1] + pm->u.m[0][2] * t[2];
-
-    t[0] = pm->u.m[1][2] * pm->u.m[3][3] - pm->u.m[1][3] * pm->u.m[3][2];
-    t[1] = pm->u.m[0][2] * pm->u.m[3][3] - pm->u.m[0][3] * pm->u.m[3][2];
-    t[2] = pm->u.m[0][2] * pm->u.m[1][3] - pm->u.m[0][3] * pm->u.m[1][2];
-    v[2] = pm->u.m[0][1] * t[0] - pm->u.m[1][1] * t[1] + pm->u.m[3][1] * t[2];
-    v[6] = -pm->u.m[0][0] * t[0] + pm->u.m[1][0] * t[1] - pm->u.m[3][0] * t[2];
-
-    t[0] = pm->u.m[0][0] * pm->u.m[1][1] - pm->u.m[1][0] * pm->u.m[0][1];
-    t[1] = pm->u.m[3][0] * pm->u.m[0][1] - pm->u.m[0][0] * pm->u.m[3][1];
-    t[2] = pm->u.m[1][0] * pm->u.m[3][1] - pm->u.m[3][0] * pm->u.m[1][1];
-    v[10] = pm->u.m[3][3] * t[0] + pm->u.m[1][3] * t[1] + pm->u.m[0][3] * t[2];
-    v[14] = -pm->u.m[3][2] * t[0] - pm->u.m[1][2] * t[1] - pm->u.m[0][2] * t[2];
-
-    t[0] = pm->u.m[1][2] * pm->u.m[2][3] - pm->u.m[1][3] * pm->u.m[2][2];
-    t[1] = pm->u.m[0][2] * pm->u.m[2][3] - pm->u.m[0][3] * pm->u.m[2][2];
-    t[2] = pm->u.m[0][2] * pm->u.m[1][3] - pm->u.m[0][3] * pm->u.m[1][2];
-    v[3] = -pm->u.m[0][1] * t[0] + pm->u.m[1][1] * t[1] - pm->u.m[2][1] * t[2];
-    v[7] = pm->u.m[0][0] * t[0] - pm->u.m[1][0] * t[1] + pm->u.m[2][0] * t[2];
-
-    v[11] = -pm->u.m[0][0] * (pm->u.m[1][1] * pm->u.m[2][3] - pm->u.m[1][3] * pm->u.m[2][1]) +
-        pm->u.m[1][0] * (pm->u.m[0][1] * pm->u.m[2][3] - pm->u.m[0][3] * pm->u.m[2][1]) -
-        pm->u.m[2][0] * (pm->u.m[0][1] * pm->u.m[1][3] - pm->u.m[0][3] * pm->u.m[1][1]);
-
-    v[15] = pm->u.m[0][0] * (pm->u.m[1][1] * pm->u.m[2][2] - pm->u.m[1][2] * pm->u.m[2][1]) -
-        pm->u.m[1][0] * (pm->u.m[0][1] * pm->u.m[2][2] - pm->u.m[0][2] * pm->u.m[2][1]) +
-        pm->u.m[2][0] * (pm->u.m[0][1] * pm->u.m[1][2] - pm->u.m[0][2] * pm->u.m[1][1]);
+    v[4] = -pm->u.m[1][0] * c[5] + pm->u.m[1][2] * c[2] - pm->u.m[1][3] * c[1];
+    v[5] = pm->u.m[0][0] * c[5] - pm->u.m[0][2] * c[2] + pm->u.m[0][3] * c[1];
+    v[6] = -pm->u.m[3][0] * s[5] + pm->u.m[3][2] * s[2] - pm->u.m[3][3] * s[1];
+    v[7] = pm->u.m[2][0] * s[5] - pm->u.m[2][2] * s[2] + pm->u.m[2][3] * s[1];
+
+    v[8] = pm->u.m[1][0] * c[4] - pm->u.m[1][1] * c[2] + pm->u.m[1][3] * c[0];
+    v[9] = -pm->u.m[0][0] * c[4] + pm->u.m[0][1] * c[2] - pm->u.m[0][3] * c[0];
+    v[10] = pm->u.m[3][0] * s[4] - pm->u.m[3][1] * s[2] + pm->u.m[3][3] * s[0];
+    v[11] = -pm->u.m[2][0] * s[4] + pm->u.m[2][1] * s[2] - pm->u.m[2][3] * s[0];
+
+    v[12] = -pm->u.m[1][0] * c[3] + pm->u.m[1][1] * c[1] - pm->u.m[1][2] * c[0];
+    v[13] = pm->u.m[0][0] * c[3] - pm->u.m[0][1] * c[1] + pm->u.m[0][2] * c[0];
+    v[14] = -pm->u.m[3][0] * s[3] + pm->u.m[3][1] * s[1] - pm->u.m[3][2] * s[0];
+    v[15] = pm->u.m[2][0] * s[3] - pm->u.m[2][1] * s[1] + pm->u.m[2][2] * s[0];
 
     det = 1.0f / det;
 
@@ -397,6 +466,14 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, c
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+#ifdef SSE_FUNC
+    if (sse_supported())
+    {
+        multiply_matrix_sse(pout, pm1, pm2);
+        return pout;
+    }
+#endif
+
     for (i=0; i<4; i++)
     {
         for (j=0; j<4; j++)
@@ -1324,15 +1401,20 @@ D3DXPLANE* WINAPI D3DXPlaneTransform(D3DXPLANE *pout, const D3DXPLANE *pplane, c
 
 D3DXPLANE* WINAPI D3DXPlaneTransformArray(D3DXPLANE* out, UINT outstride, const D3DXPLANE* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXPlaneTransform(
-            (D3DXPLANE*)((char*)out + outstride * i),
-            (const D3DXPLANE*)((const char*)in + instride * i),
-            matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXPLANE v = *(const D3DXPLANE *)((const char *)in + instride * i);
+        D3DXPLANE *o = (D3DXPLANE *)((char *)out + outstride * i);
+
+        o->a = m.u.m[0][0] * v.a + m.u.m[1][0] * v.b + m.u.m[2][0] * v.c + m.u.m[3][0] * v.d;
+        o->b = m.u.m[0][1] * v.a + m.u.m[1][1] * v.b + m.u.m[2][1] * v.c + m.u.m[3][1] * v.d;
+        o->c = m.u.m[0][2] * v.a + m.u.m[1][2] * v.b + m.u.m[2][2] * v.c + m.u.m[3][2] * v.d;
+        o->d = m.u.m[0][3] * v.a + m.u.m[1][3] * v.b + m.u.m[2][3] * v.c + m.u.m[3][3] * v.d;
     }
     return out;
 }
@@ -1727,15 +1809,20 @@ D3DXVECTOR4* WINAPI D3DXVec2Transform(D3DXVECTOR4 *pout, const D3DXVECTOR2 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec2TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR2* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec2Transform(
-            (D3DXVECTOR4*)((char*)out + outstride * i),
-            (const D3DXVECTOR2*)((const char*)in + instride * i),
-            matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 v = *(const D3DXVECTOR2 *)((const char *)in + instride * i);
+        D3DXVECTOR4 *o = (D3DXVECTOR4 *)((char *)out + outstride * i);
+
+        o->x = m.u.m[0][0] * v.x + m.u.m[1][0] * v.y + m.u.m[3][0];
+        o->y = m.u.m[0][1] * v.x + m.u.m[1][1] * v.y + m.u.m[3][1];
+        o->z = m.u.m[0][2] * v.x + m.u.m[1][2] * v.y + m.u.m[3][2];
+        o->w = m.u.m[0][3] * v.x + m.u.m[1][3] * v.y + m.u.m[3][3];
     }
     return out;
 }
@@ -1758,15 +1845,19 @@ D3DXVECTOR2* WINAPI D3DXVec2TransformCoord(D3DXVECTOR2 *pout, const D3DXVECTOR2
 
 D3DXVECTOR2* WINAPI D3DXVec2TransformCoordArray(D3DXVECTOR2* out, UINT outstride, const D3DXVECTOR2* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec2TransformCoord(
-            (D3DXVECTOR2*)((char*)out + outstride * i),
-            (const D3DXVECTOR2*)((const char*)in + instride * i),
-            matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 v = *(const D3DXVECTOR2 *)((const char *)in + instride * i);
+        D3DXVECTOR2 *o = (D3DXVECTOR2 *)((char *)out + outstride * i);
+        FLOAT norm = m.u.m[0][3] * v.x + m.u.m[1][3] * v.y + m.u.m[3][3];
+
+        o->x = (m.u.m[0][0] * v.x + m.u.m[1][0] * v.y + m.u.m[3][0]) / norm;
+        o->y = (m.u.m[0][1] * v.x + m.u.m[1][1] * v.y + m.u.m[3][1]) / norm;
     }
     return out;
 }
@@ -1784,15 +1875,18 @@ D3DXVECTOR2* WINAPI D3DXVec2TransformNormal(D3DXVECTOR2 *pout, const D3DXVECTOR2
 
 D3DXVECTOR2* WINAPI D3DXVec2TransformNormalArray(D3DXVECTOR2* out, UINT outstride, const D3DXVECTOR2 *in, UINT instride, const D3DXMATRIX *matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec2TransformNormal(
-            (D3DXVECTOR2*)((char*)out + outstride * i),
-            (const D3DXVECTOR2*)((const char*)in + instride * i),
-            matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 v = *(const D3DXVECTOR2 *)((const char *)in + instride * i);
+        D3DXVECTOR2 *o = (D3DXVECTOR2 *)((char *)out + outstride * i);
+
+        o->x = m.u.m[0][0] * v.x + m.u.m[1][0] * v.y;
+        o->y = m.u.m[0][1] * v.x + m.u.m[1][1] * v.y;
     }
     return out;
 }
@@ -1913,15 +2007,28 @@ D3DXVECTOR4* WINAPI D3DXVec3Transform(D3DXVECTOR4 *pout, const D3DXVECTOR3 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec3TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3Transform(
-            (D3DXVECTOR4*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            matrix);
+#ifdef SSE_FUNC
+    if (sse_supported())
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements);
+        return out;
+    }
+#endif
+
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 v = *(const D3DXVECTOR3 *)((const char *)in + instride * i);
+        D3DXVECTOR4 *o = (D3DXVECTOR4 *)((char *)out + outstride * i);
+
+        o->x = m.u.m[0][0] * v.x + m.u.m[1][0] * v.y + m.u.m[2][0] * v.z + m.u.m[3][0];
+        o->y = m.u.m[0][1] * v.x + m.u.m[1][1] * v.y + m.u.m[2][1] * v.z + m.u.m[3][1];
+        o->z = m.u.m[0][2] * v.x + m.u.m[1][2] * v.y + m.u.m[2][2] * v.z + m.u.m[3][2];
+        o->w = m.u.m[0][3] * v.x + m.u.m[1][3] * v.y + m.u.m[2][3] * v.z + m.u.m[3][3];
     }
     return out;
 }
@@ -1946,15 +2053,20 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformCoord(D3DXVECTOR3 *pout, const D3DXVECTOR3
 
 D3DXVECTOR3* WINAPI D3DXVec3TransformCoordArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3TransformCoord(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 v = *(const D3DXVECTOR3 *)((const char *)in + instride * i);
+        D3DXVECTOR3 *o = (D3DXVECTOR3 *)((char *)out + outstride * i);
+        FLOAT norm = m.u.m[0][3] * v.x + m.u.m[1][3] * v.y + m.u.m[2][3] * v.z + m.u.m[3][3];
+
+        o->x = (m.u.m[0][0] * v.x + m.u.m[1][0] * v.y + m.u.m[2][0] * v.z + m.u.m[3][0]) / norm;
+        o->y = (m.u.m[0][1] * v.x + m.u.m[1][1] * v.y + m.u.m[2][1] * v.z + m.u.m[3][1]) / norm;
+        o->z = (m.u.m[0][2] * v.x + m.u.m[1][2] * v.y + m.u.m[2][2] * v.z + m.u.m[3][2]) / norm;
     }
     return out;
 }
@@ -1974,15 +2086,19 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformNormal(D3DXVECTOR3 *pout, const D3DXVECTOR3
 
 D3DXVECTOR3* WINAPI D3DXVec3TransformNormalArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3TransformNormal(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 v = *(const D3DXVECTOR3 *)((const char *)in + instride * i);
+        D3DXVECTOR3 *o = (D3DXVECTOR3 *)((char *)out + outstride * i);
+
+        o->x = m.u.m[0][0] * v.x + m.u.m[1][0] * v.y + m.u.m[2][0] * v.z;
+        o->y = m.u.m[0][1] * v.x + m.u.m[1][1] * v.y + m.u.m[2][1] * v.z;
+        o->z = m.u.m[0][2] * v.x + m.u.m[1][2] * v.y + m.u.m[2][2] * v.z;
     }
     return out;
 }
@@ -2114,15 +2230,28 @@ D3DXVECTOR4* WINAPI D3DXVec4Transform(D3DXVECTOR4 *pout, const D3DXVECTOR4 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec4TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR4* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+    const D3DXMATRIX m = *matrix;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec4Transform(
-            (D3DXVECTOR4*)((char*)out + outstride * i),
-            (const D3DXVECTOR4*)((const char*)in + instride * i),
-            matrix);
+#ifdef SSE_FUNC
+    if (sse_supported())
+    {
+        vec4_transform_array_sse(out, outstride, in, instride, matrix, elements);
+        return out;
+    }
+#endif
+
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR4 v = *(const D3DXVECTOR4 *)((const char *)in + instride * i);
+        D3DXVECTOR4 *o = (D3DXVECTOR4 *)((char *)out + outstride * i);
+
+        o->x = m.u.m[0][0] * v.x + m.u.m[1][0] * v.y + m.u.m[2][0] * v.z + m.u.m[3][0] * v.w;
+        o->y = m.u.m[0][1] * v.x + m.u.m[1][1] * v.y + m.u.m[2][1] * v.z + m.u.m[3][1] * v.w;
+        o->z = m.u.m[0][2] * v.x + m.u.m[1][2] * v.y + m.u.m[2][2] * v.z + m.u.m[3][2] * v.w;
+        o->w = m.u.m[0][3] * v.x + m.u.m[1][3] * v.y + m.u.m[2][3] * v.z + m.u.m[3][3] * v.w;
     }
     return out;
 }
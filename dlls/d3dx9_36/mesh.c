@@ -1640,6 +1640,302 @@ static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *in
     return D3D_OK;
 }
 
+/* Vertex cache optimization, following Tom Forsyth's "Linear-Speed Vertex
+ * Cache Optimisation". Faces are emitted greedily, always picking the face
+ * whose vertices score highest, where a vertex scores higher the more
+ * recently it was used and the fewer faces still reference it. */
+#define VCACHE_SIZE 32
+#define VCACHE_DECAY_POWER 1.5f
+#define VCACHE_LAST_FACE_SCORE 0.75f
+#define VCACHE_VALENCE_BOOST_SCALE 2.0f
+
+struct vcache_vertex
+{
+    float score;
+    int cache_pos;
+    DWORD face_start;
+    DWORD face_count; /* faces not emitted yet */
+};
+
+static float vcache_vertex_score(const struct vcache_vertex *vertex)
+{
+    float score = 0.0f;
+
+    if (!vertex->face_count)
+        return -1.0f;
+
+    if (vertex->cache_pos >= 0)
+    {
+        if (vertex->cache_pos < 3)
+        {
+            /* The vertices of the face that was just emitted get a fixed
+             * score, to avoid favoring faces that reuse all three of them. */
+            score = VCACHE_LAST_FACE_SCORE;
+        }
+        else
+        {
+            score = 1.0f - (vertex->cache_pos - 3) * (1.0f / (VCACHE_SIZE - 3));
+            score = powf(score, VCACHE_DECAY_POWER);
+        }
+    }
+
+    return score + VCACHE_VALENCE_BOOST_SCALE / sqrtf(vertex->face_count);
+}
+
+/* Reorders the faces in faces[0..face_count) for better vertex cache use. */
+static HRESULT optimize_faces_for_vertex_cache(const DWORD *indices, DWORD num_vertices,
+        DWORD *faces, DWORD face_count)
+{
+    DWORD cache[VCACHE_SIZE + 3], new_cache[VCACHE_SIZE + 3];
+    DWORD cache_size = 0, new_cache_size, face_vertex_count;
+    struct vcache_vertex *vertices;
+    DWORD *vertex_faces, *order;
+    BOOL *face_added;
+    DWORD i, j, k, scan_pos = 0, best_face = ~0u;
+    float best_score;
+
+    vertices = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_vertices * sizeof(*vertices));
+    vertex_faces = HeapAlloc(GetProcessHeap(), 0, face_count * 3 * sizeof(*vertex_faces));
+    order = HeapAlloc(GetProcessHeap(), 0, face_count * sizeof(*order));
+    face_added = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, face_count * sizeof(*face_added));
+    if (!vertices || !vertex_faces || !order || !face_added)
+    {
+        HeapFree(GetProcessHeap(), 0, vertices);
+        HeapFree(GetProcessHeap(), 0, vertex_faces);
+        HeapFree(GetProcessHeap(), 0, order);
+        HeapFree(GetProcessHeap(), 0, face_added);
+        return E_OUTOFMEMORY;
+    }
+
+    /* Build the per-vertex lists of faces. */
+    for (i = 0; i < face_count * 3; ++i)
+        ++vertices[indices[faces[i / 3] * 3 + i % 3]].face_count;
+    for (i = 0, j = 0; i < num_vertices; ++i)
+    {
+        vertices[i].face_start = j;
+        j += vertices[i].face_count;
+        vertices[i].face_count = 0;
+        vertices[i].cache_pos = -1;
+    }
+    for (i = 0; i < face_count * 3; ++i)
+    {
+        struct vcache_vertex *vertex = &vertices[indices[faces[i / 3] * 3 + i % 3]];
+
+        vertex_faces[vertex->face_start + vertex->face_count++] = i / 3;
+    }
+    for (i = 0; i < num_vertices; ++i)
+        vertices[i].score = vcache_vertex_score(&vertices[i]);
+
+    best_score = -1.0f;
+    for (i = 0; i < face_count; ++i)
+    {
+        float score = vertices[indices[faces[i] * 3]].score
+                + vertices[indices[faces[i] * 3 + 1]].score
+                + vertices[indices[faces[i] * 3 + 2]].score;
+
+        if (score > best_score)
+        {
+            best_score = score;
+            best_face = i;
+        }
+    }
+
+    for (i = 0; i < face_count; ++i)
+    {
+        if (best_face == ~0u)
+        {
+            /* Nothing in the cache is connected to any remaining face, pick
+             * the next one in the original order. */
+            while (face_added[scan_pos])
+                ++scan_pos;
+            best_face = scan_pos;
+        }
+
+        order[i] = faces[best_face];
+        face_added[best_face] = TRUE;
+
+        /* The vertices of the new face move to the front of the cache. */
+        new_cache_size = 0;
+        for (k = 0; k < 3; ++k)
+        {
+            DWORD v = indices[faces[best_face] * 3 + k];
+            struct vcache_vertex *vertex = &vertices[v];
+            DWORD *list = &vertex_faces[vertex->face_start];
+
+            for (j = 0; j < vertex->face_count; ++j)
+            {
+                if (list[j] == best_face)
+                {
+                    list[j] = list[--vertex->face_count];
+                    break;
+                }
+            }
+            for (j = 0; j < new_cache_size; ++j)
+            {
+                if (new_cache[j] == v)
+                    break;
+            }
+            if (j == new_cache_size)
+                new_cache[new_cache_size++] = v;
+        }
+        face_vertex_count = new_cache_size;
+        for (j = 0; j < cache_size; ++j)
+        {
+            DWORD v = cache[j];
+
+            for (k = 0; k < face_vertex_count; ++k)
+            {
+                if (new_cache[k] == v)
+                    break;
+            }
+            if (k == face_vertex_count)
+                new_cache[new_cache_size++] = v;
+        }
+
+        /* Update the scores of everything that was in or entered the cache;
+         * vertices that fall out of it lose their cache bonus. */
+        best_face = ~0u;
+        best_score = -1.0f;
+        for (j = 0; j < new_cache_size; ++j)
+        {
+            struct vcache_vertex *vertex = &vertices[new_cache[j]];
+
+            vertex->cache_pos = j < VCACHE_SIZE ? j : -1;
+            vertex->score = vcache_vertex_score(vertex);
+        }
+        for (j = 0; j < new_cache_size; ++j)
+        {
+            const struct vcache_vertex *vertex = &vertices[new_cache[j]];
+            const DWORD *list = &vertex_faces[vertex->face_start];
+
+            for (k = 0; k < vertex->face_count; ++k)
+            {
+                DWORD face = list[k];
+                float score = vertices[indices[faces[face] * 3]].score
+                        + vertices[indices[faces[face] * 3 + 1]].score
+                        + vertices[indices[faces[face] * 3 + 2]].score;
+
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best_face = face;
+                }
+            }
+        }
+
+        cache_size = min(new_cache_size, VCACHE_SIZE);
+        memcpy(cache, new_cache, cache_size * sizeof(*cache));
+    }
+
+    memcpy(faces, order, face_count * sizeof(*faces));
+
+    HeapFree(GetProcessHeap(), 0, vertices);
+    HeapFree(GetProcessHeap(), 0, vertex_faces);
+    HeapFree(GetProcessHeap(), 0, order);
+    HeapFree(GetProcessHeap(), 0, face_added);
+
+    return D3D_OK;
+}
+
+/* Reorders the faces of each attribute range of an attribute sorted mesh for
+ * better vertex cache use, updating face_remap accordingly. */
+static HRESULT remap_faces_for_vertex_cache(struct d3dx9_mesh *This, const DWORD *indices,
+        const DWORD *sorted_attrib_buffer, DWORD *face_remap)
+{
+    DWORD *faces;
+    DWORD i, start;
+    HRESULT hr = D3D_OK;
+
+    if (!(faces = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*faces))))
+        return E_OUTOFMEMORY;
+
+    for (i = 0; i < This->numfaces; ++i)
+        faces[face_remap[i]] = i;
+
+    for (start = 0; start < This->numfaces; start = i)
+    {
+        for (i = start + 1; i < This->numfaces && sorted_attrib_buffer[i] == sorted_attrib_buffer[start]; ++i);
+
+        if (FAILED(hr = optimize_faces_for_vertex_cache(indices, This->numvertices, &faces[start], i - start)))
+            break;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        for (i = 0; i < This->numfaces; ++i)
+            face_remap[faces[i]] = i;
+    }
+
+    HeapFree(GetProcessHeap(), 0, faces);
+    return hr;
+}
+
+/* Renumbers the vertices in the order the reordered faces first use them.
+ * Unused vertices are moved to the end, or dropped when compacting. */
+static HRESULT remap_vertices_for_face_order(struct d3dx9_mesh *This, DWORD *indices,
+        const DWORD *face_remap, BOOL compact, DWORD *new_num_vertices, ID3DXBuffer **vertex_remap)
+{
+    DWORD *vertex_remap_ptr, *faces, *old_to_new;
+    DWORD num_vertices = 0;
+    DWORD i, k;
+    HRESULT hr;
+
+    faces = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*faces));
+    old_to_new = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*old_to_new));
+    if (!faces || !old_to_new)
+    {
+        hr = E_OUTOFMEMORY;
+        goto cleanup;
+    }
+    if (FAILED(hr = D3DXCreateBuffer(This->numvertices * sizeof(DWORD), vertex_remap)))
+        goto cleanup;
+    vertex_remap_ptr = ID3DXBuffer_GetBufferPointer(*vertex_remap);
+
+    for (i = 0; i < This->numfaces; ++i)
+        faces[face_remap[i]] = i;
+
+    /* create old->new vertex mapping */
+    for (i = 0; i < This->numvertices; ++i)
+        old_to_new[i] = -1;
+    for (i = 0; i < This->numfaces; ++i)
+    {
+        for (k = 0; k < 3; ++k)
+        {
+            DWORD v = indices[faces[i] * 3 + k];
+
+            if (old_to_new[v] == -1)
+                old_to_new[v] = num_vertices++;
+        }
+    }
+    if (!compact)
+    {
+        for (i = 0; i < This->numvertices; ++i)
+        {
+            if (old_to_new[i] == -1)
+                old_to_new[i] = num_vertices++;
+        }
+    }
+
+    /* convert indices */
+    for (i = 0; i < This->numfaces * 3; ++i)
+        indices[i] = old_to_new[indices[i]];
+
+    /* create new->old vertex mapping */
+    for (i = 0; i < This->numvertices; ++i)
+        vertex_remap_ptr[i] = -1;
+    for (i = 0; i < This->numvertices; ++i)
+    {
+        if (old_to_new[i] != -1)
+            vertex_remap_ptr[old_to_new[i]] = i;
+    }
+    *new_num_vertices = num_vertices;
+
+cleanup:
+    HeapFree(GetProcessHeap(), 0, old_to_new);
+    HeapFree(GetProcessHeap(), 0, faces);
+    return hr;
+}
+
 static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags, const DWORD *adjacency_in,
         DWORD *adjacency_out, DWORD *face_remap_out, ID3DXBuffer **vertex_remap_out)
 {
@@ -1666,14 +1962,14 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
         return D3DERR_INVALIDCALL;
 
-    if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
+    if (flags & D3DXMESHOPT_STRIPREORDER)
     {
-        if (flags & D3DXMESHOPT_VERTEXCACHE)
-            FIXME("D3DXMESHOPT_VERTEXCACHE not implemented.\n");
-        if (flags & D3DXMESHOPT_STRIPREORDER)
-            FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
+        FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
         return E_NOTIMPL;
     }
+    /* Vertex cache optimization is done within attribute ranges. */
+    if (flags & D3DXMESHOPT_VERTEXCACHE)
+        flags |= D3DXMESHOPT_ATTRSORT;
 
     hr = iface->lpVtbl->LockIndexBuffer(iface, 0, &indices);
     if (FAILED(hr)) goto cleanup;
@@ -1694,18 +1990,25 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
         hr = compact_mesh(This, dword_indices, &new_num_vertices, &vertex_remap);
         if (FAILED(hr)) goto cleanup;
     } else if (flags & D3DXMESHOPT_ATTRSORT) {
-        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
-        {
-            FIXME("D3DXMESHOPT_ATTRSORT vertex reordering not implemented.\n");
-            hr = E_NOTIMPL;
-            goto cleanup;
-        }
-
         hr = iface->lpVtbl->LockAttributeBuffer(iface, 0, &attrib_buffer);
         if (FAILED(hr)) goto cleanup;
 
         hr = remap_faces_for_attrsort(This, dword_indices, attrib_buffer, &sorted_attrib_buffer, &face_remap);
         if (FAILED(hr)) goto cleanup;
+
+        if (flags & D3DXMESHOPT_VERTEXCACHE)
+        {
+            hr = remap_faces_for_vertex_cache(This, dword_indices, sorted_attrib_buffer, face_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
+
+        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+        {
+            new_num_alloc_vertices = This->numvertices;
+            hr = remap_vertices_for_face_order(This, dword_indices, face_remap,
+                    flags & D3DXMESHOPT_COMPACT, &new_num_vertices, &vertex_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
     }
 
     if (vertex_remap)
@@ -1798,9 +2101,10 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             for (i = 0; i < This->numfaces; i++) {
                 DWORD old_pos = i * 3;
                 DWORD new_pos = face_remap[i] * 3;
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
+                DWORD j;
+
+                for (j = 0; j < 3; ++j, ++old_pos)
+                    adjacency_out[new_pos++] = adjacency_in[old_pos] == -1 ? -1 : face_remap[adjacency_in[old_pos]];
             }
         } else {
             memcpy(adjacency_out, adjacency_in, This->numfaces * 3 * sizeof(*adjacency_out));
@@ -243,16 +243,21 @@ static void regstore_free_tables(struct d3dx_regstore *rs)
     }
 }
 
-static void regstore_set_values(struct d3dx_regstore *rs, unsigned int table, void *data,
+/* Returns TRUE if any of the values or their "set" state changed. */
+static BOOL regstore_set_values(struct d3dx_regstore *rs, unsigned int table, void *data,
         unsigned int start_offset, unsigned int count)
 {
     unsigned int block_idx, start, end, start_block, end_block;
+    unsigned int *value_set = rs->table_value_set[table];
+    BYTE *dst;
+    BOOL changed;
 
     if (!count)
-        return;
+        return FALSE;
 
-    memcpy((BYTE *)rs->tables[table] + start_offset * table_info[table].component_size,
-            data, count * table_info[table].component_size);
+    dst = (BYTE *)rs->tables[table] + start_offset * table_info[table].component_size;
+    if ((changed = !!memcmp(dst, data, count * table_info[table].component_size)))
+        memcpy(dst, data, count * table_info[table].component_size);
 
     start = get_reg_offset(table, start_offset);
     start_block = start / PRES_BITMASK_BLOCK_SIZE;
@@ -263,17 +268,27 @@ static void regstore_set_values(struct d3dx_regstore *rs, unsigned int table, vo
 
     if (start_block == end_block)
     {
-        rs->table_value_set[table][start_block] |= (~0u << start) & (~0u >> end);
+        unsigned int mask = (~0u << start) & (~0u >> end);
+
+        changed |= (value_set[start_block] & mask) != mask;
+        value_set[start_block] |= mask;
     }
     else
     {
-        rs->table_value_set[table][start_block] |= ~0u << start;
+        changed |= (value_set[start_block] & (~0u << start)) != (~0u << start);
+        value_set[start_block] |= ~0u << start;
 
         for (block_idx = start_block + 1; block_idx < end_block; ++block_idx)
-            rs->table_value_set[table][block_idx] = ~0u;
+        {
+            changed |= value_set[block_idx] != ~0u;
+            value_set[block_idx] = ~0u;
+        }
 
-        rs->table_value_set[table][end_block] |= ~0u >> end;
+        changed |= (value_set[end_block] & (~0u >> end)) != (~0u >> end);
+        value_set[end_block] |= ~0u >> end;
     }
+
+    return changed;
 }
 
 static unsigned int regstore_is_val_set_reg(struct d3dx_regstore *rs, unsigned int table, unsigned int reg_idx)
@@ -317,18 +332,6 @@ static void regstore_set_double(struct d3dx_regstore *rs, unsigned int table, un
             1u << (reg_idx % PRES_BITMASK_BLOCK_SIZE);
 }
 
-static void regstore_reset_table(struct d3dx_regstore *rs, unsigned int table)
-{
-    unsigned int size;
-
-    size = rs->table_sizes[table] * table_info[table].reg_component_count * table_info[table].component_size;
-
-    memset(rs->tables[table], 0, size);
-    memset(rs->table_value_set[table], 0,
-            sizeof(*rs->table_value_set[table]) *
-            ((rs->table_sizes[table] + PRES_BITMASK_BLOCK_SIZE - 1) / PRES_BITMASK_BLOCK_SIZE));
-}
-
 static void dump_bytecode(void *data, unsigned int size)
 {
     unsigned int *bytecode = (unsigned int *)data;
@@ -835,9 +838,11 @@ void d3dx_free_param_eval(struct d3dx_param_eval *peval)
     HeapFree(GetProcessHeap(), 0, peval);
 }
 
-static void set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const_tab)
+/* Returns TRUE if any register value changed since the previous call. */
+static BOOL set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const_tab)
 {
     unsigned int const_idx;
+    BOOL changed = FALSE;
 
     for (const_idx = 0; const_idx < const_tab->const_set_count; ++const_idx)
     {
@@ -874,7 +879,7 @@ static void set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const
                 && count == table_info[table].reg_component_count * const_set->register_count
                 && count * sizeof(unsigned int) <= param->bytes)
         {
-            regstore_set_values(rs, table, param->data, start_offset, count);
+            changed |= regstore_set_values(rs, table, param->data, start_offset, count);
             continue;
         }
 
@@ -914,10 +919,11 @@ static void set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const
                         FIXME("Unexpected type %#x.\n", table_info[table].type);
                         break;
                 }
-                regstore_set_values(rs, table, &out, offset, 1);
+                changed |= regstore_set_values(rs, table, &out, offset, 1);
             }
         }
     }
+    return changed;
 }
 
 #define INITIAL_CONST_SET_SIZE 16
@@ -1148,6 +1154,27 @@ static HRESULT execute_preshader(struct d3dx_preshader *pres)
     return D3D_OK;
 }
 
+/* Loads the preshader inputs and runs it, unless none of the inputs changed
+ * since the last run. A preshader always writes the same output registers,
+ * so its previous results are still in place in that case. */
+static HRESULT update_preshader(struct d3dx_preshader *pres)
+{
+    HRESULT hr;
+
+    if (!set_constants(&pres->regs, &pres->inputs) && pres->results_valid)
+    {
+        TRACE("Inputs unchanged, skipping preshader execution.\n");
+        return D3D_OK;
+    }
+
+    pres->results_valid = FALSE;
+    if (FAILED(hr = execute_preshader(pres)))
+        return hr;
+    pres->results_valid = TRUE;
+
+    return D3D_OK;
+}
+
 HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx_parameter *param, void *param_value)
 {
     HRESULT hr;
@@ -1157,9 +1184,7 @@ HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx
 
     TRACE("peval %p, param %p, param_value %p.\n", peval, param, param_value);
 
-    set_constants(&peval->pres.regs, &peval->pres.inputs);
-
-    if (FAILED(hr = execute_preshader(&peval->pres)))
+    if (FAILED(hr = update_preshader(&peval->pres)))
         return hr;
 
     elements_table = table_info[PRES_REGTAB_OCONST].reg_component_count
@@ -1242,7 +1267,6 @@ static HRESULT set_shader_constants_device(struct IDirect3DDevice9 *device, stru
         }
         start += count;
     }
-    regstore_reset_table(rs, table);
     return result;
 }
 
@@ -1257,8 +1281,7 @@ HRESULT d3dx_param_eval_set_shader_constants(struct IDirect3DDevice9 *device, st
 
     TRACE("device %p, peval %p, param_type %u.\n", device, peval, peval->param_type);
 
-    set_constants(rs, &pres->inputs);
-    if (FAILED(hr = execute_preshader(pres)))
+    if (FAILED(hr = update_preshader(pres)))
         return hr;
 
     set_constants(rs, &peval->shader_inputs);
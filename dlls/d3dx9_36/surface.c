@@ -21,6 +21,17 @@
 #include "config.h"
 #include "wine/port.h"
 
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef __SSE2__
+#  define SSE2_FUNC
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define SSE2_FUNC __attribute__((target("sse2")))  /* selected at run time */
+# endif
+# ifdef SSE2_FUNC
+#  include <emmintrin.h>
+# endif
+#endif
+
 #include "d3dx9_private.h"
 
 #include "initguid.h"
@@ -1413,6 +1424,177 @@ static DWORD make_argb_color(const struct argb_conversion_info *info, const DWOR
     return val;
 }
 
+/* Formats with 8 bit components stored in whole bytes can be converted
+ * between each other without going through get_relevant_argb_components()
+ * and make_argb_color() for every pixel. The results are the same. */
+typedef void (*argb_row_conversion_func)(const struct argb_conversion_info *info,
+        const BYTE *src, BYTE *dst, UINT width);
+
+static BOOL format_has_byte_components(const struct pixel_format_desc *format)
+{
+    unsigned int c;
+
+    if (format->type != FORMAT_ARGB || format->to_rgba || format->from_rgba
+            || (format->bytes_per_pixel != 3 && format->bytes_per_pixel != 4))
+        return FALSE;
+
+    for (c = 0; c < 4; ++c)
+    {
+        if (format->bits[c] && (format->bits[c] != 8 || format->shift[c] % 8))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Both formats have 4 bytes per pixel and components at the same place,
+ * e.g. D3DFMT_X8R8G8B8 to D3DFMT_A8R8G8B8. */
+static void convert_argb8_row_masked(const struct argb_conversion_info *info,
+        const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD mask = 0, pixel;
+    unsigned int c, x;
+
+    for (c = 0; c < 4; ++c)
+    {
+        if (info->process_channel[c])
+            mask |= info->destmask[c];
+    }
+
+    for (x = 0; x < width; ++x)
+    {
+        memcpy(&pixel, src + x * 4, sizeof(pixel));
+        pixel = (pixel & mask) | info->channelmask;
+        memcpy(dst + x * 4, &pixel, sizeof(pixel));
+    }
+}
+
+/* Components are moved around, e.g. D3DFMT_A8B8G8R8 to D3DFMT_A8R8G8B8 or
+ * D3DFMT_R8G8B8 to D3DFMT_X8R8G8B8. */
+static void convert_argb8_row_shuffle(const struct argb_conversion_info *info,
+        const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT src_bpp = info->srcformat->bytes_per_pixel, dst_bpp = info->destformat->bytes_per_pixel;
+    unsigned int src_offset[4], dst_shift[4];
+    unsigned int c, x, count = 0;
+    DWORD pixel;
+
+    for (c = 0; c < 4; ++c)
+    {
+        if (!info->process_channel[c])
+            continue;
+        src_offset[count] = info->srcformat->shift[c] / 8;
+        dst_shift[count] = info->destformat->shift[c];
+        ++count;
+    }
+
+    for (x = 0; x < width; ++x)
+    {
+        pixel = info->channelmask;
+        for (c = 0; c < count; ++c)
+            pixel |= (DWORD)src[src_offset[c]] << dst_shift[c];
+        memcpy(dst, &pixel, dst_bpp);
+        src += src_bpp;
+        dst += dst_bpp;
+    }
+}
+
+#ifdef SSE2_FUNC
+
+static BOOL sse2_supported(void)
+{
+#ifdef __SSE2__
+    return TRUE;
+#else
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+#endif
+}
+
+static SSE2_FUNC void convert_argb8_row_masked_sse2(const struct argb_conversion_info *info,
+        const BYTE *src, BYTE *dst, UINT width)
+{
+    __m128i mask = _mm_setzero_si128(), fill = _mm_set1_epi32(info->channelmask);
+    unsigned int c, x;
+
+    for (c = 0; c < 4; ++c)
+    {
+        if (info->process_channel[c])
+            mask = _mm_or_si128(mask, _mm_set1_epi32(info->destmask[c]));
+    }
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        _mm_storeu_si128((__m128i *)(dst + x * 4),
+                _mm_or_si128(_mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x * 4)), mask), fill));
+    }
+
+    convert_argb8_row_masked(info, src + x * 4, dst + x * 4, width - x);
+}
+
+/* 4 bytes per pixel on both sides only. */
+static SSE2_FUNC void convert_argb8_row_shuffle_sse2(const struct argb_conversion_info *info,
+        const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i byte = _mm_set1_epi32(0xff), fill = _mm_set1_epi32(info->channelmask);
+    __m128i src_shift[4], dst_shift[4], pixels, out;
+    unsigned int c, x, count = 0;
+
+    for (c = 0; c < 4; ++c)
+    {
+        if (!info->process_channel[c])
+            continue;
+        src_shift[count] = _mm_cvtsi32_si128(info->srcformat->shift[c]);
+        dst_shift[count] = _mm_cvtsi32_si128(info->destformat->shift[c]);
+        ++count;
+    }
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        pixels = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        out = fill;
+        for (c = 0; c < count; ++c)
+            out = _mm_or_si128(out, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(pixels, src_shift[c]), byte),
+                    dst_shift[c]));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), out);
+    }
+
+    convert_argb8_row_shuffle(info, src + x * 4, dst + x * 4, width - x);
+}
+
+#endif  /* SSE2_FUNC */
+
+static argb_row_conversion_func get_argb_row_conversion(const struct argb_conversion_info *info)
+{
+    const struct pixel_format_desc *src_format = info->srcformat, *dst_format = info->destformat;
+    argb_row_conversion_func shuffle = convert_argb8_row_shuffle, masked = convert_argb8_row_masked;
+    unsigned int c;
+
+    if (!format_has_byte_components(src_format) || !format_has_byte_components(dst_format))
+        return NULL;
+
+    if (src_format->bytes_per_pixel != 4 || dst_format->bytes_per_pixel != 4)
+        return convert_argb8_row_shuffle;
+
+#ifdef SSE2_FUNC
+    if (sse2_supported())
+    {
+        shuffle = convert_argb8_row_shuffle_sse2;
+        masked = convert_argb8_row_masked_sse2;
+    }
+#endif
+
+    for (c = 0; c < 4; ++c)
+    {
+        if (info->process_channel[c] && src_format->shift[c] != dst_format->shift[c])
+            return shuffle;
+    }
+
+    return masked;
+}
+
 /* It doesn't work for components bigger than 32 bits (or somewhat smaller but unaligned). */
 static void format_to_vec4(const struct pixel_format_desc *format, const BYTE *src, struct vec4 *dst)
 {
@@ -1532,12 +1714,15 @@ void convert_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pit
 {
     struct argb_conversion_info conv_info, ck_conv_info;
     const struct pixel_format_desc *ck_format = NULL;
+    argb_row_conversion_func convert_row = NULL;
     DWORD channels[4];
     UINT min_width, min_height, min_depth;
     UINT x, y, z;
 
     ZeroMemory(channels, sizeof(channels));
     init_argb_conversion_info(src_format, dst_format, &conv_info);
+    if (!color_key)
+        convert_row = get_argb_row_conversion(&conv_info);
 
     min_width = min(src_size->width, dst_size->width);
     min_height = min(src_size->height, dst_size->height);
@@ -1558,7 +1743,13 @@ void convert_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pit
             const BYTE *src_ptr = src_slice_ptr + y * src_row_pitch;
             BYTE *dst_ptr = dst_slice_ptr + y * dst_row_pitch;
 
-            for (x = 0; x < min_width; x++) {
+            if (convert_row)
+            {
+                convert_row(&conv_info, src_ptr, dst_ptr, min_width);
+                dst_ptr += min_width * dst_format->bytes_per_pixel;
+            }
+
+            for (x = convert_row ? min_width : 0; x < min_width; x++) {
                 if (!src_format->to_rgba && !dst_format->from_rgba
                         && src_format->type == dst_format->type
                         && src_format->bytes_per_pixel <= 4 && dst_format->bytes_per_pixel <= 4)
@@ -1621,17 +1812,10 @@ void convert_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pit
         memset(dst + src_size->depth * dst_slice_pitch, 0, dst_slice_pitch * (dst_size->depth - src_size->depth));
 }
 
-/************************************************************
- * point_filter_argb_pixels
- *
- * Copies the source buffer to the destination buffer, performing
- * any necessary format conversion, color keying and stretching
- * using a point filter.
- */
-void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pitch, const struct volume *src_size,
+static void point_filter_argb_rows(const BYTE *src, UINT src_row_pitch, UINT src_slice_pitch, const struct volume *src_size,
         const struct pixel_format_desc *src_format, BYTE *dst, UINT dst_row_pitch, UINT dst_slice_pitch,
         const struct volume *dst_size, const struct pixel_format_desc *dst_format, D3DCOLOR color_key,
-        const PALETTEENTRY *palette)
+        const PALETTEENTRY *palette, UINT first_row, UINT end_row)
 {
     struct argb_conversion_info conv_info, ck_conv_info;
     const struct pixel_format_desc *ck_format = NULL;
@@ -1653,7 +1837,7 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
         BYTE *dst_slice_ptr = dst + z * dst_slice_pitch;
         const BYTE *src_slice_ptr = src + src_slice_pitch * (z * src_size->depth / dst_size->depth);
 
-        for (y = 0; y < dst_size->height; y++)
+        for (y = first_row; y < end_row; y++)
         {
             BYTE *dst_ptr = dst_slice_ptr + y * dst_row_pitch;
             const BYTE *src_row_ptr = src_slice_ptr + src_row_pitch * (y * src_size->height / dst_size->height);
@@ -1715,6 +1899,182 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
     }
 }
 
+/************************************************************
+ * point_filter_argb_pixels
+ *
+ * Copies the source buffer to the destination buffer, performing
+ * any necessary format conversion, color keying and stretching
+ * using a point filter.
+ */
+void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pitch, const struct volume *src_size,
+        const struct pixel_format_desc *src_format, BYTE *dst, UINT dst_row_pitch, UINT dst_slice_pitch,
+        const struct volume *dst_size, const struct pixel_format_desc *dst_format, D3DCOLOR color_key,
+        const PALETTEENTRY *palette)
+{
+    point_filter_argb_rows(src, src_row_pitch, src_slice_pitch, src_size, src_format,
+            dst, dst_row_pitch, dst_slice_pitch, dst_size, dst_format, color_key, palette,
+            0, dst_size->height);
+}
+
+/* Surfaces with at least this many destination pixels are converted in
+ * horizontal bands on the thread pool. Every destination row only depends on
+ * the source data and the conversion parameters, so the bands are
+ * independent of each other. */
+#define D3DX_PARALLEL_MIN_PIXELS (256 * 256)
+#define D3DX_PARALLEL_MIN_BAND_ROWS 32
+#define D3DX_PARALLEL_MAX_BANDS 16
+
+struct surface_conversion_job
+{
+    const BYTE *src;
+    UINT src_pitch;
+    const struct volume *src_size;
+    const struct pixel_format_desc *src_format;
+    BYTE *dst;
+    UINT dst_pitch;
+    const struct volume *dst_size;
+    const struct pixel_format_desc *dst_format;
+    D3DCOLOR color_key;
+    const PALETTEENTRY *palette;
+    BOOL point_filter;
+
+    UINT band_rows;
+    UINT band_count;
+    LONG next_band;
+    LONG pending_workers;
+    HANDLE done_event;
+};
+
+static void surface_conversion_job_run_band(const struct surface_conversion_job *job, UINT band)
+{
+    UINT first_row = band * job->band_rows;
+    UINT end_row = min(first_row + job->band_rows, job->dst_size->height);
+    struct volume src_band_size, dst_band_size;
+
+    if (job->point_filter)
+    {
+        point_filter_argb_rows(job->src, job->src_pitch, 0, job->src_size, job->src_format,
+                job->dst, job->dst_pitch, 0, job->dst_size, job->dst_format, job->color_key, job->palette,
+                first_row, end_row);
+        return;
+    }
+
+    /* Without stretching each band maps to the same rows in the source. The
+     * caller ensures the source is at least as high as the destination. */
+    src_band_size.width = job->src_size->width;
+    src_band_size.height = end_row - first_row;
+    src_band_size.depth = 1;
+    dst_band_size = src_band_size;
+    dst_band_size.width = job->dst_size->width;
+    convert_argb_pixels(job->src + first_row * job->src_pitch, job->src_pitch, 0, &src_band_size, job->src_format,
+            job->dst + first_row * job->dst_pitch, job->dst_pitch, 0, &dst_band_size, job->dst_format,
+            job->color_key, job->palette);
+}
+
+static void surface_conversion_job_run(struct surface_conversion_job *job)
+{
+    UINT band;
+
+    while ((band = InterlockedIncrement(&job->next_band) - 1) < job->band_count)
+        surface_conversion_job_run_band(job, band);
+}
+
+static DWORD WINAPI surface_conversion_worker(void *ctx)
+{
+    struct surface_conversion_job *job = ctx;
+
+    surface_conversion_job_run(job);
+    if (!InterlockedDecrement(&job->pending_workers))
+        SetEvent(job->done_event);
+
+    return 0;
+}
+
+static unsigned int get_conversion_thread_count(void)
+{
+    static LONG thread_count;
+    SYSTEM_INFO info;
+    LONG count;
+
+    if ((count = thread_count))
+        return count;
+
+    GetSystemInfo(&info);
+    count = max(1, min(info.dwNumberOfProcessors, D3DX_PARALLEL_MAX_BANDS));
+    InterlockedExchange(&thread_count, count);
+    TRACE("Using up to %d threads for surface conversions.\n", count);
+
+    return count;
+}
+
+/* Converts a 2D surface, splitting the work across the thread pool when the
+ * destination is large enough for that to pay off. Returns FALSE when the
+ * conversion should be done on the calling thread instead. */
+static BOOL convert_surface_pixels_parallel(const BYTE *src, UINT src_pitch, const struct volume *src_size,
+        const struct pixel_format_desc *src_format, BYTE *dst, UINT dst_pitch, const struct volume *dst_size,
+        const struct pixel_format_desc *dst_format, D3DCOLOR color_key, const PALETTEENTRY *palette,
+        BOOL point_filter)
+{
+    struct surface_conversion_job job;
+    unsigned int thread_count, i;
+    UINT band_count;
+
+    if (dst_size->width * dst_size->height < D3DX_PARALLEL_MIN_PIXELS)
+        return FALSE;
+    if (!point_filter && src_size->height < dst_size->height)
+        return FALSE;
+    if ((thread_count = get_conversion_thread_count()) < 2)
+        return FALSE;
+
+    band_count = min(thread_count, dst_size->height / D3DX_PARALLEL_MIN_BAND_ROWS);
+    if (band_count < 2)
+        return FALSE;
+
+    job.src = src;
+    job.src_pitch = src_pitch;
+    job.src_size = src_size;
+    job.src_format = src_format;
+    job.dst = dst;
+    job.dst_pitch = dst_pitch;
+    job.dst_size = dst_size;
+    job.dst_format = dst_format;
+    job.color_key = color_key;
+    job.palette = palette;
+    job.point_filter = point_filter;
+    job.band_rows = (dst_size->height + band_count - 1) / band_count;
+    job.band_count = (dst_size->height + job.band_rows - 1) / job.band_rows;
+    job.next_band = 0;
+    job.pending_workers = job.band_count - 1;
+    if (!(job.done_event = CreateEventW(NULL, TRUE, FALSE, NULL)))
+        return FALSE;
+
+    TRACE("Converting %ux%u surface in %u bands of %u rows.\n",
+            dst_size->width, dst_size->height, job.band_count, job.band_rows);
+
+    /* The calling thread takes part in the conversion as well, so one worker
+     * less than there are bands is enough. */
+    for (i = 1; i < job.band_count; ++i)
+    {
+        if (!QueueUserWorkItem(surface_conversion_worker, &job, WT_EXECUTEDEFAULT))
+        {
+            LONG unqueued = job.band_count - i;
+
+            WARN("Failed to queue conversion work item.\n");
+            if (InterlockedExchangeAdd(&job.pending_workers, -unqueued) == unqueued)
+                SetEvent(job.done_event);
+            break;
+        }
+    }
+
+    surface_conversion_job_run(&job);
+    /* The job lives on our stack, wait for every queued worker to let go of
+     * it, even if it didn't get to process a band. */
+    WaitForSingleObject(job.done_event, INFINITE);
+    CloseHandle(job.done_event);
+
+    return TRUE;
+}
+
 /************************************************************
  * D3DXLoadSurfaceFromMemory
  *
@@ -1849,8 +2209,10 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
 
         if ((filter & 0xf) == D3DX_FILTER_NONE)
         {
-            convert_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
-                    lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
+            if (!convert_surface_pixels_parallel(src_memory, src_pitch, &src_size, srcformatdesc,
+                    lockrect.pBits, lockrect.Pitch, &dst_size, destformatdesc, color_key, src_palette, FALSE))
+                convert_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
+                        lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
         }
         else /* if ((filter & 0xf) == D3DX_FILTER_POINT) */
         {
@@ -1859,8 +2221,10 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
 
             /* Always apply a point filter until D3DX_FILTER_LINEAR,
              * D3DX_FILTER_TRIANGLE and D3DX_FILTER_BOX are implemented. */
-            point_filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
-                    lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
+            if (!convert_surface_pixels_parallel(src_memory, src_pitch, &src_size, srcformatdesc,
+                    lockrect.pBits, lockrect.Pitch, &dst_size, destformatdesc, color_key, src_palette, TRUE))
+                point_filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
+                        lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
         }
 
         IDirect3DSurface9_UnlockRect(dst_surface);
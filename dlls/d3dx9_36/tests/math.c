@@ -2356,6 +2356,12 @@ static void test_D3DXVec_Array(void)
     D3DXVec4TransformArray(out_vec + 1, sizeof(D3DXVECTOR4), inp_vec, sizeof(D3DXVECTOR4), &mat, ARRAY_SIZE);
     compare_vectors(exp_vec, out_vec);
 
+    /* In place. */
+    for (i = 0; i < ARRAY_SIZE; ++i)
+        out_vec[i + 1] = inp_vec[i];
+    D3DXVec4TransformArray(out_vec + 1, sizeof(D3DXVECTOR4), out_vec + 1, sizeof(D3DXVECTOR4), &mat, ARRAY_SIZE);
+    compare_vectors(exp_vec, out_vec);
+
     /* D3DXPlaneTransformArray */
     exp_plane[1].a = 90.0f; exp_plane[1].b = 100.0f; exp_plane[1].c = 110.0f; exp_plane[1].d = 120.0f;
     exp_plane[2].a = 82.0f; exp_plane[2].b = 92.0f;  exp_plane[2].c = 102.0f; exp_plane[2].d = 112.0f;
@@ -10557,6 +10557,319 @@ static void test_optimize_faces(void)
     "faces when using 16-bit indices. Got %x\n, expected D3DERR_INVALIDCALL\n", hr);
 }
 
+/* Average number of post-transform cache misses per face, using a FIFO cache. */
+static float compute_acmr(const WORD *indices, DWORD num_faces)
+{
+    WORD cache[16];
+    unsigned int cache_count = 0, next = 0, misses = 0, i, j;
+
+    for (i = 0; i < num_faces * 3; ++i)
+    {
+        for (j = 0; j < cache_count; ++j)
+        {
+            if (cache[j] == indices[i])
+                break;
+        }
+        if (j < cache_count)
+            continue;
+
+        ++misses;
+        if (cache_count < ARRAY_SIZE(cache))
+        {
+            cache[cache_count++] = indices[i];
+        }
+        else
+        {
+            cache[next] = indices[i];
+            next = (next + 1) % ARRAY_SIZE(cache);
+        }
+    }
+
+    return (float)misses / num_faces;
+}
+
+static void test_optimize_vertex_cache(void)
+{
+    static const unsigned int grid_size = 16;
+    DWORD num_faces = grid_size * grid_size * 2, num_vertices = (grid_size + 1) * (grid_size + 1);
+    struct test_context *test_context;
+    DWORD *adjacency, *face_remap;
+    D3DXVECTOR3 *vertices;
+    WORD *indices, *old_indices;
+    float old_acmr, new_acmr;
+    ID3DXMesh *mesh;
+    unsigned int i, j, x, y, seed = 12345;
+    BOOL *face_seen;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+
+    hr = D3DXCreateMeshFVF(num_faces, num_vertices, D3DXMESH_MANAGED, D3DFVF_XYZ,
+            test_context->device, &mesh);
+    ok(hr == D3D_OK, "Failed to create mesh, hr %#x.\n", hr);
+
+    hr = mesh->lpVtbl->LockVertexBuffer(mesh, 0, (void **)&vertices);
+    ok(hr == D3D_OK, "Failed to lock vertex buffer, hr %#x.\n", hr);
+    for (y = 0; y <= grid_size; ++y)
+    {
+        for (x = 0; x <= grid_size; ++x)
+        {
+            vertices[y * (grid_size + 1) + x].x = x;
+            vertices[y * (grid_size + 1) + x].y = y;
+            vertices[y * (grid_size + 1) + x].z = 0.0f;
+        }
+    }
+    mesh->lpVtbl->UnlockVertexBuffer(mesh);
+
+    old_indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*old_indices));
+    for (y = 0, i = 0; y < grid_size; ++y)
+    {
+        for (x = 0; x < grid_size; ++x)
+        {
+            WORD v = y * (grid_size + 1) + x;
+
+            old_indices[i++] = v;
+            old_indices[i++] = v + 1;
+            old_indices[i++] = v + grid_size + 1;
+            old_indices[i++] = v + 1;
+            old_indices[i++] = v + grid_size + 2;
+            old_indices[i++] = v + grid_size + 1;
+        }
+    }
+    /* Shuffle the faces. */
+    for (i = num_faces - 1; i > 0; --i)
+    {
+        WORD tmp[3];
+
+        seed = seed * 1103515245 + 12345;
+        j = (seed >> 16) % (i + 1);
+        memcpy(tmp, &old_indices[i * 3], sizeof(tmp));
+        memcpy(&old_indices[i * 3], &old_indices[j * 3], sizeof(tmp));
+        memcpy(&old_indices[j * 3], tmp, sizeof(tmp));
+    }
+    old_acmr = compute_acmr(old_indices, num_faces);
+
+    hr = mesh->lpVtbl->LockIndexBuffer(mesh, 0, (void **)&indices);
+    ok(hr == D3D_OK, "Failed to lock index buffer, hr %#x.\n", hr);
+    memcpy(indices, old_indices, num_faces * 3 * sizeof(*indices));
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+    adjacency = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*adjacency));
+    face_remap = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_remap));
+    face_seen = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_faces * sizeof(*face_seen));
+    hr = mesh->lpVtbl->GenerateAdjacency(mesh, 0.0f, adjacency);
+    ok(hr == D3D_OK, "Failed to generate adjacency, hr %#x.\n", hr);
+
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_IGNOREVERTS,
+            adjacency, NULL, face_remap, NULL);
+    ok(hr == D3D_OK, "Failed to optimize mesh, hr %#x.\n", hr);
+
+    hr = mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&indices);
+    ok(hr == D3D_OK, "Failed to lock index buffer, hr %#x.\n", hr);
+    for (i = 0; i < num_faces; ++i)
+    {
+        const WORD *old_face, *new_face = &indices[i * 3];
+
+        ok(face_remap[i] < num_faces && !face_seen[face_remap[i]],
+                "Got unexpected face remap %u for face %u.\n", face_remap[i], i);
+        if (face_remap[i] >= num_faces || face_seen[face_remap[i]])
+            break;
+        face_seen[face_remap[i]] = TRUE;
+
+        /* The winding order has to be kept, the first vertex may change. */
+        old_face = &old_indices[face_remap[i] * 3];
+        for (j = 0; j < 3; ++j)
+        {
+            if (new_face[0] == old_face[j] && new_face[1] == old_face[(j + 1) % 3]
+                    && new_face[2] == old_face[(j + 2) % 3])
+                break;
+        }
+        ok(j < 3, "Face %u {%u, %u, %u} doesn't match old face %u {%u, %u, %u}.\n",
+                i, new_face[0], new_face[1], new_face[2],
+                face_remap[i], old_face[0], old_face[1], old_face[2]);
+    }
+    new_acmr = compute_acmr(indices, num_faces);
+    ok(new_acmr < old_acmr * 0.5f, "Got unexpected ACMR %.8e, ACMR before optimizing %.8e.\n",
+            new_acmr, old_acmr);
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+    HeapFree(GetProcessHeap(), 0, face_seen);
+    HeapFree(GetProcessHeap(), 0, face_remap);
+    HeapFree(GetProcessHeap(), 0, adjacency);
+    HeapFree(GetProcessHeap(), 0, old_indices);
+    mesh->lpVtbl->Release(mesh);
+    free_test_context(test_context);
+}
+
+static void test_optimize_vertex_remap(void)
+{
+    /* A strip of four faces with alternating attributes, and an unused vertex. */
+    static const WORD indices[] = {0, 1, 2,  1, 3, 2,  2, 3, 4,  3, 5, 4};
+    static const DWORD attributes[] = {1, 0, 1, 0};
+    static const DWORD adjacency[] = {-1, 1, -1,  -1, 2, 0,  1, 3, -1,  -1, -1, 2};
+    static const D3DXVECTOR3 positions[] =
+    {
+        {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f},
+        {0.0f, 2.0f, 0.0f}, {1.0f, 2.0f, 0.0f}, {5.0f, 5.0f, 0.0f},
+    };
+    /* ATTRSORT keeps the order within an attribute, and vertices are
+     * renumbered in the order the sorted faces first use them. */
+    static const WORD exp_indices[] = {0, 1, 2,  1, 3, 4,  5, 0, 2,  2, 1, 4};
+    static const DWORD exp_face_remap[] = {1, 3, 0, 2};
+    static const DWORD exp_vertex_remap[] = {1, 3, 2, 5, 4, 0, 6};
+    static const DWORD exp_adjacency[] = {-1, 3, 2,  -1, -1, 3,  -1, 0, -1,  0, 1, -1};
+    static const struct
+    {
+        DWORD flags;
+        DWORD num_vertices;
+    }
+    tests[] =
+    {
+        {D3DXMESHOPT_ATTRSORT, 7},
+        {D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_COMPACT, 6},
+        {D3DXMESHOPT_VERTEXCACHE, 7},
+        {D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_COMPACT, 6},
+    };
+    DWORD adjacency_out[ARRAY_SIZE(adjacency)], face_remap[ARRAY_SIZE(attributes)];
+    DWORD *vertex_remap, *attrib_buffer;
+    DWORD num_faces = ARRAY_SIZE(attributes);
+    struct test_context *test_context;
+    ID3DXBuffer *vertex_remap_buffer;
+    D3DXVECTOR3 *vertices;
+    WORD *mesh_indices;
+    ID3DXMesh *mesh;
+    unsigned int i, j, k, next;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        hr = D3DXCreateMeshFVF(num_faces, ARRAY_SIZE(positions), D3DXMESH_MANAGED, D3DFVF_XYZ,
+                test_context->device, &mesh);
+        ok(hr == D3D_OK, "Test %u: Failed to create mesh, hr %#x.\n", i, hr);
+
+        mesh->lpVtbl->LockVertexBuffer(mesh, 0, (void **)&vertices);
+        memcpy(vertices, positions, sizeof(positions));
+        mesh->lpVtbl->UnlockVertexBuffer(mesh);
+        mesh->lpVtbl->LockIndexBuffer(mesh, 0, (void **)&mesh_indices);
+        memcpy(mesh_indices, indices, sizeof(indices));
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+        mesh->lpVtbl->LockAttributeBuffer(mesh, 0, &attrib_buffer);
+        memcpy(attrib_buffer, attributes, sizeof(attributes));
+        mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+
+        vertex_remap_buffer = NULL;
+        hr = mesh->lpVtbl->OptimizeInplace(mesh, tests[i].flags, adjacency, adjacency_out,
+                face_remap, &vertex_remap_buffer);
+        ok(hr == D3D_OK, "Test %u: Failed to optimize mesh, hr %#x.\n", i, hr);
+        if (FAILED(hr))
+        {
+            mesh->lpVtbl->Release(mesh);
+            continue;
+        }
+
+        ok(mesh->lpVtbl->GetNumVertices(mesh) == tests[i].num_vertices,
+                "Test %u: Got unexpected vertex count %u.\n", i, mesh->lpVtbl->GetNumVertices(mesh));
+        ok(!!vertex_remap_buffer, "Test %u: Didn't get a vertex remap buffer.\n", i);
+        if (!vertex_remap_buffer)
+        {
+            mesh->lpVtbl->Release(mesh);
+            continue;
+        }
+        ok(ID3DXBuffer_GetBufferSize(vertex_remap_buffer) >= tests[i].num_vertices * sizeof(DWORD),
+                "Test %u: Got unexpected vertex remap size %u.\n", i,
+                ID3DXBuffer_GetBufferSize(vertex_remap_buffer));
+        vertex_remap = ID3DXBuffer_GetBufferPointer(vertex_remap_buffer);
+
+        mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&mesh_indices);
+        mesh->lpVtbl->LockVertexBuffer(mesh, D3DLOCK_READONLY, (void **)&vertices);
+
+        if (!(tests[i].flags & D3DXMESHOPT_VERTEXCACHE))
+        {
+            for (j = 0; j < num_faces; ++j)
+                ok(face_remap[j] == exp_face_remap[j], "Test %u: Got face remap %u for face %u, expected %u.\n",
+                        i, face_remap[j], j, exp_face_remap[j]);
+            for (j = 0; j < ARRAY_SIZE(indices); ++j)
+                ok(mesh_indices[j] == exp_indices[j], "Test %u: Got index %u at %u, expected %u.\n",
+                        i, mesh_indices[j], j, exp_indices[j]);
+            for (j = 0; j < tests[i].num_vertices; ++j)
+                ok(vertex_remap[j] == exp_vertex_remap[j], "Test %u: Got vertex remap %u for vertex %u, expected %u.\n",
+                        i, vertex_remap[j], j, exp_vertex_remap[j]);
+            for (j = 0; j < ARRAY_SIZE(adjacency); ++j)
+                ok(adjacency_out[j] == exp_adjacency[j], "Test %u: Got adjacency %#x at %u, expected %#x.\n",
+                        i, adjacency_out[j], j, exp_adjacency[j]);
+        }
+
+        /* The face order after VERTEXCACHE is not fixed, but the faces, vertices
+         * and adjacency have to stay consistent with the remap arrays. */
+        for (j = 0, next = 0; j < num_faces; ++j)
+        {
+            ok(face_remap[j] < num_faces, "Test %u: Got unexpected face remap %u.\n", i, face_remap[j]);
+            if (face_remap[j] >= num_faces)
+                break;
+
+            for (k = 0; k < 3; ++k)
+            {
+                WORD v = mesh_indices[j * 3 + k];
+                DWORD n = adjacency[face_remap[j] * 3 + k];
+
+                ok(v < tests[i].num_vertices, "Test %u: Got unexpected index %u.\n", i, v);
+                if (v >= tests[i].num_vertices)
+                    continue;
+                /* Vertices are numbered in order of first use. */
+                ok(v <= next, "Test %u: Vertex %u is used before vertex %u.\n", i, v, next);
+                if (v == next)
+                    ++next;
+                ok(vertex_remap[v] == indices[face_remap[j] * 3 + k],
+                        "Test %u: Face %u vertex %u maps to %u, expected %u.\n",
+                        i, j, k, vertex_remap[v], indices[face_remap[j] * 3 + k]);
+                ok(!memcmp(&vertices[v], &positions[indices[face_remap[j] * 3 + k]], sizeof(*vertices)),
+                        "Test %u: Face %u vertex %u has unexpected position {%.8e, %.8e, %.8e}.\n",
+                        i, j, k, vertices[v].x, vertices[v].y, vertices[v].z);
+
+                if (n == ~0u)
+                    ok(adjacency_out[j * 3 + k] == ~0u, "Test %u: Got adjacency %#x for face %u edge %u.\n",
+                            i, adjacency_out[j * 3 + k], j, k);
+                else
+                    ok(adjacency_out[j * 3 + k] < num_faces && face_remap[adjacency_out[j * 3 + k]] == n,
+                            "Test %u: Got adjacency %#x for face %u edge %u, expected old face %u.\n",
+                            i, adjacency_out[j * 3 + k], j, k, n);
+            }
+        }
+        ok(next == 6, "Test %u: Got %u used vertices.\n", i, next);
+        if (tests[i].num_vertices > 6)
+        {
+            ok(vertex_remap[6] == 6, "Test %u: Got vertex remap %u for the unused vertex.\n", i, vertex_remap[6]);
+            ok(!memcmp(&vertices[6], &positions[6], sizeof(*vertices)),
+                    "Test %u: Unused vertex has unexpected position {%.8e, %.8e, %.8e}.\n",
+                    i, vertices[6].x, vertices[6].y, vertices[6].z);
+        }
+
+        mesh->lpVtbl->UnlockVertexBuffer(mesh);
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+        mesh->lpVtbl->LockAttributeBuffer(mesh, D3DLOCK_READONLY, &attrib_buffer);
+        for (j = 0; j < num_faces; ++j)
+            ok(attrib_buffer[j] == (j < 2 ? 0 : 1), "Test %u: Got attribute %u for face %u.\n",
+                    i, attrib_buffer[j], j);
+        mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+
+        ID3DXBuffer_Release(vertex_remap_buffer);
+        mesh->lpVtbl->Release(mesh);
+    }
+
+    free_test_context(test_context);
+}
+
 static HRESULT clear_normals(ID3DXMesh *mesh)
 {
     HRESULT hr;
@@ -11217,5 +11530,7 @@ START_TEST(mesh)
     test_clone_mesh();
     test_valid_mesh();
     test_optimize_faces();
+    test_optimize_vertex_cache();
+    test_optimize_vertex_remap();
     test_compute_normals();
 }
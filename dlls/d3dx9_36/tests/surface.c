@@ -694,6 +694,8 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
     const WORD pixdata_a8l8[] = { 0xff00, 0x00ff, 0xff30, 0x7f7f };
     const DWORD pixdata_g16r16[] = { 0x07d23fbe, 0xdc7f44a4, 0xe4d8976b, 0x9a84fe89 };
     const DWORD pixdata_a8b8g8r8[] = { 0xc3394cf0, 0x235ae892, 0x09b197fd, 0x8dc32bf6 };
+    const DWORD pixdata_x8r8g8b8[] = { 0x12394cf0, 0x345ae892, 0x56b197fd, 0x78c32bf6 };
+    const BYTE pixdata_r8g8b8[] = { 0xf0, 0x4c, 0x39, 0x92, 0xe8, 0x5a, 0xfd, 0x97, 0xb1, 0xf6, 0x2b, 0xc3 };
     const DWORD pixdata_a2r10g10b10[] = { 0x57395aff, 0x5b7668fd, 0xb0d856b5, 0xff2c61d6 };
 
     hr = create_file("testdummy.bmp", noimage, sizeof(noimage));  /* invalid image */
@@ -920,6 +922,24 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
         check_pixel_4bpp(&lockrect, 1, 1, 0x8df62bc3);
         IDirect3DSurface9_UnlockRect(surf);
 
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, pixdata_x8r8g8b8, D3DFMT_X8R8G8B8, 8, NULL, &rect, D3DX_FILTER_NONE, 0);
+        ok(hr == D3D_OK, "D3DXLoadSurfaceFromMemory returned %#x, expected %#x\n", hr, D3D_OK);
+        IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        check_pixel_4bpp(&lockrect, 0, 0, 0xff394cf0);
+        check_pixel_4bpp(&lockrect, 1, 0, 0xff5ae892);
+        check_pixel_4bpp(&lockrect, 0, 1, 0xffb197fd);
+        check_pixel_4bpp(&lockrect, 1, 1, 0xffc32bf6);
+        IDirect3DSurface9_UnlockRect(surf);
+
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, pixdata_r8g8b8, D3DFMT_R8G8B8, 6, NULL, &rect, D3DX_FILTER_NONE, 0);
+        ok(hr == D3D_OK, "D3DXLoadSurfaceFromMemory returned %#x, expected %#x\n", hr, D3D_OK);
+        IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        check_pixel_4bpp(&lockrect, 0, 0, 0xff394cf0);
+        check_pixel_4bpp(&lockrect, 1, 0, 0xff5ae892);
+        check_pixel_4bpp(&lockrect, 0, 1, 0xffb197fd);
+        check_pixel_4bpp(&lockrect, 1, 1, 0xffc32bf6);
+        IDirect3DSurface9_UnlockRect(surf);
+
         hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, pixdata_a2r10g10b10, D3DFMT_A2R10G10B10, 8, NULL, &rect, D3DX_FILTER_NONE, 0);
         ok(hr == D3D_OK, "D3DXLoadSurfaceFromMemory returned %#x, expected %#x\n", hr, D3D_OK);
         IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
@@ -1225,6 +1245,46 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
         check_release((IUnknown*)surf, 0);
     }
 
+    /* Large surfaces, converted in several pieces. */
+    hr = IDirect3DDevice9_CreateOffscreenPlainSurface(device, 512, 512, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &surf, NULL);
+    if (FAILED(hr))
+        skip("Failed to create a surface, hr %#x.\n", hr);
+    else
+    {
+        unsigned int x, y, mismatch = 0;
+        DWORD *data;
+
+        data = HeapAlloc(GetProcessHeap(), 0, 512 * 512 * sizeof(*data));
+        for (y = 0; y < 512; ++y)
+        {
+            for (x = 0; x < 512; ++x)
+                data[y * 512 + x] = 0x12000000 | (y << 12) | x;
+        }
+
+        SetRect(&rect, 0, 0, 512, 512);
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, data, D3DFMT_X8R8G8B8, 512 * sizeof(*data),
+                NULL, &rect, D3DX_FILTER_NONE, 0);
+        ok(hr == D3D_OK, "D3DXLoadSurfaceFromMemory returned %#x, expected %#x.\n", hr, D3D_OK);
+
+        hr = IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        for (y = 0; y < 512; ++y)
+        {
+            const DWORD *row = (const DWORD *)((const BYTE *)lockrect.pBits + y * lockrect.Pitch);
+
+            for (x = 0; x < 512; ++x)
+            {
+                if (row[x] != (0xff000000 | (y << 12) | x) && !mismatch++)
+                    ok(0, "Got unexpected color 0x%08x at (%u, %u).\n", row[x], x, y);
+            }
+        }
+        ok(!mismatch, "Got %u mismatching pixels.\n", mismatch);
+        IDirect3DSurface9_UnlockRect(surf);
+
+        HeapFree(GetProcessHeap(), 0, data);
+        check_release((IUnknown*)surf, 0);
+    }
+
     /* cleanup */
     if(testdummy_ok) DeleteFileA("testdummy.bmp");
     if(testbitmap_ok) DeleteFileA("testbitmap.bmp");
@@ -517,6 +517,37 @@ COLORREF nulldrv_GetPixel( PHYSDEV dev, INT x, INT y )
 }
 
 
+static BOOL dc_pat_blt( DC *dc, INT left, INT top, INT width, INT height, DWORD rop )
+{
+    struct bitblt_coords dst;
+    BOOL ret;
+
+    update_dc( dc );
+
+    dst.log_x      = left;
+    dst.log_y      = top;
+    dst.log_width  = width;
+    dst.log_height = height;
+    dst.layout     = dc->layout;
+    if (rop & NOMIRRORBITMAP)
+    {
+        dst.layout |= LAYOUT_BITMAPORIENTATIONPRESERVED;
+        rop &= ~NOMIRRORBITMAP;
+    }
+    ret = !get_vis_rectangles( dc, &dst, NULL, NULL );
+
+    TRACE("dst %p log=%d,%d %dx%d phys=%d,%d %dx%d vis=%s  rop=%06x\n",
+          dc->hSelf, dst.log_x, dst.log_y, dst.log_width, dst.log_height,
+          dst.x, dst.y, dst.width, dst.height, wine_dbgstr_rect(&dst.visrect), rop );
+
+    if (!ret)
+    {
+        PHYSDEV physdev = GET_DC_PHYSDEV( dc, pPatBlt );
+        ret = physdev->funcs->pPatBlt( physdev, &dst, rop );
+    }
+    return ret;
+}
+
 /***********************************************************************
  *           PatBlt    (GDI32.@)
  */
@@ -528,33 +559,86 @@ BOOL WINAPI PatBlt( HDC hdc, INT left, INT top, INT width, INT height, DWORD rop
     if (rop_uses_src( rop )) return FALSE;
     if ((dc = get_dc_ptr( hdc )))
     {
-        struct bitblt_coords dst;
+        ret = dc_pat_blt( dc, left, top, width, height, rop );
+        release_dc_ptr( dc );
+    }
+    return ret;
+}
 
-        update_dc( dc );
 
-        dst.log_x      = left;
-        dst.log_y      = top;
-        dst.log_width  = width;
-        dst.log_height = height;
-        dst.layout     = dc->layout;
-        if (rop & NOMIRRORBITMAP)
+/* undocumented structure used by PolyPatBlt */
+typedef struct
+{
+    INT    nXLeft;
+    INT    nYLeft;
+    INT    nWidth;
+    INT    nHeight;
+    HBRUSH hBrush;
+} POLYPATBLT;
+
+/* check if a rectangle is adjacent to the right of or below another one, with the same brush */
+static inline BOOL can_merge_pat_blt( const POLYPATBLT *rect, const POLYPATBLT *next )
+{
+    if (next->hBrush != rect->hBrush) return FALSE;
+    if (rect->nWidth <= 0 || rect->nHeight <= 0 || next->nWidth <= 0 || next->nHeight <= 0) return FALSE;
+    if (next->nYLeft == rect->nYLeft && next->nHeight == rect->nHeight)
+        return next->nXLeft == rect->nXLeft + rect->nWidth;
+    if (next->nXLeft == rect->nXLeft && next->nWidth == rect->nWidth)
+        return next->nYLeft == rect->nYLeft + rect->nHeight;
+    return FALSE;
+}
+
+/***********************************************************************
+ *           PolyPatBlt    (GDI32.@)
+ *
+ * Fill a list of rectangles, each with its own brush, or with the brush
+ * selected in the DC if none is specified. The DC is only looked up once for the whole
+ * list, and runs of adjacent rectangles using the same brush are filled
+ * at once.
+ */
+BOOL WINAPI PolyPatBlt( HDC hdc, DWORD rop, const POLYPATBLT *rects, DWORD count, DWORD mode )
+{
+    HBRUSH orig_brush, brush, rect_brush;
+    POLYPATBLT rect;
+    DWORD i, j;
+    BOOL merge, ret = TRUE;
+    DC *dc;
+
+    TRACE( "%p %06x %p %u %u\n", hdc, rop, rects, count, mode );
+
+    if (rop_uses_src( rop )) return FALSE;
+    if (!(dc = get_dc_ptr( hdc ))) return FALSE;
+
+    /* merged rectangles map to the union of the individual ones unless there is a rotation */
+    merge = !dc->xformWorld2Vport.eM12 && !dc->xformWorld2Vport.eM21;
+    brush = orig_brush = dc->hBrush;
+
+    for (i = 0; i < count; i = j)
+    {
+        rect = rects[i];
+        for (j = i + 1; merge && j < count && can_merge_pat_blt( &rect, &rects[j] ); j++)
         {
-            dst.layout |= LAYOUT_BITMAPORIENTATIONPRESERVED;
-            rop &= ~NOMIRRORBITMAP;
+            if (rects[j].nYLeft == rect.nYLeft) rect.nWidth += rects[j].nWidth;
+            else rect.nHeight += rects[j].nHeight;
         }
-        ret = !get_vis_rectangles( dc, &dst, NULL, NULL );
+        if (!merge) j = i + 1;
 
-        TRACE("dst %p log=%d,%d %dx%d phys=%d,%d %dx%d vis=%s  rop=%06x\n",
-              hdc, dst.log_x, dst.log_y, dst.log_width, dst.log_height,
-              dst.x, dst.y, dst.width, dst.height, wine_dbgstr_rect(&dst.visrect), rop );
-
-        if (!ret)
+        /* entries without a brush use the brush that was selected on entry */
+        rect_brush = rect.hBrush ? rect.hBrush : orig_brush;
+        if (rect_brush != brush)
         {
-            PHYSDEV physdev = GET_DC_PHYSDEV( dc, pPatBlt );
-            ret = physdev->funcs->pPatBlt( physdev, &dst, rop );
+            if (!SelectObject( hdc, rect_brush ))
+            {
+                ret = FALSE;
+                continue;
+            }
+            brush = rect_brush;
         }
-        release_dc_ptr( dc );
+        if (!dc_pat_blt( dc, rect.nXLeft, rect.nYLeft, rect.nWidth, rect.nHeight, rop )) ret = FALSE;
     }
+
+    if (brush != orig_brush) SelectObject( hdc, orig_brush );
+    release_dc_ptr( dc );
     return ret;
 }
 
@@ -22,6 +22,7 @@
 
 #include "gdi_private.h"
 #include "dibdrv.h"
+#include "winreg.h"
 
 #include "wine/debug.h"
 
@@ -581,19 +582,142 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* Large operations can optionally be split into horizontal bands rendered in
+ * parallel. This is enabled by setting the "RenderThreads" value of the
+ * HKCU\Software\Wine\GDI key to the number of threads to use. */
+
+#define MAX_RENDER_THREADS 16
+#define MIN_BAND_PIXELS    (256 * 1024)  /* don't bother splitting anything smaller */
+#define MIN_BAND_HEIGHT    16
+
+typedef BOOL (*band_func)( void *ctx, const RECT *rect );
+
+struct band_work
+{
+    band_func func;
+    void     *ctx;
+    RECT      rect;     /* band to render */
+    BOOL      ret;
+    LONG     *pending;  /* number of bands still being rendered */
+    HANDLE    done;     /* signaled once all the bands are done */
+};
+
+static int get_render_threads(void)
+{
+    static LONG render_threads = -1;
+    LONG ret = render_threads;
+
+    if (ret == -1)
+    {
+        char buffer[16];
+        DWORD type, size = sizeof(buffer);
+        HKEY hkey;
+
+        ret = 0;
+        if (!RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\GDI", &hkey ))
+        {
+            if (!RegQueryValueExA( hkey, "RenderThreads", NULL, &type, (BYTE *)buffer, &size ))
+            {
+                if (type == REG_DWORD) ret = *(DWORD *)buffer;
+                else if (type == REG_SZ) ret = atoi( buffer );
+            }
+            RegCloseKey( hkey );
+        }
+        ret = max( 0, min( ret, MAX_RENDER_THREADS ));
+        if (ret > 1) TRACE( "using %d render threads\n", ret );
+        render_threads = ret;
+    }
+    return ret;
+}
+
+static DWORD CALLBACK band_thread_proc( void *arg )
+{
+    struct band_work *work = arg;
+
+    work->ret = work->func( work->ctx, &work->rect );
+    if (!InterlockedDecrement( work->pending )) SetEvent( work->done );
+    return 0;
+}
+
+/* render a rectangle, splitting it into bands if it's large enough */
+static BOOL render_in_bands( const RECT *rect, band_func func, void *ctx )
+{
+    struct band_work work[MAX_RENDER_THREADS];
+    int i, count = get_render_threads();
+    int width = rect->right - rect->left, height = rect->bottom - rect->top;
+    LONG pending;
+    BOOL ret = TRUE;
+
+    if (count > 1 && width * height >= MIN_BAND_PIXELS)
+        count = min( count, height / MIN_BAND_HEIGHT );
+    if (count <= 1) return func( ctx, rect );
+
+    pending = count;
+    for (i = 0; i < count; i++)
+    {
+        work[i].func        = func;
+        work[i].ctx         = ctx;
+        work[i].rect.left   = rect->left;
+        work[i].rect.right  = rect->right;
+        work[i].rect.top    = rect->top + height * i / count;
+        work[i].rect.bottom = rect->top + height * (i + 1) / count;
+        work[i].pending     = &pending;
+        work[i].done        = 0;
+    }
+    if (!(work[0].done = CreateEventW( NULL, TRUE, FALSE, NULL ))) return func( ctx, rect );
+    for (i = 1; i < count; i++)
+    {
+        work[i].done = work[0].done;
+        if (!QueueUserWorkItem( band_thread_proc, &work[i], WT_EXECUTEDEFAULT ))
+            band_thread_proc( &work[i] );
+    }
+    band_thread_proc( &work[0] );
+
+    WaitForSingleObject( work[0].done, INFINITE );
+    CloseHandle( work[0].done );
+    for (i = 0; i < count; i++) ret = ret && work[i].ret;
+    return ret;
+}
+
+struct blend_band_params
+{
+    const dib_info *dst;
+    const dib_info *src;
+    POINT           origin;  /* source position of the top-left corner of the rectangle */
+    RECT            rect;
+    BLENDFUNCTION   blend;
+};
+
+static BOOL blend_band( void *ctx, const RECT *rect )
+{
+    struct blend_band_params *params = ctx;
+    POINT origin;
+
+    origin.x = params->origin.x;
+    origin.y = params->origin.y + rect->top - params->rect.top;
+    params->dst->funcs->blend_rect( params->dst, rect, params->src, &origin, params->blend );
+    return TRUE;
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT origin;
+    struct blend_band_params params;
     struct clipped_rects clipped_rects;
     int i;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+    params.dst   = dst;
+    params.src   = src;
+    params.blend = blend;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        params.origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
+        params.origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
+        params.rect = clipped_rects.rects[i];
+        /* bands can't be rendered in parallel if they may read each other's output */
+        if (src->bits.ptr == dst->bits.ptr) blend_band( &params, &params.rect );
+        else render_in_bands( &params.rect, blend_band, &params );
     }
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -678,16 +802,34 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+struct gradient_band_params
+{
+    const dib_info  *dib;
+    const TRIVERTEX *v;
+    int              mode;
+};
+
+static BOOL gradient_band( void *ctx, const RECT *rect )
+{
+    struct gradient_band_params *params = ctx;
+
+    return params->dib->funcs->gradient_rect( params->dib, rect, params->v, params->mode );
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
     int i;
     struct clipped_rects clipped_rects;
+    struct gradient_band_params params;
     BOOL ret = TRUE;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
+    params.dib  = dib;
+    params.v    = v;
+    params.mode = mode;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        if (!(ret = render_in_bands( &clipped_rects.rects[i], gradient_band, &params ))) break;
     }
     free_clipped_rects( &clipped_rects );
     return ret;
@@ -1189,6 +1331,140 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+/* HALFTONE stretching: area averaging when shrinking, bilinear filtering when enlarging.
+ * Each destination pixel along an axis is a weighted sum of a fixed number of source
+ * pixels, with weights in 1/HALFTONE_ONE units adding up to exactly HALFTONE_ONE. */
+
+#define HALFTONE_SHIFT 12
+#define HALFTONE_ONE   (1 << HALFTONE_SHIFT)
+
+struct halftone_tap
+{
+    int          pos;     /* source coordinate */
+    unsigned int weight;
+};
+
+static inline int clamp_coord( int pos, int min_pos, int max_pos )
+{
+    return max( min_pos, min( pos, max_pos - 1 ));
+}
+
+static struct halftone_tap *get_halftone_taps( int dst_start, int dst_len, int dst_vis_start, int dst_vis_end,
+                                               int src_start, int src_len, int src_vis_start, int src_vis_end,
+                                               int *ret_count )
+{
+    struct halftone_tap *taps, *tap;
+    int i, j, count, d;
+
+    count = (src_len > dst_len) ? (src_len + dst_len - 1) / dst_len + 1 : 2;
+    if (!(taps = HeapAlloc( GetProcessHeap(), 0, (dst_vis_end - dst_vis_start) * count * sizeof(*taps) )))
+        return NULL;
+
+    for (d = dst_vis_start, tap = taps; d < dst_vis_end; d++, tap += count)
+    {
+        LONGLONG pos, end;
+        unsigned int total = 0;
+
+        i = d - dst_start;
+        if (src_len > dst_len)
+        {
+            /* average the source pixels covered by [pos, end) */
+            pos = (LONGLONG)i * src_len * HALFTONE_ONE / dst_len;
+            end = (LONGLONG)(i + 1) * src_len * HALFTONE_ONE / dst_len;
+            for (j = 0; j < count; j++)
+            {
+                LONGLONG pix_start = ((pos >> HALFTONE_SHIFT) + j) << HALFTONE_SHIFT;
+                LONGLONG start = max( pos, pix_start ), stop = min( end, pix_start + HALFTONE_ONE );
+
+                tap[j].pos = clamp_coord( src_start + (int)(pix_start >> HALFTONE_SHIFT),
+                                          src_vis_start, src_vis_end );
+                tap[j].weight = (stop > start) ? (stop - start) * HALFTONE_ONE / (end - pos) : 0;
+                total += tap[j].weight;
+            }
+        }
+        else
+        {
+            /* interpolate between the two source pixels around the center of the destination pixel */
+            pos = (LONGLONG)(2 * i + 1) * src_len * HALFTONE_ONE / (2 * dst_len) - HALFTONE_ONE / 2;
+            tap[0].pos = clamp_coord( src_start + (int)(pos >> HALFTONE_SHIFT), src_vis_start, src_vis_end );
+            tap[1].pos = clamp_coord( src_start + (int)(pos >> HALFTONE_SHIFT) + 1, src_vis_start, src_vis_end );
+            tap[1].weight = pos & (HALFTONE_ONE - 1);
+            tap[0].weight = HALFTONE_ONE - tap[1].weight;
+            total = HALFTONE_ONE;
+        }
+        /* make sure the weights add up exactly, rounding errors go to the first tap */
+        tap[0].weight += HALFTONE_ONE - total;
+    }
+    *ret_count = count;
+    return taps;
+}
+
+static BOOL can_halftone( const dib_info *dib )
+{
+    if (dib->bit_count == 24) return TRUE;
+    if (dib->bit_count != 32) return FALSE;
+    if (dib->compression == BI_RGB) return TRUE;
+    return (dib->red_len == 8 && dib->green_len == 8 && dib->blue_len == 8 &&
+            !(dib->red_shift % 8) && !(dib->green_shift % 8) && !(dib->blue_shift % 8));
+}
+
+static DWORD halftone_bitmapinfo( const dib_info *src_dib, const struct bitblt_coords *src,
+                                  const dib_info *dst_dib, const struct bitblt_coords *dst )
+{
+    struct halftone_tap *h_taps, *v_taps, *tap;
+    int h_count, v_count, x, y, i, c;
+    int bpp = dst_dib->bit_count / 8;
+    int width = dst->visrect.right - dst->visrect.left;
+    int src_width = src->visrect.right - src->visrect.left;
+    unsigned int *row;
+    DWORD ret = ERROR_OUTOFMEMORY;
+
+    h_taps = get_halftone_taps( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
+                                src->x, src->width, src->visrect.left, src->visrect.right, &h_count );
+    v_taps = get_halftone_taps( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
+                                src->y, src->height, src->visrect.top, src->visrect.bottom, &v_count );
+    row = HeapAlloc( GetProcessHeap(), 0, src_width * bpp * sizeof(*row) );
+    if (!h_taps || !v_taps || !row) goto done;
+
+    for (y = 0; y < dst->visrect.bottom - dst->visrect.top; y++)
+    {
+        BYTE *dst_ptr = (BYTE *)dst_dib->bits.ptr + (dst_dib->rect.top + y) * dst_dib->stride +
+                        dst_dib->rect.left * bpp;
+
+        /* vertical pass into the row buffer, in HALFTONE_ONE units */
+        memset( row, 0, src_width * bpp * sizeof(*row) );
+        for (i = 0, tap = v_taps + y * v_count; i < v_count; i++, tap++)
+        {
+            const BYTE *src_ptr;
+
+            if (!tap->weight) continue;
+            src_ptr = (const BYTE *)src_dib->bits.ptr + (src_dib->rect.top + tap->pos) * src_dib->stride +
+                      (src_dib->rect.left + src->visrect.left) * bpp;
+            for (x = 0; x < src_width * bpp; x++) row[x] += src_ptr[x] * tap->weight;
+        }
+
+        /* horizontal pass */
+        for (x = 0, tap = h_taps; x < width; x++, tap += h_count)
+        {
+            for (c = 0; c < bpp; c++)
+            {
+                unsigned int val = 1 << (2 * HALFTONE_SHIFT - 1);
+
+                for (i = 0; i < h_count; i++)
+                    val += row[(tap[i].pos - src->visrect.left) * bpp + c] * tap[i].weight;
+                dst_ptr[x * bpp + c] = val >> (2 * HALFTONE_SHIFT);
+            }
+        }
+    }
+    ret = ERROR_SUCCESS;
+
+done:
+    HeapFree( GetProcessHeap(), 0, h_taps );
+    HeapFree( GetProcessHeap(), 0, v_taps );
+    HeapFree( GetProcessHeap(), 0, row );
+    return ret;
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1211,6 +1487,13 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
     init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
 
+    if (mode == HALFTONE && can_halftone( &src_dib ) && src_dib.bit_count == dst_dib.bit_count &&
+        dst->width > 0 && dst->height > 0 && src->width > 0 && src->height > 0)
+    {
+        if ((ret = halftone_bitmapinfo( &src_dib, src, &dst_dib, dst ))) return ret;
+        goto done;
+    }
+
     /* v */
     ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
                                   src->y, src->height, src->visrect.top, src->visrect.bottom,
@@ -1295,6 +1578,7 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
         }
     }
 
+done:
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
     src->x -= src->visrect.left;
@@ -20,6 +20,7 @@
 
 #include <assert.h>
 #include "gdi_private.h"
+#include "winreg.h"
 #include "dibdrv.h"
 
 #include "wine/unicode.h"
@@ -43,27 +44,63 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+/* identifies the font actually realized for a cached font in the shared glyph cache,
+ * independently of the fonts installed in each process; unused bytes are zero */
+struct shared_font_key
+{
+    WCHAR  face_name[LF_FACESIZE];                          /* realized face name */
+    BYTE   tm[FIELD_OFFSET( TEXTMETRICW, tmCharSet ) + 1];  /* text metrics up to tmCharSet */
+    BYTE   lf[FIELD_OFFSET( LOGFONTW, lfFaceName )];        /* logical font without the face name */
+    XFORM  xform;
+    DWORD  checksum;                                        /* checkSumAdjustment of the head table */
+    UINT   aa_flags;
+};
+
 struct cached_font
 {
     struct list           entry;
     LONG                  ref;
     DWORD                 hash;
+    LONG                  size;      /* memory used by the cached glyphs */
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    BOOL                  shared_key_valid;
+    DWORD                 shared_hash;    /* hash of shared_key */
+    struct shared_font_key shared_key;    /* font key in the shared glyph cache */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
-static struct list font_cache = LIST_INIT( font_cache );
+/* The font cache is split in independently locked shards selected by the font hash,
+ * each one holding its fonts in most-recently used order. Glyph lookups don't take
+ * any lock, glyphs are added to a font with interlocked operations. */
+
+#define FONT_CACHE_SHARDS     16
+#define FONT_CACHE_MIN_UNUSED 2                   /* unused fonts always kept in each shard */
+#define FONT_CACHE_BUDGET     (16 * 1024 * 1024)  /* glyph memory above which unused fonts get evicted */
 
-static CRITICAL_SECTION font_cache_cs;
-static CRITICAL_SECTION_DEBUG critsect_debug =
+struct font_cache_shard
 {
-    0, 0, &font_cache_cs,
-    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
-      0, 0, { (DWORD_PTR)(__FILE__ ": font_cache_cs") }
+    CRITICAL_SECTION cs;
+    struct list      fonts;
 };
-static CRITICAL_SECTION font_cache_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+static struct font_cache_shard font_cache[FONT_CACHE_SHARDS];
+static INIT_ONCE font_cache_init_once = INIT_ONCE_STATIC_INIT;
+static LONG font_cache_size;  /* memory used by all the cached glyphs */
+
+static BOOL WINAPI init_font_cache( INIT_ONCE *once, void *param, void **context )
+{
+    unsigned int i;
+
+    for (i = 0; i < FONT_CACHE_SHARDS; i++)
+    {
+        InitializeCriticalSection( &font_cache[i].cs );
+        font_cache[i].cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": font_cache.cs");
+        list_init( &font_cache[i].fonts );
+    }
+    return TRUE;
+}
 
 
 static BOOL brush_rect( dibdrv_physdev *pdev, dib_brush *brush, const RECT *rect, HRGN clip )
@@ -552,10 +589,29 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_font( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+    InterlockedExchangeAdd( &font_cache_size, -font->size );
+    HeapFree( GetProcessHeap(), 0, font );
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr, *next;
+    struct font_cache_shard *shard;
+    UINT unused = 0;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -570,8 +626,11 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.aa_flags = aa_flags;
     font.hash = font_cache_hash( &font );
 
-    EnterCriticalSection( &font_cache_cs );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    InitOnceExecuteOnce( &font_cache_init_once, init_font_cache, NULL, NULL );
+    shard = &font_cache[font.hash % FONT_CACHE_SHARDS];
+
+    EnterCriticalSection( &shard->cs );
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
     {
         if (!font_cache_cmp( &font, ptr ))
         {
@@ -579,40 +638,33 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
             list_remove( &ptr->entry );
             goto done;
         }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
+        if (!ptr->ref) unused++;
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    /* evict the least recently used fonts that are no longer selected anywhere */
+    LIST_FOR_EACH_ENTRY_SAFE_REV( ptr, next, &shard->fonts, struct cached_font, entry )
     {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
-        }
+        if (unused <= FONT_CACHE_MIN_UNUSED && (font_cache_size <= FONT_CACHE_BUDGET || !unused)) break;
+        if (ptr->ref) continue;
         list_remove( &ptr->entry );
+        free_cached_font( ptr );
+        unused--;
     }
-    else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
+
+    if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
     {
-        LeaveCriticalSection( &font_cache_cs );
+        LeaveCriticalSection( &shard->cs );
         return NULL;
     }
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = 0;
+    ptr->shared_key_valid = FALSE;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
-    list_add_head( &font_cache, &ptr->entry );
-    LeaveCriticalSection( &font_cache_cs );
+    list_add_head( &shard->fonts, &ptr->entry );
+    LeaveCriticalSection( &shard->cs );
     TRACE( "%d %s -> %p\n", ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
     return ptr;
 }
@@ -623,7 +675,7 @@ void release_cached_font( struct cached_font *font )
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, DWORD size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -644,7 +696,12 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
             HeapFree( GetProcessHeap(), 0, ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        InterlockedExchangeAdd( &font->size, size );
+        InterlockedExchangeAdd( &font_cache_size, size );
+        ret = glyph;
+    }
     else HeapFree( GetProcessHeap(), 0, glyph );
     return ret;
 }
@@ -735,6 +792,260 @@ static int get_glyph_depth( UINT aa_flags )
 static const BYTE masks[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 static const int padding[4] = {0, 3, 2, 1};
 
+/* Optional glyph bitmap cache shared between all the processes of a session.
+ *
+ * Rasterized glyphs are stored in a ring buffer in a named shared memory
+ * section, indexed by a hash table of buckets holding the absolute position
+ * of the last glyph stored there.  Writers are serialized by a mutex and
+ * never wait for it; readers don't take any lock, they copy a glyph out and
+ * then check that the ring head didn't wrap over it in the meantime.  Old
+ * glyphs are evicted simply by being overwritten.  Everything read from the
+ * section is validated, since any process can write to it.
+ *
+ * The cache is enabled by setting HKCU\Software\Wine\GDI\SharedGlyphCacheSize
+ * to the size of the ring buffer in megabytes. */
+
+#define SHARED_GLYPH_CACHE_MAGIC   0x43594c47  /* "GLYC" */
+#define SHARED_GLYPH_CACHE_MAX     256         /* maximum size in megabytes */
+#define SHARED_GLYPH_BUCKET_BYTES  256         /* ring buffer bytes per hash bucket */
+
+struct shared_glyph_key
+{
+    struct shared_font_key font;
+    DWORD index;
+    DWORD flags;    /* ETO_GLYPH_INDEX */
+};
+
+struct shared_glyph
+{
+    DWORD                   pos;   /* absolute position of the entry in the ring */
+    DWORD                   size;  /* size of the entry including the bits */
+    struct shared_glyph_key key;
+    GLYPHMETRICS            metrics;
+    BYTE                    bits[1];
+};
+
+struct shared_glyph_cache
+{
+    DWORD magic;
+    DWORD data_size;     /* size of the ring buffer, a power of two */
+    DWORD bucket_count;
+    LONG  head;          /* absolute position of the next entry */
+    LONG  hits;
+    LONG  misses;
+    LONG  stores;
+    DWORD buckets[1];    /* followed by the ring buffer */
+};
+
+static struct shared_glyph_cache *shared_glyphs;
+static BYTE *shared_glyph_data;
+static HANDLE shared_glyph_mutex;
+static INIT_ONCE shared_glyph_init_once = INIT_ONCE_STATIC_INIT;
+
+static DWORD hash_data( const void *data, SIZE_T size, DWORD hash )
+{
+    const BYTE *ptr = data;
+
+    hash ^= 0x811c9dc5;
+    while (size--) hash = (hash ^ *ptr++) * 0x01000193;
+    return hash;
+}
+
+static DWORD get_shared_glyph_cache_size(void)
+{
+    char buffer[16];
+    DWORD type, size = sizeof(buffer), ret = 0;
+    HKEY hkey;
+
+    if (!RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\GDI", &hkey ))
+    {
+        if (!RegQueryValueExA( hkey, "SharedGlyphCacheSize", NULL, &type, (BYTE *)buffer, &size ))
+        {
+            if (type == REG_DWORD) ret = *(DWORD *)buffer;
+            else if (type == REG_SZ) ret = atoi( buffer );
+        }
+        RegCloseKey( hkey );
+    }
+    return min( ret, SHARED_GLYPH_CACHE_MAX );
+}
+
+static BOOL WINAPI init_shared_glyph_cache( INIT_ONCE *once, void *param, void **context )
+{
+    static const WCHAR mutexW[] = {'_','_','W','I','N','E','_','G','L','Y','P','H','_','M','U','T','E','X','_','_',0};
+    static const WCHAR mappingW[] = {'_','_','W','I','N','E','_','G','L','Y','P','H','_','C','A','C','H','E','_','_',0};
+    struct shared_glyph_cache *cache;
+    DWORD data_size, bucket_count, total, mb = get_shared_glyph_cache_size();
+    MEMORY_BASIC_INFORMATION info;
+    HANDLE mapping;
+
+    if (!mb) return TRUE;
+    for (data_size = 1024 * 1024; data_size * 2 <= mb * 1024 * 1024; data_size *= 2) ;
+    bucket_count = data_size / SHARED_GLYPH_BUCKET_BYTES;
+    total = FIELD_OFFSET( struct shared_glyph_cache, buckets[bucket_count] ) + data_size;
+
+    if (!(shared_glyph_mutex = CreateMutexW( NULL, FALSE, mutexW ))) return TRUE;
+    WaitForSingleObject( shared_glyph_mutex, INFINITE );
+
+    /* the section is zero-filled when created, the first process initializes the header */
+    if ((mapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, total, mappingW )))
+    {
+        if ((cache = MapViewOfFile( mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 )))
+        {
+            if (!cache->magic)
+            {
+                cache->data_size    = data_size;
+                cache->bucket_count = bucket_count;
+                cache->head         = data_size;  /* so that empty buckets never look valid */
+                cache->magic        = SHARED_GLYPH_CACHE_MAGIC;
+            }
+
+            /* another process may have created it with a different size */
+            VirtualQuery( cache, &info, sizeof(info) );
+            if (cache->magic == SHARED_GLYPH_CACHE_MAGIC &&
+                cache->data_size >= 1024 * 1024 && !(cache->data_size & (cache->data_size - 1)) &&
+                cache->bucket_count == cache->data_size / SHARED_GLYPH_BUCKET_BYTES &&
+                FIELD_OFFSET( struct shared_glyph_cache, buckets[cache->bucket_count] ) + cache->data_size <= info.RegionSize)
+            {
+                shared_glyphs = cache;
+                shared_glyph_data = (BYTE *)&cache->buckets[cache->bucket_count];
+                TRACE( "using %u bytes shared glyph cache\n", cache->data_size );
+            }
+            else
+            {
+                WARN( "invalid shared glyph cache\n" );
+                UnmapViewOfFile( cache );
+            }
+        }
+        CloseHandle( mapping );
+    }
+    ReleaseMutex( shared_glyph_mutex );
+    return TRUE;
+}
+
+/* the font key covers the face name, the metrics and the checksum of the font file,
+ * besides the logical font, transform and AA mode; it is compared in full on lookup,
+ * fonts without a head table (bitmap fonts) are only told apart by the other fields */
+static BOOL get_shared_font_key( DC *dc, struct cached_font *font )
+{
+    struct shared_font_key *key = &font->shared_key;
+    TEXTMETRICW tm;
+
+    if (font->shared_key_valid) return TRUE;
+
+    memset( key, 0, sizeof(*key) );
+    if (!GetTextFaceW( dc->hSelf, LF_FACESIZE, key->face_name )) return FALSE;
+    if (!GetTextMetricsW( dc->hSelf, &tm )) return FALSE;
+    memcpy( key->tm, &tm, sizeof(key->tm) );
+    memcpy( key->lf, &font->lf, sizeof(key->lf) );
+    key->xform = font->xform;
+    if (GetFontData( dc->hSelf, 0x64616568 /* head */, 8, &key->checksum,
+                     sizeof(key->checksum) ) != sizeof(key->checksum))
+        key->checksum = 0;
+    key->aa_flags = font->aa_flags;
+
+    font->shared_hash = hash_data( key, sizeof(*key), 0 );
+    font->shared_key_valid = TRUE;
+    return TRUE;
+}
+
+static inline BOOL is_shared_glyph_valid( DWORD pos, DWORD size )
+{
+    /* the entry is still there as long as the head didn't go past its start by more than a lap */
+    LONG head = InterlockedCompareExchange( &shared_glyphs->head, 0, 0 );
+    return (DWORD)head - pos <= shared_glyphs->data_size - size;
+}
+
+static DWORD *get_shared_glyph_bucket( const struct shared_glyph_key *key, DWORD font_hash )
+{
+    DWORD hash = hash_data( &key->index, sizeof(key->index) + sizeof(key->flags), font_hash );
+    return &shared_glyphs->buckets[hash % shared_glyphs->bucket_count];
+}
+
+static struct cached_glyph *get_shared_glyph( const struct shared_glyph_key *key, DWORD font_hash, DWORD *size )
+{
+    struct shared_glyph entry, *ptr;
+    struct cached_glyph *glyph;
+    DWORD pos, bits_size, offset;
+
+    pos = InterlockedCompareExchange( (LONG *)get_shared_glyph_bucket( key, font_hash ), 0, 0 );
+    offset = pos & (shared_glyphs->data_size - 1);
+    if (offset + FIELD_OFFSET( struct shared_glyph, bits ) > shared_glyphs->data_size) goto miss;
+    if (!is_shared_glyph_valid( pos, FIELD_OFFSET( struct shared_glyph, bits ))) goto miss;
+
+    ptr = (struct shared_glyph *)(shared_glyph_data + offset);
+    memcpy( &entry, ptr, FIELD_OFFSET( struct shared_glyph, bits ));
+    if (entry.pos != pos || memcmp( &entry.key, key, sizeof(*key) )) goto miss;
+    if (entry.size < FIELD_OFFSET( struct shared_glyph, bits ) || entry.size > shared_glyphs->data_size - offset)
+        goto miss;
+
+    bits_size = entry.size - FIELD_OFFSET( struct shared_glyph, bits );
+    if (entry.metrics.gmBlackBoxX > 0xffff ||
+        bits_size < (ULONGLONG)entry.metrics.gmBlackBoxY * get_dib_stride( entry.metrics.gmBlackBoxX,
+                                                                           get_glyph_depth( key->font.aa_flags )))
+        goto miss;
+
+    if (!(glyph = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct cached_glyph, bits[bits_size] ))))
+        return NULL;
+    glyph->metrics = entry.metrics;
+    memcpy( glyph->bits, ptr->bits, bits_size );
+
+    if (!is_shared_glyph_valid( pos, entry.size ))
+    {
+        HeapFree( GetProcessHeap(), 0, glyph );
+        goto miss;
+    }
+    InterlockedIncrement( &shared_glyphs->hits );
+    *size = FIELD_OFFSET( struct cached_glyph, bits[bits_size] );
+    return glyph;
+
+miss:
+    InterlockedIncrement( &shared_glyphs->misses );
+    return NULL;
+}
+
+static void put_shared_glyph( const struct shared_glyph_key *key, DWORD font_hash,
+                              const struct cached_glyph *glyph, DWORD bits_size )
+{
+    DWORD head, offset, size = (FIELD_OFFSET( struct shared_glyph, bits[bits_size] ) + 7) & ~7;
+    struct shared_glyph *entry;
+
+    if (size > shared_glyphs->data_size / 16) return;
+
+    /* don't wait, the glyph simply isn't shared if another process is storing one */
+    switch (WaitForSingleObject( shared_glyph_mutex, 0 ))
+    {
+    case WAIT_OBJECT_0:
+    case WAIT_ABANDONED:
+        break;
+    default:
+        return;
+    }
+
+    head = shared_glyphs->head;
+    offset = head & (shared_glyphs->data_size - 1);
+    if (offset + size > shared_glyphs->data_size)  /* wrap to the start of the ring */
+    {
+        head += shared_glyphs->data_size - offset;
+        offset = 0;
+    }
+    /* move the head first, so that readers of the glyphs being overwritten notice it */
+    InterlockedExchange( &shared_glyphs->head, head + size );
+
+    entry = (struct shared_glyph *)(shared_glyph_data + offset);
+    entry->pos     = head;
+    entry->size    = FIELD_OFFSET( struct shared_glyph, bits[bits_size] );
+    memcpy( &entry->key, key, sizeof(*key) );
+    entry->metrics = glyph->metrics;
+    memcpy( entry->bits, glyph->bits, bits_size );
+
+    InterlockedExchange( (LONG *)get_shared_glyph_bucket( key, font_hash ), head );
+    InterlockedIncrement( &shared_glyphs->stores );
+    ReleaseMutex( shared_glyph_mutex );
+
+    TRACE( "shared glyph cache: %u hits %u misses %u stores\n",
+           shared_glyphs->hits, shared_glyphs->misses, shared_glyphs->stores );
+}
+
 /***********************************************************************
  *         cache_glyph_bitmap
  *
@@ -754,6 +1065,19 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     int pad = 0, stride, bit_count;
     GLYPHMETRICS metrics;
     struct cached_glyph *glyph;
+    struct shared_glyph_key key;
+    BOOL shared = FALSE;
+
+    InitOnceExecuteOnce( &shared_glyph_init_once, init_shared_glyph_cache, NULL, NULL );
+    if (shared_glyphs && get_shared_font_key( dc, font ))
+    {
+        memcpy( &key.font, &font->shared_key, sizeof(key.font) );  /* including the zero padding */
+        key.index = index;
+        key.flags = flags & ETO_GLYPH_INDEX;
+        if ((glyph = get_shared_glyph( &key, font->shared_hash, &size )))
+            return add_cached_glyph( font, index, flags, glyph, size );
+        shared = TRUE;
+    }
 
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
@@ -803,7 +1127,8 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    if (shared) put_shared_glyph( &key, font->shared_hash, glyph, size );
+    return add_cached_glyph( font, index, flags, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
@@ -19,6 +19,16 @@
  */
 
 #include <assert.h>
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef __SSE2__
+#  define SSE2_FUNC
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define SSE2_FUNC __attribute__((target("sse2")))  /* selected at run time */
+# endif
+# ifdef SSE2_FUNC
+#  include <emmintrin.h>
+# endif
+#endif
 
 #include "gdi_private.h"
 #include "dibdrv.h"
@@ -4651,19 +4661,122 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+static void blend_argb_line( DWORD *dst, const DWORD *src, int len )
+{
+    int x;
+
+    for (x = 0; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+}
+
+static void blend_argb_constant_alpha_line( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x;
+
+    for (x = 0; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+}
+
+#ifdef SSE2_FUNC
+
+static BOOL sse2_supported(void)
+{
+#ifdef __SSE2__
+    return TRUE;
+#else
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+    return supported;
+#endif
+}
+
+/* divide 16-bit values by 255, rounding like the (x + 127) / 255 of the C versions */
+static inline SSE2_FUNC __m128i div255_round_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ));
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 )), _mm_srli_epi16( x, 8 )), 8 );
+}
+
+/* blend two pixels unpacked to 16-bit channels, same result as blend_argb() */
+static inline SSE2_FUNC __m128i blend_argb_sse2( __m128i dst, __m128i src )
+{
+    __m128i alpha, val;
+
+    alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+    alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    val = _mm_add_epi16( src, div255_round_sse2( _mm_mullo_epi16( dst, alpha )));
+
+    /* the channels can overflow if the source isn't premultiplied; blend_argb()
+     * combines them with b | g << 8 | r << 16 | a << 24, so do the same here */
+    val = _mm_or_si128( _mm_and_si128( val, _mm_set1_epi32( 0x0000ffff )),
+                        _mm_and_si128( _mm_srli_epi32( val, 8 ), _mm_set1_epi32( 0x00ffff00 )));
+    val = _mm_or_si128( _mm_and_si128( val, _mm_set_epi32( 0, ~0u, 0, ~0u )),
+                        _mm_and_si128( _mm_srli_epi64( val, 16 ), _mm_set_epi32( 0, 0xffff0000, 0, 0xffff0000 )));
+    return _mm_shuffle_epi32( val, _MM_SHUFFLE( 3, 3, 2, 0 ));
+}
+
+static SSE2_FUNC void blend_argb_line_sse2( DWORD *dst, const DWORD *src, int len )
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_argb_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ));
+        __m128i hi = blend_argb_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_unpacklo_epi64( lo, hi ));
+    }
+    for ( ; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+}
+
+/* same result as blend_argb_constant_alpha() */
+static SSE2_FUNC void blend_argb_constant_alpha_line_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i src_alpha = _mm_set1_epi16( alpha );
+    const __m128i dst_alpha = _mm_set1_epi16( 255 - alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), src_alpha ),
+                                    _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), dst_alpha ));
+        __m128i hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), src_alpha ),
+                                    _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), dst_alpha ));
+        _mm_storeu_si128( (__m128i *)(dst + x),
+                          _mm_packus_epi16( div255_round_sse2( lo ), div255_round_sse2( hi )));
+    }
+    for ( ; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+}
+
+#endif  /* SSE2_FUNC */
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+    void (*blend_line)( DWORD *dst, const DWORD *src, int len ) = blend_argb_line;
+    void (*blend_constant_alpha_line)( DWORD *dst, const DWORD *src, int len, DWORD alpha ) =
+        blend_argb_constant_alpha_line;
     int x, y;
 
+#ifdef SSE2_FUNC
+    if (sse2_supported())
+    {
+        blend_line = blend_argb_line_sse2;
+        blend_constant_alpha_line = blend_argb_constant_alpha_line_sse2;
+    }
+#endif
+
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+		blend_line( dst_ptr, src_ptr, rc->right - rc->left );
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
 		for (x = 0; x < rc->right - rc->left; x++)
@@ -4671,8 +4784,7 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
     }
     else if (src->compression == BI_RGB)
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+	    blend_constant_alpha_line( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
     else
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
 	    for (x = 0; x < rc->right - rc->left; x++)
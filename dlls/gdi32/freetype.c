@@ -1918,14 +1918,10 @@ static void get_family_names( FT_Face ft_face, WCHAR **name, WCHAR **english, BO
     }
 }
 
-static Family *get_family( FT_Face ft_face, BOOL vertical )
+/* takes ownership of the names */
+static Family *get_family_from_names( WCHAR *name, WCHAR *english_name )
 {
-    Family *family;
-    WCHAR *name, *english_name;
-
-    get_family_names( ft_face, &name, &english_name, vertical );
-
-    family = find_family_from_name( name );
+    Family *family = find_family_from_name( name );
 
     if (!family)
     {
@@ -1950,6 +1946,14 @@ static Family *get_family( FT_Face ft_face, BOOL vertical )
     return family;
 }
 
+static Family *get_family( FT_Face ft_face, BOOL vertical )
+{
+    WCHAR *name, *english_name;
+
+    get_family_names( ft_face, &name, &english_name, vertical );
+    return get_family_from_names( name, english_name );
+}
+
 static inline FT_Fixed get_font_version( FT_Face ft_face )
 {
     FT_Fixed version = 0;
@@ -2134,14 +2138,8 @@ static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file,
     return face;
 }
 
-static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
-                          FT_Long face_index, DWORD flags )
+static void add_face_to_family( Face *face, Family *family, DWORD flags )
 {
-    Face *face;
-    Family *family;
-
-    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
-    family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
     if (strlenW(family->FamilyName) >= LF_FACESIZE)
     {
         WARN("Ignoring %s because name is too long\n", debugstr_w(family->FamilyName));
@@ -2162,6 +2160,565 @@ static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr
     release_family( family );
 }
 
+/*
+ * Persistent font index.
+ *
+ * The registry font cache is volatile, so the first process started after
+ * the wineserver has to open every installed font with FreeType again.  To
+ * avoid that, the result of the scan is saved to a compact binary file in
+ * the prefix.  On the next cold start that file is mapped and each font file
+ * whose size and modification time are unchanged is replayed from it; only
+ * new or modified files are opened with FreeType.
+ */
+
+#define FONT_INDEX_MAGIC   0x58444e49  /* "INDX" */
+#define FONT_INDEX_VERSION 1
+
+static const char font_index_name[] = "/fontindex";
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;          /* size of the whole file */
+    DWORD lcid;          /* system locale the names were retrieved for */
+    DWORD ft_version;    /* FreeType version, it decides which fonts are accepted */
+    DWORD file_count;
+    DWORD files;         /* offset of the font_index_file array, sorted by path */
+};
+
+struct font_index_file
+{
+    DWORD    path;       /* offset of the unix file name */
+    DWORD    allow_bitmap;
+    DWORD    size[2];    /* file size, low and high part */
+    DWORD    mtime[2];   /* modification time, low and high part */
+    LONG     ret;        /* value returned by AddFontToList */
+    DWORD    face_count;
+    DWORD    faces;      /* offset of the font_index_face array */
+};
+
+struct font_index_face
+{
+    DWORD         family;    /* string offsets, 0 if not present */
+    DWORD         english;
+    DWORD         style;
+    DWORD         full;
+    LONG          face_index;
+    DWORD         flags;     /* ADDFONT_VERTICAL_FONT */
+    DWORD         ntm_flags;
+    LONG          font_version;
+    FONTSIGNATURE fs;
+    DWORD         scalable;
+    LONG          size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+    SHORT         height;
+    SHORT         width;
+    SHORT         internal_leading;
+    SHORT         pad;
+};
+
+struct index_face
+{
+    WCHAR *family;
+    WCHAR *english;
+    WCHAR *style;
+    WCHAR *full;
+    struct font_index_face data;
+};
+
+struct index_file
+{
+    char              *path;
+    DWORD              allow_bitmap;
+    ULONGLONG          size;
+    ULONGLONG          mtime;
+    LONG               ret;
+    unsigned int       face_count;
+    unsigned int       face_alloc;
+    struct index_face *faces;
+};
+
+static struct
+{
+    BOOL                            active;   /* only set while the font list is being built */
+    const struct font_index_header *header;   /* index saved by the previous scan */
+    struct index_file              *files;    /* index being built by this scan */
+    unsigned int                    count;
+    unsigned int                    alloc;
+    int                             current;  /* file currently being scanned, or -1 */
+    unsigned int                    hits;
+    unsigned int                    misses;
+} font_index = { FALSE, NULL, NULL, 0, 0, -1 };
+
+static char *get_font_index_path( const char *suffix )
+{
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!config_dir) return NULL;
+    if (!(path = HeapAlloc( GetProcessHeap(), 0, strlen(config_dir) + sizeof(font_index_name) +
+                            (suffix ? strlen(suffix) : 0) )))
+        return NULL;
+    strcpy( path, config_dir );
+    strcat( path, font_index_name );
+    if (suffix) strcat( path, suffix );
+    return path;
+}
+
+static void open_font_index(void)
+{
+    const struct font_index_header *header;
+    struct stat st;
+    char *path;
+    void *ptr;
+    int fd;
+
+    font_index.active = TRUE;
+    font_index.current = -1;
+    font_index.hits = font_index.misses = 0;
+
+    if (!(path = get_font_index_path( NULL ))) return;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) || st.st_size > 0x7fffffff)
+    {
+        close( fd );
+        return;
+    }
+    ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return;
+
+    header = ptr;
+    if (header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ||
+        header->size != st.st_size || header->lcid != GetSystemDefaultLCID() ||
+        header->ft_version != FT_SimpleVersion || header->files % sizeof(DWORD) ||
+        header->files > header->size ||
+        header->file_count > (header->size - header->files) / sizeof(struct font_index_file))
+    {
+        TRACE( "ignoring stale font index\n" );
+        munmap( ptr, st.st_size );
+        return;
+    }
+    TRACE( "mapped font index with %u files\n", header->file_count );
+    font_index.header = header;
+}
+
+static const char *get_font_index_strA( DWORD offset )
+{
+    const char *base = (const char *)font_index.header;
+
+    if (!offset || offset >= font_index.header->size) return NULL;
+    if (!memchr( base + offset, 0, font_index.header->size - offset )) return NULL;
+    return base + offset;
+}
+
+/* returns a copy of the string at offset, or NULL; fails only if the offset is invalid */
+static BOOL get_font_index_strW( DWORD offset, WCHAR **str )
+{
+    const WCHAR *ptr;
+    DWORD len, max;
+
+    *str = NULL;
+    if (!offset) return TRUE;
+    if (offset >= font_index.header->size || offset % sizeof(WCHAR)) return FALSE;
+    ptr = (const WCHAR *)((const char *)font_index.header + offset);
+    max = (font_index.header->size - offset) / sizeof(WCHAR);
+    for (len = 0; len < max; len++) if (!ptr[len]) break;
+    if (len == max) return FALSE;
+    *str = strdupW( ptr );
+    return TRUE;
+}
+
+static int compare_font_index_file( const char *path, DWORD allow_bitmap, const char *path2, DWORD allow_bitmap2 )
+{
+    int ret = strcmp( path, path2 );
+    if (!ret) ret = allow_bitmap - allow_bitmap2;
+    return ret;
+}
+
+static const struct font_index_file *find_font_index_file( const char *file, DWORD allow_bitmap )
+{
+    const struct font_index_file *files;
+    int min = 0, max, pos, res;
+    const char *path;
+
+    if (!font_index.header) return NULL;
+    files = (const struct font_index_file *)((const char *)font_index.header + font_index.header->files);
+    max = font_index.header->file_count - 1;
+    while (min <= max)
+    {
+        pos = (min + max) / 2;
+        if (!(path = get_font_index_strA( files[pos].path ))) return NULL;
+        res = compare_font_index_file( file, allow_bitmap, path, files[pos].allow_bitmap );
+        if (!res) return &files[pos];
+        if (res < 0) max = pos - 1;
+        else min = pos + 1;
+    }
+    return NULL;
+}
+
+static void free_index_face( struct index_face *face )
+{
+    HeapFree( GetProcessHeap(), 0, face->family );
+    HeapFree( GetProcessHeap(), 0, face->english );
+    HeapFree( GetProcessHeap(), 0, face->style );
+    HeapFree( GetProcessHeap(), 0, face->full );
+}
+
+static void free_index_file( struct index_file *file )
+{
+    while (file->face_count) free_index_face( &file->faces[--file->face_count] );
+    HeapFree( GetProcessHeap(), 0, file->faces );
+    HeapFree( GetProcessHeap(), 0, file->path );
+}
+
+static struct index_face *alloc_index_face( struct index_file *file )
+{
+    struct index_face *faces;
+    unsigned int alloc;
+
+    if (file->face_count == file->face_alloc)
+    {
+        alloc = max( 4, file->face_alloc * 2 );
+        if (file->faces)
+            faces = HeapReAlloc( GetProcessHeap(), 0, file->faces, alloc * sizeof(*faces) );
+        else
+            faces = HeapAlloc( GetProcessHeap(), 0, alloc * sizeof(*faces) );
+        if (!faces) return NULL;
+        file->faces = faces;
+        file->face_alloc = alloc;
+    }
+    return &file->faces[file->face_count++];
+}
+
+static struct index_file *add_font_index_file( const char *path, DWORD flags, const struct stat *st )
+{
+    struct index_file *file, *files;
+    unsigned int alloc;
+
+    if (font_index.count == font_index.alloc)
+    {
+        alloc = max( 64, font_index.alloc * 2 );
+        if (font_index.files)
+            files = HeapReAlloc( GetProcessHeap(), 0, font_index.files, alloc * sizeof(*files) );
+        else
+            files = HeapAlloc( GetProcessHeap(), 0, alloc * sizeof(*files) );
+        if (!files) return NULL;
+        font_index.files = files;
+        font_index.alloc = alloc;
+    }
+    file = &font_index.files[font_index.count];
+    if (!(file->path = HeapAlloc( GetProcessHeap(), 0, strlen(path) + 1 ))) return NULL;
+    strcpy( file->path, path );
+    file->allow_bitmap = !!(flags & ADDFONT_ALLOW_BITMAP);
+    file->size         = st->st_size;
+    file->mtime        = st->st_mtime;
+    file->ret          = 0;
+    file->face_count   = 0;
+    file->face_alloc   = 0;
+    file->faces        = NULL;
+    font_index.count++;
+    return file;
+}
+
+/* record a face created by FreeType for the file currently being scanned */
+static void add_font_index_face( const Face *face, const Family *family )
+{
+    struct index_face *index_face;
+
+    if (font_index.current == -1) return;
+    if (!(index_face = alloc_index_face( &font_index.files[font_index.current] ))) return;
+
+    index_face->family  = strdupW( family->FamilyName );
+    index_face->english = family->EnglishName ? strdupW( family->EnglishName ) : NULL;
+    index_face->style   = strdupW( face->StyleName );
+    index_face->full    = face->FullName ? strdupW( face->FullName ) : NULL;
+    memset( &index_face->data, 0, sizeof(index_face->data) );
+    index_face->data.face_index       = face->face_index;
+    index_face->data.flags            = face->flags & ADDFONT_VERTICAL_FONT;
+    index_face->data.ntm_flags        = face->ntmFlags;
+    index_face->data.font_version     = face->font_version;
+    index_face->data.fs               = face->fs;
+    index_face->data.scalable         = face->scalable;
+    index_face->data.height           = face->size.height;
+    index_face->data.width            = face->size.width;
+    index_face->data.size             = face->size.size;
+    index_face->data.x_ppem           = face->size.x_ppem;
+    index_face->data.y_ppem           = face->size.y_ppem;
+    index_face->data.internal_leading = face->size.internal_leading;
+}
+
+static Face *create_face_from_index( const struct index_face *index_face, const char *file,
+                                     const struct stat *st, DWORD flags )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+    if (!face) return NULL;
+    face->refcount         = 1;
+    face->StyleName        = strdupW( index_face->style );
+    face->FullName         = index_face->full ? strdupW( index_face->full ) : NULL;
+    face->file             = towstr( CP_UNIXCP, file );
+    face->dev              = st->st_dev;
+    face->ino              = st->st_ino;
+    face->font_data_ptr    = NULL;
+    face->font_data_size   = 0;
+    face->face_index       = index_face->data.face_index;
+    face->fs               = index_face->data.fs;
+    face->ntmFlags         = index_face->data.ntm_flags;
+    face->font_version     = index_face->data.font_version;
+    face->scalable         = index_face->data.scalable;
+    face->size.height      = index_face->data.height;
+    face->size.width       = index_face->data.width;
+    face->size.size        = index_face->data.size;
+    face->size.x_ppem      = index_face->data.x_ppem;
+    face->size.y_ppem      = index_face->data.y_ppem;
+    face->size.internal_leading = index_face->data.internal_leading;
+
+    if (!HIWORD( flags )) flags |= ADDFONT_AA_FLAGS( default_aa_flags );
+    face->flags            = flags;
+    face->family           = NULL;
+    face->cached_enum_data = NULL;
+    return face;
+}
+
+/* copy an entry of the mapped index into the index being built */
+static struct index_file *copy_font_index_file( const struct font_index_file *entry, const char *path,
+                                                DWORD flags, const struct stat *st )
+{
+    const struct font_index_face *faces;
+    struct index_face *index_face;
+    struct index_file *file;
+    unsigned int i;
+
+    if (entry->faces % sizeof(DWORD) || entry->faces > font_index.header->size ||
+        entry->face_count > (font_index.header->size - entry->faces) / sizeof(*faces))
+        return NULL;
+    faces = (const struct font_index_face *)((const char *)font_index.header + entry->faces);
+
+    if (!(file = add_font_index_file( path, flags, st ))) return NULL;
+    file->ret = entry->ret;
+    for (i = 0; i < entry->face_count; i++)
+    {
+        if (!(index_face = alloc_index_face( file ))) break;
+        index_face->data = faces[i];
+        if (!get_font_index_strW( faces[i].family, &index_face->family ) ||
+            !get_font_index_strW( faces[i].english, &index_face->english ) ||
+            !get_font_index_strW( faces[i].style, &index_face->style ) ||
+            !get_font_index_strW( faces[i].full, &index_face->full ) ||
+            !index_face->family || !index_face->style)
+        {
+            free_index_face( index_face );
+            file->face_count--;
+            break;
+        }
+    }
+    if (i < entry->face_count)
+    {
+        WARN( "corrupted font index entry for %s\n", debugstr_a(path) );
+        free_index_file( file );
+        font_index.count--;
+        return NULL;
+    }
+    return file;
+}
+
+/* add the faces of a font file from the index, returns FALSE if the file needs to be scanned */
+static BOOL add_faces_from_index( const char *path, DWORD flags, const struct stat *st, INT *ret )
+{
+    const struct font_index_file *entry;
+    const struct index_file *file;
+    unsigned int i;
+
+    if (!(entry = find_font_index_file( path, !!(flags & ADDFONT_ALLOW_BITMAP) ))) return FALSE;
+    if (entry->size[0] != (DWORD)st->st_size || entry->size[1] != (DWORD)((ULONGLONG)st->st_size >> 32) ||
+        entry->mtime[0] != (DWORD)st->st_mtime || entry->mtime[1] != (DWORD)((ULONGLONG)st->st_mtime >> 32))
+        return FALSE;
+    if (!(file = copy_font_index_file( entry, path, flags, st ))) return FALSE;
+
+    for (i = 0; i < file->face_count; i++)
+    {
+        const struct index_face *index_face = &file->faces[i];
+        DWORD face_flags = flags | (index_face->data.flags & ADDFONT_VERTICAL_FONT);
+        Family *family = get_family_from_names( strdupW( index_face->family ),
+                                                index_face->english ? strdupW( index_face->english ) : NULL );
+        Face *face = create_face_from_index( index_face, path, st, face_flags );
+
+        if (!face)
+        {
+            release_family( family );
+            continue;
+        }
+        add_face_to_family( face, family, face_flags );
+    }
+    font_index.hits++;
+    *ret = file->ret;
+    return TRUE;
+}
+
+struct index_buffer
+{
+    BYTE *data;
+    DWORD size;
+    DWORD alloc;
+};
+
+static DWORD index_buffer_append( struct index_buffer *buffer, const void *data, DWORD size, DWORD align )
+{
+    DWORD offset = (buffer->size + align - 1) & ~(align - 1);
+    BYTE *ptr;
+
+    if (offset + size > buffer->alloc)
+    {
+        DWORD alloc = max( buffer->alloc * 2, offset + size );
+        if (!(ptr = HeapReAlloc( GetProcessHeap(), 0, buffer->data, alloc ))) return 0;
+        buffer->data = ptr;
+        buffer->alloc = alloc;
+    }
+    memset( buffer->data + buffer->size, 0, offset - buffer->size );
+    if (data) memcpy( buffer->data + offset, data, size );
+    buffer->size = offset + size;
+    return offset;
+}
+
+static DWORD index_buffer_add_strW( struct index_buffer *buffer, const WCHAR *str )
+{
+    if (!str) return 0;
+    return index_buffer_append( buffer, str, (strlenW(str) + 1) * sizeof(WCHAR), sizeof(WCHAR) );
+}
+
+static int compare_index_files( const void *a, const void *b )
+{
+    const struct index_file *file1 = a, *file2 = b;
+    return compare_font_index_file( file1->path, file1->allow_bitmap, file2->path, file2->allow_bitmap );
+}
+
+static BOOL write_font_index(void)
+{
+    struct font_index_header header;
+    struct font_index_file *entries;
+    struct index_buffer buffer;
+    unsigned int i, j, count = font_index.count;
+    char *path, *tmp_path;
+    char suffix[20];
+    BOOL ret = FALSE;
+    int fd;
+
+    buffer.alloc = 65536;
+    buffer.size = 0;
+    if (!(buffer.data = HeapAlloc( GetProcessHeap(), 0, buffer.alloc ))) return FALSE;
+
+    index_buffer_append( &buffer, NULL, sizeof(header), sizeof(DWORD) );
+    header.files = index_buffer_append( &buffer, NULL, count * sizeof(*entries), sizeof(DWORD) );
+    if (count && !header.files) goto done;
+
+    for (i = 0; i < count; i++)
+    {
+        struct index_file *file = &font_index.files[i];
+        struct font_index_file entry;
+
+        entry.path = index_buffer_append( &buffer, file->path, strlen(file->path) + 1, 1 );
+        entry.allow_bitmap = file->allow_bitmap;
+        entry.size[0]  = (DWORD)file->size;
+        entry.size[1]  = (DWORD)(file->size >> 32);
+        entry.mtime[0] = (DWORD)file->mtime;
+        entry.mtime[1] = (DWORD)(file->mtime >> 32);
+        entry.ret = file->ret;
+        entry.face_count = file->face_count;
+        for (j = 0; j < file->face_count; j++)
+        {
+            struct index_face *face = &file->faces[j];
+            face->data.family  = index_buffer_add_strW( &buffer, face->family );
+            face->data.english = index_buffer_add_strW( &buffer, face->english );
+            face->data.style   = index_buffer_add_strW( &buffer, face->style );
+            face->data.full    = index_buffer_add_strW( &buffer, face->full );
+        }
+        entry.faces = index_buffer_append( &buffer, NULL, file->face_count * sizeof(struct font_index_face),
+                                           sizeof(DWORD) );
+        if (!entry.path || (file->face_count && !entry.faces)) goto done;
+        for (j = 0; j < file->face_count; j++)
+            memcpy( buffer.data + entry.faces + j * sizeof(struct font_index_face),
+                    &file->faces[j].data, sizeof(struct font_index_face) );
+        memcpy( buffer.data + header.files + i * sizeof(entry), &entry, sizeof(entry) );
+    }
+
+    header.magic      = FONT_INDEX_MAGIC;
+    header.version    = FONT_INDEX_VERSION;
+    header.size       = buffer.size;
+    header.lcid       = GetSystemDefaultLCID();
+    header.ft_version = FT_SimpleVersion;
+    header.file_count = count;
+    memcpy( buffer.data, &header, sizeof(header) );
+
+    /* write to a temporary file and rename it, so that a concurrent reader never sees a partial index */
+    sprintf( suffix, ".%x", GetCurrentProcessId() );
+    if (!(path = get_font_index_path( NULL ))) goto done;
+    if ((tmp_path = get_font_index_path( suffix )))
+    {
+        if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+        {
+            ret = (write( fd, buffer.data, buffer.size ) == buffer.size);
+            close( fd );
+            if (ret) ret = !rename( tmp_path, path );
+            if (!ret) unlink( tmp_path );
+        }
+        HeapFree( GetProcessHeap(), 0, tmp_path );
+    }
+    if (!ret) WARN( "failed to write font index %s\n", debugstr_a(path) );
+    HeapFree( GetProcessHeap(), 0, path );
+
+done:
+    HeapFree( GetProcessHeap(), 0, buffer.data );
+    return ret;
+}
+
+static void close_font_index(void)
+{
+    unsigned int i, count;
+
+    TRACE( "font index: %u files reused, %u scanned\n", font_index.hits, font_index.misses );
+
+    qsort( font_index.files, font_index.count, sizeof(*font_index.files), compare_index_files );
+
+    /* the same file may be added more than once, e.g. from a font directory and from fontconfig */
+    for (i = count = 0; i < font_index.count; i++)
+    {
+        if (count && !compare_index_files( &font_index.files[count - 1], &font_index.files[i] ))
+            free_index_file( &font_index.files[i] );
+        else
+            font_index.files[count++] = font_index.files[i];
+    }
+    font_index.count = count;
+
+    /* without misses every entry comes from the old index, so it is only stale if some files went away */
+    if (font_index.misses || !font_index.header || count != font_index.header->file_count)
+        write_font_index();
+
+    for (i = 0; i < font_index.count; i++) free_index_file( &font_index.files[i] );
+    HeapFree( GetProcessHeap(), 0, font_index.files );
+    if (font_index.header) munmap( (void *)font_index.header, font_index.header->size );
+    font_index.header = NULL;
+    font_index.files = NULL;
+    font_index.count = font_index.alloc = 0;
+    font_index.active = FALSE;
+}
+
+static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
+                          FT_Long face_index, DWORD flags )
+{
+    Face *face;
+    Family *family;
+
+    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
+    family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
+    if (file) add_font_index_face( face, family );
+    add_face_to_family( face, family, flags );
+}
+
 static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_data_size,
                             FT_Long face_index, BOOL allow_bitmap )
 {
@@ -2238,36 +2795,12 @@ fail:
     return NULL;
 }
 
-static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_size, DWORD flags)
+static INT add_ft_faces( const char *file, void *font_data_ptr, DWORD font_data_size, DWORD flags )
 {
     FT_Face ft_face;
     FT_Long face_index = 0, num_faces;
     INT ret = 0;
 
-    /* we always load external fonts from files - otherwise we would get a crash in update_reg_entries */
-    assert(file || !(flags & ADDFONT_EXTERNAL_FONT));
-
-#ifdef HAVE_CARBON_CARBON_H
-    if(file)
-    {
-        char **mac_list = expand_mac_font(file);
-        if(mac_list)
-        {
-            BOOL had_one = FALSE;
-            char **cursor;
-            for(cursor = mac_list; *cursor; cursor++)
-            {
-                had_one = TRUE;
-                AddFontToList(*cursor, NULL, 0, flags);
-                HeapFree(GetProcessHeap(), 0, *cursor);
-            }
-            HeapFree(GetProcessHeap(), 0, mac_list);
-            if(had_one)
-                return 1;
-        }
-    }
-#endif /* HAVE_CARBON_CARBON_H */
-
     do {
         const DWORD FS_DBCS_MASK = FS_JISJAPAN|FS_CHINESESIMP|FS_WANSUNG|FS_CHINESETRAD|FS_JOHAB;
         FONTSIGNATURE fs;
@@ -2299,6 +2832,50 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
     return ret;
 }
 
+static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_size, DWORD flags)
+{
+    struct index_file *index_file;
+    struct stat st;
+    INT ret;
+
+    /* we always load external fonts from files - otherwise we would get a crash in update_reg_entries */
+    assert(file || !(flags & ADDFONT_EXTERNAL_FONT));
+
+#ifdef HAVE_CARBON_CARBON_H
+    if(file)
+    {
+        char **mac_list = expand_mac_font(file);
+        if(mac_list)
+        {
+            BOOL had_one = FALSE;
+            char **cursor;
+            for(cursor = mac_list; *cursor; cursor++)
+            {
+                had_one = TRUE;
+                AddFontToList(*cursor, NULL, 0, flags);
+                HeapFree(GetProcessHeap(), 0, *cursor);
+            }
+            HeapFree(GetProcessHeap(), 0, mac_list);
+            if(had_one)
+                return 1;
+        }
+    }
+#endif /* HAVE_CARBON_CARBON_H */
+
+    if (!file || !font_index.active || stat( file, &st ) == -1)
+        return add_ft_faces( file, font_data_ptr, font_data_size, flags );
+
+    if (add_faces_from_index( file, flags, &st, &ret )) return ret;
+
+    font_index.misses++;
+    if ((index_file = add_font_index_file( file, flags, &st )))
+        font_index.current = index_file - font_index.files;
+    ret = add_ft_faces( file, NULL, 0, flags );
+    if (index_file) font_index.files[font_index.current].ret = ret;
+    font_index.current = -1;
+    return ret;
+}
+
 static int remove_font_resource( const char *file, DWORD flags )
 {
     Family *family, *family_next;
@@ -4186,6 +4763,8 @@ static void init_font_list(void)
 
     delete_external_font_keys();
 
+    open_font_index();
+
     /* load the system bitmap fonts */
     load_system_fonts();
 
@@ -4310,6 +4889,8 @@ static void init_font_list(void)
         }
         RegCloseKey(hkey);
     }
+
+    close_font_index();
 }
 
 static BOOL move_to_front(const WCHAR *name)
@@ -389,7 +389,7 @@
 @ stdcall PolyBezier(long ptr long)
 @ stdcall PolyBezierTo(long ptr long)
 @ stdcall PolyDraw(long ptr ptr long)
-# @ stub PolyPatBlt
+@ stdcall PolyPatBlt(long long ptr long long)
 @ stdcall PolyPolygon(long ptr ptr long)
 @ stdcall PolyPolyline(long ptr ptr long)
 @ stdcall PolyTextOutA(long ptr long)
@@ -125,6 +125,13 @@ static inline BOOL overlapping( const RECT *r1, const RECT *r2 )
             r1->bottom > r2->top && r1->top < r2->bottom);
 }
 
+/* Check if r1 contains r2. */
+static inline BOOL contains_rect( const RECT *r1, const RECT *r2 )
+{
+    return (r1->left <= r2->left && r1->right >= r2->right &&
+            r1->top <= r2->top && r1->bottom >= r2->bottom);
+}
+
 static BOOL grow_region( WINEREGION *rgn, int size )
 {
     RECT *new_rects;
@@ -411,6 +418,7 @@ static BOOL REGION_UnionRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_SubtractRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_XorRegion(WINEREGION *d, WINEREGION *s1, WINEREGION *s2);
 static BOOL REGION_UnionRectWithRegion(const RECT *rect, WINEREGION *rgn);
+static INT REGION_Coalesce(WINEREGION *pReg, INT prevStart, INT curStart);
 
 /***********************************************************************
  *            get_region_type
@@ -1193,6 +1201,34 @@ static BOOL REGION_UnionRectWithRegion(const RECT *rect, WINEREGION *rgn)
 {
     WINEREGION region;
 
+    /* fast path for a rectangle extending the last band to the right,
+     * this is how regions are built from sorted lists of rectangles */
+    if (rgn->numRects)
+    {
+        RECT *last = &rgn->rects[rgn->numRects - 1];
+        INT cur_band, prev_band;
+
+        if (rect->top == last->top && rect->bottom == last->bottom &&
+            rect->left >= last->right && rect->left < rect->right)
+        {
+            if (rect->left == last->right) last->right = rect->right;
+            else if (!add_rect( rgn, rect->left, rect->top, rect->right, rect->bottom )) return FALSE;
+            rgn->extents.right = max( rgn->extents.right, rect->right );
+
+            /* the last band may now be identical to the previous one */
+            cur_band = rgn->numRects - 1;
+            while (cur_band > 0 && rgn->rects[cur_band - 1].top == rect->top) cur_band--;
+            if (cur_band > 0)
+            {
+                prev_band = cur_band - 1;
+                while (prev_band > 0 && rgn->rects[prev_band - 1].top == rgn->rects[cur_band - 1].top)
+                    prev_band--;
+                REGION_Coalesce( rgn, prev_band, cur_band );
+            }
+            return TRUE;
+        }
+    }
+
     init_region( &region, 1 );
     region.numRects = 1;
     region.extents = *region.rects = *rect;
@@ -1970,6 +2006,11 @@ static BOOL REGION_IntersectRegion(WINEREGION *newReg, WINEREGION *reg1,
     if ( (!(reg1->numRects)) || (!(reg2->numRects))  ||
 	(!overlapping(&reg1->extents, &reg2->extents)))
 	newReg->numRects = 0;
+    /* check for a rectangle containing the whole other region */
+    else if (reg1->numRects == 1 && contains_rect(&reg1->extents, &reg2->extents))
+        return REGION_CopyRegion(newReg, reg2);
+    else if (reg2->numRects == 1 && contains_rect(&reg2->extents, &reg1->extents))
+        return REGION_CopyRegion(newReg, reg1);
     else
 	if (!REGION_RegionOp (newReg, reg1, reg2, REGION_IntersectO, NULL, NULL)) return FALSE;
 
@@ -2072,6 +2113,47 @@ static BOOL REGION_UnionO (WINEREGION *pReg, RECT *r1, RECT *r1End,
 #undef MERGERECT
 }
 
+/***********************************************************************
+ *	     REGION_AppendRegion
+ *
+ *      Union of two regions where the lower one is entirely below the upper
+ *      one: the bands of the lower region follow those of the upper region
+ *      and only the two bands where they meet may need to be coalesced.
+ */
+static BOOL REGION_AppendRegion(WINEREGION *newReg, WINEREGION *upper, WINEREGION *lower)
+{
+    WINEREGION tmp;
+    RECT extents;
+    INT prevBand, curBand = upper->numRects;
+
+    extents.left = min(upper->extents.left, lower->extents.left);
+    extents.top = upper->extents.top;
+    extents.right = max(upper->extents.right, lower->extents.right);
+    extents.bottom = lower->extents.bottom;
+
+    if (newReg == lower)
+    {
+        if (!init_region( &tmp, upper->numRects + lower->numRects )) return FALSE;
+        memcpy( tmp.rects, upper->rects, upper->numRects * sizeof(RECT) );
+        memcpy( tmp.rects + upper->numRects, lower->rects, lower->numRects * sizeof(RECT) );
+        tmp.numRects = upper->numRects + lower->numRects;
+        move_rects( newReg, &tmp );
+    }
+    else
+    {
+        if (!REGION_CopyRegion( newReg, upper )) return FALSE;
+        if (!grow_region( newReg, upper->numRects + lower->numRects )) return FALSE;
+        memcpy( newReg->rects + upper->numRects, lower->rects, lower->numRects * sizeof(RECT) );
+        newReg->numRects = upper->numRects + lower->numRects;
+    }
+    newReg->extents = extents;
+
+    for (prevBand = curBand - 1; prevBand > 0; prevBand--)
+        if (newReg->rects[prevBand - 1].top != newReg->rects[curBand - 1].top) break;
+    REGION_Coalesce( newReg, prevBand, curBand );
+    return TRUE;
+}
+
 /***********************************************************************
  *	     REGION_UnionRegion
  */
@@ -2129,6 +2211,14 @@ static BOOL REGION_UnionRegion(WINEREGION *newReg, WINEREGION *reg1, WINEREGION
 	return ret;
     }
 
+    /*
+     * One region is entirely below the other, the bands can simply be appended
+     */
+    if (reg2->extents.top >= reg1->extents.bottom)
+        return REGION_AppendRegion(newReg, reg1, reg2);
+    if (reg1->extents.top >= reg2->extents.bottom)
+        return REGION_AppendRegion(newReg, reg2, reg1);
+
     if ((ret = REGION_RegionOp (newReg, reg1, reg2, REGION_UnionO, REGION_UnionNonO, REGION_UnionNonO)))
     {
         newReg->extents.left = min(reg1->extents.left, reg2->extents.left);
@@ -2294,6 +2384,13 @@ static BOOL REGION_SubtractRegion(WINEREGION *regD, WINEREGION *regM, WINEREGION
 	(!overlapping(&regM->extents, &regS->extents)) )
 	return REGION_CopyRegion(regD, regM);
 
+    /* check for a rectangle removing the whole region */
+    if (regS->numRects == 1 && contains_rect(&regS->extents, &regM->extents))
+    {
+        empty_region(regD);
+        return TRUE;
+    }
+
     if (!REGION_RegionOp (regD, regM, regS, REGION_SubtractO, REGION_SubtractNonO1, NULL))
         return FALSE;
 
@@ -20,6 +20,7 @@
  */
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <assert.h>
 #include <string.h>
 
@@ -30,6 +31,7 @@
 #include "winerror.h"
 #include "wingdi.h"
 #include "winuser.h"
+#include "winreg.h"
 #include "mmsystem.h"
 #include "winternl.h"
 #include "ddk/d3dkmthk.h"
@@ -41,6 +43,7 @@ static NTSTATUS (WINAPI *pD3DKMTDestroyDCFromMemory)( const D3DKMT_DESTROYDCFROM
 static BOOL (WINAPI *pGdiAlphaBlend)(HDC,int,int,int,int,HDC,int,int,int,int,BLENDFUNCTION);
 static BOOL (WINAPI *pGdiGradientFill)(HDC,TRIVERTEX*,ULONG,void*,ULONG,ULONG);
 static DWORD (WINAPI *pSetLayout)(HDC hdc, DWORD layout);
+static BOOL (WINAPI *pPolyPatBlt)(HDC,DWORD,const void*,DWORD,DWORD);
 
 static inline int get_bitmap_stride( int width, int bpp )
 {
@@ -3407,6 +3410,58 @@ static void test_StretchBlt(void)
     DeleteDC(hdcScreen);
 }
 
+
+static void test_StretchBlt_halftone(void)
+{
+    BITMAPINFO info;
+    HBITMAP bmp_src, bmp_dst, old_src, old_dst;
+    HDC hdc_src, hdc_dst;
+    DWORD *src_bits, *dst_bits;
+    int i;
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = 4;
+    info.bmiHeader.biHeight = -1;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = CreateDIBSection( 0, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( 0, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    old_src = SelectObject( hdc_src, bmp_src );
+    old_dst = SelectObject( hdc_dst, bmp_dst );
+    SetStretchBltMode( hdc_dst, HALFTONE );
+
+    /* shrinking averages the source pixels */
+    src_bits[0] = src_bits[2] = 0x000000;
+    src_bits[1] = src_bits[3] = 0xffffff;
+    memset( dst_bits, 0xcc, 4 * sizeof(DWORD) );
+    StretchBlt( hdc_dst, 0, 0, 2, 1, hdc_src, 0, 0, 4, 1, SRCCOPY );
+    for (i = 0; i < 2; i++)
+        ok( (dst_bits[i] & 0xff) >= 0x60 && (dst_bits[i] & 0xff) <= 0xa0 &&
+            (dst_bits[i] & 0xffffff) == (dst_bits[i] & 0xff) * 0x010101,
+            "%d: got %08x\n", i, dst_bits[i] );
+    ok( dst_bits[2] == 0xcccccccc, "got %08x\n", dst_bits[2] );
+
+    /* enlarging keeps the colors at the edges */
+    src_bits[0] = 0x000000;
+    src_bits[1] = 0xffffff;
+    StretchBlt( hdc_dst, 0, 0, 4, 1, hdc_src, 0, 0, 2, 1, SRCCOPY );
+    ok( (dst_bits[0] & 0xffffff) == 0x000000, "got %08x\n", dst_bits[0] );
+    ok( (dst_bits[3] & 0xffffff) == 0xffffff, "got %08x\n", dst_bits[3] );
+    ok( (dst_bits[1] & 0xff) <= (dst_bits[2] & 0xff), "got %08x %08x\n", dst_bits[1], dst_bits[2] );
+
+    SelectObject( hdc_src, old_src );
+    SelectObject( hdc_dst, old_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+}
+
 static void check_StretchDIBits_pixel(HDC hdcDst, UINT32 *dstBuffer, UINT32 *srcBuffer,
                                       DWORD dwRop, UINT32 expected, int line)
 {
@@ -3934,6 +3989,77 @@ static void test_GdiGradientFill(void)
     HeapFree(GetProcessHeap(), 0, bmi);
 }
 
+static void test_PolyPatBlt(void)
+{
+    struct
+    {
+        INT    x, y, width, height;
+        HBRUSH brush;
+    } rects[5];
+    BITMAPINFO info;
+    HBRUSH red, blue, orig;
+    HBITMAP bmp, old_bmp;
+    DWORD *bits;
+    BOOL ret;
+    HDC hdc;
+    int x, y;
+
+    if (!pPolyPatBlt)
+    {
+        win_skip( "PolyPatBlt is not implemented\n" );
+        return;
+    }
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = 8;
+    info.bmiHeader.biHeight = -8;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC( NULL );
+    bmp = CreateDIBSection( hdc, &info, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    ok( bmp != NULL, "CreateDIBSection failed\n" );
+    old_bmp = SelectObject( hdc, bmp );
+
+    red = CreateSolidBrush( RGB(0xff, 0, 0) );
+    blue = CreateSolidBrush( RGB(0, 0, 0xff) );
+    orig = SelectObject( hdc, GetStockObject( WHITE_BRUSH ) );
+
+    /* two adjacent red rectangles, a blue one, and one with the current brush */
+    rects[0].x = 0; rects[0].y = 0; rects[0].width = 4; rects[0].height = 2; rects[0].brush = red;
+    rects[1].x = 4; rects[1].y = 0; rects[1].width = 4; rects[1].height = 2; rects[1].brush = red;
+    rects[2].x = 0; rects[2].y = 2; rects[2].width = 8; rects[2].height = 2; rects[2].brush = blue;
+    rects[3].x = 0; rects[3].y = 4; rects[3].width = 8; rects[3].height = 2; rects[3].brush = NULL;
+    rects[4].x = 8; rects[4].y = 6; rects[4].width = -8; rects[4].height = 2; rects[4].brush = red;
+
+    memset( bits, 0, 8 * 8 * sizeof(DWORD) );
+    ret = pPolyPatBlt( hdc, PATCOPY, rects, 5, 0 );
+    ok( ret, "PolyPatBlt failed\n" );
+
+    for (y = 0; y < 8; y++)
+        for (x = 0; x < 8; x++)
+        {
+            DWORD expect = y < 2 ? 0xff0000 : y < 4 ? 0x0000ff : y < 6 ? 0xffffff : 0xff0000;
+            ok( bits[y * 8 + x] == expect, "%d,%d: got %08x expected %08x\n",
+                x, y, bits[y * 8 + x], expect );
+        }
+
+    ok( GetCurrentObject( hdc, OBJ_BRUSH ) == GetStockObject( WHITE_BRUSH ),
+        "current brush was not restored\n" );
+
+    ret = pPolyPatBlt( hdc, SRCCOPY, rects, 5, 0 );
+    ok( !ret, "PolyPatBlt succeeded with a source rop\n" );
+
+    SelectObject( hdc, orig );
+    SelectObject( hdc, old_bmp );
+    DeleteObject( red );
+    DeleteObject( blue );
+    DeleteObject( bmp );
+    DeleteDC( hdc );
+}
+
 static void test_clipping(void)
 {
     HBITMAP bmpDst;
@@ -4069,6 +4195,103 @@ static void test_32bit_ddb(void)
     DeleteDC(hdcScreen);
 }
 
+static BYTE blend_channel( BYTE dst, BYTE src, BYTE alpha )
+{
+    return (src * alpha + dst * (255 - alpha) + 127) / 255;
+}
+
+/* blend all the alpha values, with a width that isn't a multiple of any vector size */
+static void test_AlphaBlend_alpha_range(void)
+{
+    char buffer[sizeof(BITMAPINFOHEADER)];
+    BITMAPINFO *info = (BITMAPINFO *)buffer;
+    HBITMAP bmp_src, bmp_dst, old_src, old_dst;
+    HDC hdc_src, hdc_dst;
+    DWORD *src_bits, *dst_bits, expect;
+    BLENDFUNCTION blend;
+    const int width = 259;
+    int i, j, alpha;
+    BOOL ret;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip( "GdiAlphaBlend is not supported\n" );
+        return;
+    }
+
+    memset( info, 0, sizeof(BITMAPINFOHEADER) );
+    info->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info->bmiHeader.biWidth = width;
+    info->bmiHeader.biHeight = -1;
+    info->bmiHeader.biPlanes = 1;
+    info->bmiHeader.biBitCount = 32;
+    info->bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = CreateDIBSection( hdc_src, info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    old_src = SelectObject( hdc_src, bmp_src );
+    old_dst = SelectObject( hdc_dst, bmp_dst );
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+
+    /* per-pixel alpha, premultiplied source */
+    for (i = 0; i < width; i++)
+    {
+        BYTE a = i;
+        src_bits[i] = a << 24 | RGB( (BYTE)(i * 7) * a / 255, (BYTE)(i * 3 + 11) * a / 255,
+                                     (BYTE)(255 - i) * a / 255 );
+        dst_bits[i] = (i * 0x01030507) ^ 0x5a5a5a5a;
+    }
+    blend.SourceConstantAlpha = 255;
+    blend.AlphaFormat = AC_SRC_ALPHA;
+    ret = pGdiAlphaBlend( hdc_dst, 0, 0, width, 1, hdc_src, 0, 0, width, 1, blend );
+    ok( ret, "GdiAlphaBlend failed err %u\n", GetLastError() );
+    for (i = 0; i < width; i++)
+    {
+        DWORD src = src_bits[i], dst = (i * 0x01030507) ^ 0x5a5a5a5a;
+        BYTE a = src >> 24;
+
+        expect = 0;
+        for (j = 0; j < 32; j += 8)
+            expect |= (DWORD)((BYTE)(src >> j) + blend_channel( dst >> j, 0, a )) << j;
+        ok( dst_bits[i] == expect, "%d: got %08x, expected %08x\n", i, dst_bits[i], expect );
+    }
+
+    /* constant alpha */
+    for (alpha = 0; alpha < 256; alpha += 17)
+    {
+        for (i = 0; i < width; i++)
+        {
+            src_bits[i] = (i * 0x07050301) ^ 0xa5a5a5a5;
+            dst_bits[i] = (i * 0x01030507) ^ 0x5a5a5a5a;
+        }
+        blend.SourceConstantAlpha = alpha;
+        blend.AlphaFormat = 0;
+        ret = pGdiAlphaBlend( hdc_dst, 0, 0, width, 1, hdc_src, 0, 0, width, 1, blend );
+        ok( ret, "GdiAlphaBlend failed err %u\n", GetLastError() );
+        for (i = 0; i < width; i++)
+        {
+            DWORD src = src_bits[i], dst = (i * 0x01030507) ^ 0x5a5a5a5a;
+
+            expect = 0;
+            for (j = 0; j < 32; j += 8)
+                expect |= (DWORD)blend_channel( dst >> j, src >> j, alpha ) << j;
+            ok( dst_bits[i] == expect, "alpha %d, %d: got %08x, expected %08x\n",
+                alpha, i, dst_bits[i], expect );
+        }
+    }
+
+    SelectObject( hdc_src, old_src );
+    SelectObject( hdc_dst, old_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+}
+
 /*
  * Used by test_GetDIBits_top_down to create the bitmap to test against.
  */
@@ -5924,9 +6147,158 @@ static void test_D3DKMTCreateDCFromMemory( void )
     }
 }
 
+/* draws operations that cross the band boundaries of a 1024x512 DIB */
+static void draw_render_bands(HDC hdc, HDC src_dc, HBRUSH brush)
+{
+    static const BLENDFUNCTION blend = { AC_SRC_OVER, 0, 0x80, 0 };
+    TRIVERTEX vert[3] =
+    {
+        {    3,   1, 0xff00, 0x0000, 0x0000, 0xff00 },
+        { 1021, 130, 0x0000, 0xff00, 0x0000, 0x8000 },
+        {  290, 509, 0x0000, 0x3000, 0xff00, 0x0000 },
+    };
+    TRIVERTEX rect_vert[2] =
+    {
+        { 100,  40, 0x1200, 0x3400, 0x5600, 0xff00 },
+        { 900, 470, 0xfe00, 0xdc00, 0xba00, 0x0000 },
+    };
+    GRADIENT_TRIANGLE tri = { 0, 1, 2 };
+    GRADIENT_RECT rect = { 0, 1 };
+    HBRUSH old_brush;
+
+    SetBrushOrgEx(hdc, 3, 5, NULL);
+    old_brush = SelectObject(hdc, brush);
+    PatBlt(hdc, 0, 0, 1024, 512, PATCOPY);
+    SelectObject(hdc, old_brush);
+
+    pGdiAlphaBlend(hdc, 7, 5, 1000, 500, src_dc, 0, 0, 37, 23, blend);
+    pGdiGradientFill(hdc, vert, 3, &tri, 1, GRADIENT_FILL_TRIANGLE);
+    pGdiGradientFill(hdc, rect_vert, 2, &rect, 1, GRADIENT_FILL_RECT_V);
+}
+
+/* runs with RenderThreads set: the whole DIB is large enough to be split into
+ * bands, the 64-line strips it is compared with are not */
+static void render_bands_child(void)
+{
+    BITMAPINFO bmi;
+    HDC hdc, src_dc;
+    HBITMAP banded, strips, src_bmp, pattern;
+    HBRUSH brush;
+    HRGN rgn;
+    DWORD *banded_bits, *strips_bits, *src_bits;
+    int i, x, y, diff = 0;
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 1024;
+    bmi.bmiHeader.biHeight = -512;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC(0);
+    src_dc = CreateCompatibleDC(0);
+    banded = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&banded_bits, NULL, 0);
+    strips = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&strips_bits, NULL, 0);
+
+    bmi.bmiHeader.biWidth = 37;
+    bmi.bmiHeader.biHeight = 23;
+    src_bmp = CreateDIBSection(src_dc, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    for (y = 0; y < 23; y++)
+        for (x = 0; x < 37; x++)
+            src_bits[y * 37 + x] = (x * 7) << 16 | (y * 11) << 8 | ((x ^ y) * 5);
+    SelectObject(src_dc, src_bmp);
+
+    bmi.bmiHeader.biWidth = 8;
+    bmi.bmiHeader.biHeight = 8;
+    pattern = CreateDIBSection(0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    for (i = 0; i < 64; i++)
+        src_bits[i] = i * 0x030507;
+    brush = CreatePatternBrush(pattern);
+
+    SelectObject(hdc, banded);
+    draw_render_bands(hdc, src_dc, brush);
+
+    SelectObject(hdc, strips);
+    for (y = 0; y < 512; y += 64)
+    {
+        rgn = CreateRectRgn(0, y, 1024, y + 64);
+        SelectClipRgn(hdc, rgn);
+        DeleteObject(rgn);
+        draw_render_bands(hdc, src_dc, brush);
+    }
+    SelectClipRgn(hdc, NULL);
+    GdiFlush();
+
+    for (y = 0; y < 512; y++)
+    {
+        for (x = 0; x < 1024; x++)
+        {
+            if (banded_bits[y * 1024 + x] == strips_bits[y * 1024 + x]) continue;
+            if (!diff++)
+                ok(0, "%d,%d: got %08x, expected %08x\n", x, y,
+                   banded_bits[y * 1024 + x], strips_bits[y * 1024 + x]);
+        }
+    }
+    ok(!diff, "%d pixels differ\n", diff);
+
+    DeleteDC(hdc);
+    DeleteDC(src_dc);
+    DeleteObject(banded);
+    DeleteObject(strips);
+    DeleteObject(src_bmp);
+    DeleteObject(brush);
+    DeleteObject(pattern);
+}
+
+/* Wine can render large blends and gradients in parallel bands, the result
+ * must not depend on where the band boundaries are */
+static void test_render_bands(void)
+{
+    static const char key_name[] = "Software\\Wine\\GDI";
+    static const char value_name[] = "RenderThreads";
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    char cmd[MAX_PATH + 32], **argv;
+    DWORD threads = 4, old_threads, type, len = sizeof(old_threads);
+    BOOL had_value, ret;
+    HKEY hkey;
+
+    if (!pGdiAlphaBlend || !pGdiGradientFill)
+    {
+        win_skip("GdiAlphaBlend or GdiGradientFill not supported\n");
+        return;
+    }
+
+    if (RegCreateKeyA(HKEY_CURRENT_USER, key_name, &hkey))
+    {
+        skip("can't create the GDI registry key\n");
+        return;
+    }
+    had_value = !RegQueryValueExA(hkey, value_name, NULL, &type, (BYTE *)&old_threads, &len) &&
+                type == REG_DWORD;
+    RegSetValueExA(hkey, value_name, 0, REG_DWORD, (BYTE *)&threads, sizeof(threads));
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmd, "\"%s\" bitmap render_bands", argv[0]);
+    ret = CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess failed, error %u\n", GetLastError());
+    if (ret)
+    {
+        winetest_wait_child_process(pi.hProcess);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+
+    if (had_value) RegSetValueExA(hkey, value_name, 0, REG_DWORD, (BYTE *)&old_threads, sizeof(old_threads));
+    else RegDeleteValueA(hkey, value_name);
+    RegCloseKey(hkey);
+}
+
 START_TEST(bitmap)
 {
     HMODULE hdll;
+    char **argv;
 
     hdll = GetModuleHandleA("gdi32.dll");
     pD3DKMTCreateDCFromMemory  = (void *)GetProcAddress( hdll, "D3DKMTCreateDCFromMemory" );
@@ -5934,6 +6306,13 @@ START_TEST(bitmap)
     pGdiAlphaBlend             = (void *)GetProcAddress( hdll, "GdiAlphaBlend" );
     pGdiGradientFill           = (void *)GetProcAddress( hdll, "GdiGradientFill" );
     pSetLayout                 = (void *)GetProcAddress( hdll, "SetLayout" );
+    pPolyPatBlt                = (void *)GetProcAddress( hdll, "PolyPatBlt" );
+
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "render_bands"))
+    {
+        render_bands_child();
+        return;
+    }
 
     test_createdibitmap();
     test_dibsections();
@@ -5953,10 +6332,13 @@ START_TEST(bitmap)
     test_CreateBitmap();
     test_BitBlt();
     test_StretchBlt();
+    test_StretchBlt_halftone();
     test_StretchDIBits();
     test_GdiAlphaBlend();
     test_GdiGradientFill();
+    test_PolyPatBlt();
     test_32bit_ddb();
+    test_AlphaBlend_alpha_range();
     test_bitmapinfoheadersize();
     test_get16dibits();
     test_clipping();
@@ -5971,4 +6353,5 @@ START_TEST(bitmap)
     test_SetDIBitsToDevice();
     test_SetDIBitsToDevice_RLE8();
     test_D3DKMTCreateDCFromMemory();
+    test_render_bands();
 }
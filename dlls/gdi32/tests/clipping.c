@@ -291,6 +291,80 @@ static void test_ExtCreateRegion(void)
 
 }
 
+static void test_region_bands(void)
+{
+    union
+    {
+        RGNDATA data;
+        char buf[sizeof(RGNDATAHEADER) + 150 * sizeof(RECT)];
+    } rgn;
+    RECT rects[150], rc;
+    HRGN hrgn, hrgn2, tmp;
+    int i, j, ret;
+
+    /* a grid built row by row is coalesced into columns */
+    hrgn = CreateRectRgn(0, 0, 0, 0);
+    tmp = CreateRectRgn(0, 0, 0, 0);
+    for (i = 0; i < 50; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            SetRect(&rects[i * 3 + j], j * 20, i * 10, j * 20 + 10, i * 10 + 10);
+            SetRectRgn(tmp, j * 20, i * 10, j * 20 + 10, i * 10 + 10);
+            ret = CombineRgn(hrgn, hrgn, tmp, RGN_OR);
+            ok(ret == (i || j ? COMPLEXREGION : SIMPLEREGION), "%d,%d: got %d\n", i, j, ret);
+        }
+    }
+    ret = GetRegionData(hrgn, sizeof(rgn), &rgn.data);
+    ok(ret == sizeof(RGNDATAHEADER) + 3 * sizeof(RECT), "got %d\n", ret);
+    ok(rgn.data.rdh.nCount == 3, "expected 3 rects, got %u\n", rgn.data.rdh.nCount);
+    for (j = 0; j < 3; j++)
+    {
+        SetRect(&rc, j * 20, 0, j * 20 + 10, 500);
+        ok(EqualRect((RECT *)rgn.data.Buffer + j, &rc), "%d: got %s\n", j,
+           wine_dbgstr_rect((RECT *)rgn.data.Buffer + j));
+    }
+
+    /* same thing from a list of rectangles */
+    rgn.data.rdh.dwSize = sizeof(rgn.data.rdh);
+    rgn.data.rdh.iType = RDH_RECTANGLES;
+    rgn.data.rdh.nCount = 150;
+    rgn.data.rdh.nRgnSize = 0;
+    SetRect(&rgn.data.rdh.rcBound, 0, 0, 50, 500);
+    memcpy(rgn.data.Buffer, rects, sizeof(rects));
+    hrgn2 = ExtCreateRegion(NULL, sizeof(rgn), &rgn.data);
+    ok(hrgn2 != 0, "ExtCreateRegion error %u\n", GetLastError());
+    ok(EqualRgn(hrgn, hrgn2), "regions differ\n");
+    DeleteObject(hrgn2);
+
+    /* a region below another one is merged with it */
+    hrgn2 = CreateRectRgn(0, 500, 50, 600);
+    SetRectRgn(tmp, 0, 0, 50, 500);
+    ret = CombineRgn(tmp, tmp, hrgn2, RGN_OR);
+    ok(ret == SIMPLEREGION, "got %d\n", ret);
+    GetRgnBox(tmp, &rc);
+    ok(rc.left == 0 && rc.top == 0 && rc.right == 50 && rc.bottom == 600, "got %s\n", wine_dbgstr_rect(&rc));
+    ret = CombineRgn(hrgn2, hrgn, hrgn2, RGN_OR);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    ret = GetRegionData(hrgn2, sizeof(rgn), &rgn.data);
+    ok(rgn.data.rdh.nCount == 4, "expected 4 rects, got %u\n", rgn.data.rdh.nCount);
+
+    /* operations with a rectangle containing the whole region */
+    SetRectRgn(tmp, -10, -10, 100, 1000);
+    ret = CombineRgn(hrgn2, hrgn, tmp, RGN_AND);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    ok(EqualRgn(hrgn, hrgn2), "regions differ\n");
+    ret = CombineRgn(hrgn2, tmp, hrgn, RGN_AND);
+    ok(ret == COMPLEXREGION, "got %d\n", ret);
+    ok(EqualRgn(hrgn, hrgn2), "regions differ\n");
+    ret = CombineRgn(hrgn2, hrgn, tmp, RGN_DIFF);
+    ok(ret == NULLREGION, "got %d\n", ret);
+
+    DeleteObject(hrgn);
+    DeleteObject(hrgn2);
+    DeleteObject(tmp);
+}
+
 static void test_GetClipRgn(void)
 {
     HDC hdc;
@@ -538,6 +612,7 @@ START_TEST(clipping)
 {
     test_GetRandomRgn();
     test_ExtCreateRegion();
+    test_region_bands();
     test_GetClipRgn();
     test_memory_dc_clipping();
     test_window_dc_clipping();
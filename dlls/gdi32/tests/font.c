@@ -20,6 +20,7 @@
  */
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <assert.h>
 
 #include "windef.h"
@@ -27,6 +28,7 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winnls.h"
+#include "winreg.h"
 
 #include "wine/test.h"
 
@@ -6629,10 +6631,149 @@ static void test_bitmap_font_glyph_index(void)
     DeleteDC(hdc);
 }
 
+/* draw antialiased text into a DIB section and return a checksum of the result */
+static DWORD render_text_checksum(void)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    BITMAPINFO bmi;
+    LOGFONTA lf;
+    HDC hdc;
+    HBITMAP bmp, old_bmp;
+    HFONT font, old_font;
+    DWORD *bits, checksum = 0x811c9dc5;
+    int i;
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 400;
+    bmi.bmiHeader.biHeight = -40;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    memset(&lf, 0, sizeof(lf));
+    lf.lfHeight = -20;
+    lf.lfQuality = ANTIALIASED_QUALITY;
+    strcpy(lf.lfFaceName, "Arial");
+
+    hdc = CreateCompatibleDC(0);
+    bmp = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+    font = CreateFontIndirectA(&lf);
+    old_bmp = SelectObject(hdc, bmp);
+    old_font = SelectObject(hdc, font);
+
+    PatBlt(hdc, 0, 0, 400, 40, WHITENESS);
+    TextOutA(hdc, 2, 2, text, sizeof(text) - 1);
+    GdiFlush();
+    for (i = 0; i < 400 * 40; i++) checksum = (checksum ^ bits[i]) * 0x01000193;
+
+    SelectObject(hdc, old_font);
+    SelectObject(hdc, old_bmp);
+    DeleteObject(font);
+    DeleteObject(bmp);
+    DeleteDC(hdc);
+    return checksum;
+}
+
+static void shared_glyph_cache_child(const char *mode)
+{
+    DWORD checksum = render_text_checksum();
+
+    if (!strcmp(mode, "store"))
+    {
+        /* keep the shared section alive until the other process has looked the glyphs up */
+        HANDLE ready = OpenEventA(EVENT_MODIFY_STATE, FALSE, "wine_test_glyph_cache_ready");
+        HANDLE done = OpenEventA(SYNCHRONIZE, FALSE, "wine_test_glyph_cache_done");
+
+        SetEvent(ready);
+        WaitForSingleObject(done, 10000);
+    }
+    ExitProcess(checksum);
+}
+
+static void run_glyph_cache_child(const char *mode, PROCESS_INFORMATION *pi)
+{
+    STARTUPINFOA si = { sizeof(si) };
+    char cmd[MAX_PATH + 32], **argv;
+    BOOL ret;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmd, "\"%s\" font glyph_cache %s", argv[0], mode);
+    ret = CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL, &si, pi);
+    ok(ret, "CreateProcess failed, error %u\n", GetLastError());
+    if (!ret) memset(pi, 0, sizeof(*pi));
+}
+
+/* the DIB engine of Wine can share rasterized glyphs between processes, glyphs looked
+ * up by a second process must give the same result as rendering them directly */
+static void test_shared_glyph_cache(void)
+{
+    static const char key_name[] = "Software\\Wine\\GDI";
+    static const char value_name[] = "SharedGlyphCacheSize";
+    PROCESS_INFORMATION store, lookup;
+    HANDLE ready, done;
+    DWORD expect, code, size = 1, old_size, type, len = sizeof(old_size);
+    BOOL had_value;
+    HKEY hkey;
+
+    expect = render_text_checksum();
+
+    if (RegCreateKeyA(HKEY_CURRENT_USER, key_name, &hkey))
+    {
+        skip("can't create the GDI registry key\n");
+        return;
+    }
+    had_value = !RegQueryValueExA(hkey, value_name, NULL, &type, (BYTE *)&old_size, &len) &&
+                type == REG_DWORD;
+    RegSetValueExA(hkey, value_name, 0, REG_DWORD, (BYTE *)&size, sizeof(size));
+
+    ready = CreateEventA(NULL, TRUE, FALSE, "wine_test_glyph_cache_ready");
+    done = CreateEventA(NULL, TRUE, FALSE, "wine_test_glyph_cache_done");
+
+    run_glyph_cache_child("store", &store);
+    if (store.hProcess)
+    {
+        HANDLE handles[2] = { ready, store.hProcess };
+
+        ok(WaitForMultipleObjects(2, handles, FALSE, 10000) == WAIT_OBJECT_0, "store process didn't start\n");
+        run_glyph_cache_child("lookup", &lookup);
+        if (lookup.hProcess)
+        {
+            ok(WaitForSingleObject(lookup.hProcess, 10000) == WAIT_OBJECT_0, "lookup process didn't exit\n");
+            GetExitCodeProcess(lookup.hProcess, &code);
+            ok(code == expect, "lookup: got checksum %08x, expected %08x\n", code, expect);
+            CloseHandle(lookup.hThread);
+            CloseHandle(lookup.hProcess);
+        }
+        SetEvent(done);
+        ok(WaitForSingleObject(store.hProcess, 10000) == WAIT_OBJECT_0, "store process didn't exit\n");
+        GetExitCodeProcess(store.hProcess, &code);
+        ok(code == expect, "store: got checksum %08x, expected %08x\n", code, expect);
+        CloseHandle(store.hThread);
+        CloseHandle(store.hProcess);
+    }
+
+    CloseHandle(ready);
+    CloseHandle(done);
+    if (had_value) RegSetValueExA(hkey, value_name, 0, REG_DWORD, (BYTE *)&old_size, sizeof(old_size));
+    else RegDeleteValueA(hkey, value_name);
+    RegCloseKey(hkey);
+}
+
 START_TEST(font)
 {
+    char **argv;
+    int argc;
+
     init();
 
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 4 && !strcmp(argv[2], "glyph_cache"))
+    {
+        shared_glyph_cache_child(argv[3]);
+        return;
+    }
+
     test_stock_fonts();
     test_logfont();
     test_bitmap_font();
@@ -6691,6 +6832,7 @@ START_TEST(font)
     test_GetCharWidth32();
     test_fake_bold_font();
     test_bitmap_font_glyph_index();
+    test_shared_glyph_cache();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
@@ -130,6 +130,20 @@ BOOL CDECL __wine_send_input( HWND hwnd, const INPUT *input )
 }
 
 
+/***********************************************************************
+ *		__wine_send_inputs  (USER32.@)
+ *
+ * Internal function to allow the graphics driver to inject several real events at once.
+ */
+UINT CDECL __wine_send_inputs( HWND hwnd, const INPUT *inputs, UINT count )
+{
+    UINT sent;
+    NTSTATUS status = send_hardware_messages( hwnd, inputs, count, 0, &sent );
+    if (status) SetLastError( RtlNtStatusToDosError(status) );
+    return sent;
+}
+
+
 /***********************************************************************
  *		update_mouse_coords
  *
@@ -171,28 +185,31 @@ static void update_mouse_coords( INPUT *input )
  */
 UINT WINAPI SendInput( UINT count, LPINPUT inputs, int size )
 {
-    UINT i;
+    INPUT batch[64];
+    UINT i, pos = 0, sent, len;
     NTSTATUS status;
 
-    for (i = 0; i < count; i++)
+    while (pos < count)
     {
-        if (inputs[i].type == INPUT_MOUSE)
+        len = min( count - pos, sizeof(batch) / sizeof(batch[0]) );
+        for (i = 0; i < len; i++)
         {
+            batch[i] = inputs[pos + i];
             /* we need to update the coordinates to what the server expects */
-            INPUT input = inputs[i];
-            update_mouse_coords( &input );
-            status = send_hardware_message( 0, &input, SEND_HWMSG_INJECTED );
+            if (batch[i].type == INPUT_MOUSE) update_mouse_coords( &batch[i] );
         }
-        else status = send_hardware_message( 0, &inputs[i], SEND_HWMSG_INJECTED );
 
+        status = send_hardware_messages( 0, batch, len, SEND_HWMSG_INJECTED, &sent );
+        pos += sent;
         if (status)
         {
             SetLastError( RtlNtStatusToDosError(status) );
             break;
         }
+        if (sent < len) break;
     }
 
-    return i;
+    return pos;
 }
 
 
@@ -422,6 +439,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
  */
 DWORD WINAPI GetQueueStatus( UINT flags )
 {
+    UINT wake_bits, changed_bits, wake_mask, changed_mask;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -432,6 +450,11 @@ DWORD WINAPI GetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* no need to ask the server if there are no changed bits to clear */
+    if (get_shared_queue_bits( &wake_bits, &changed_bits, &wake_mask, &changed_mask ) &&
+        !(changed_bits & flags))
+        return MAKELONG( 0, wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -448,10 +471,14 @@ DWORD WINAPI GetQueueStatus( UINT flags )
  */
 BOOL WINAPI GetInputState(void)
 {
+    UINT wake_bits, changed_bits, wake_mask, changed_mask;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if (get_shared_queue_bits( &wake_bits, &changed_bits, &wake_mask, &changed_mask ))
+        return wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
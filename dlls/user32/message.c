@@ -2723,6 +2723,125 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/***********************************************************************
+ *           get_queue_shm
+ *
+ * Map the shared memory state of the current thread queue. Returns NULL if it's not available.
+ */
+static const queue_shm_t *get_queue_shm(void)
+{
+    static const queue_shm_t no_queue_shm;  /* marks threads without shared state */
+    static void *queue_shm_base;
+    struct user_thread_info *thread_info = get_user_thread_info();
+    obj_handle_t handle = 0;
+    unsigned int index = 0;
+
+    if (thread_info->queue_shm == &no_queue_shm) return NULL;
+    if (thread_info->queue_shm) return thread_info->queue_shm;
+
+    SERVER_START_REQ( get_queue_shm )
+    {
+        if (!wine_server_call( req ))
+        {
+            handle = reply->handle;
+            index  = reply->index;
+        }
+    }
+    SERVER_END_REQ;
+    thread_info->queue_shm = &no_queue_shm;
+    if (!handle) return NULL;
+
+    if (!queue_shm_base)
+    {
+        void *base = NULL;
+        SIZE_T size = 0;
+
+        if (!NtMapViewOfSection( wine_server_ptr_handle( handle ), GetCurrentProcess(), &base, 0, 0,
+                                 NULL, &size, ViewShare, 0, PAGE_READONLY ) &&
+            InterlockedCompareExchangePointer( &queue_shm_base, base, NULL ))
+            NtUnmapViewOfSection( GetCurrentProcess(), base );  /* another thread was faster */
+    }
+    CloseHandle( wine_server_ptr_handle( handle ));
+
+    if (!queue_shm_base) return NULL;
+    thread_info->queue_shm = (const queue_shm_t *)queue_shm_base + index;
+    return thread_info->queue_shm;
+}
+
+
+/* make sure that reads of the shared queue state are not reordered across the sequence
+ * number reads; the mapping is read-only so interlocked operations can't be used here */
+static inline void read_barrier(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "" : : : "memory" );  /* loads are not reordered with other loads */
+#else
+    __sync_synchronize();
+#endif
+}
+
+
+/***********************************************************************
+ *           get_shared_queue_bits
+ *
+ * Read a consistent snapshot of the current thread queue state without a server call.
+ */
+BOOL get_shared_queue_bits( UINT *wake_bits, UINT *changed_bits, UINT *wake_mask, UINT *changed_mask )
+{
+    const queue_shm_t *shm = get_queue_shm();
+    int seq;
+
+    if (!shm) return FALSE;
+    do
+    {
+        seq           = shm->seq;
+        read_barrier();
+        *wake_bits    = shm->wake_bits;
+        *changed_bits = shm->changed_bits;
+        *wake_mask    = shm->wake_mask;
+        *changed_mask = shm->changed_mask;
+        read_barrier();
+    } while ((seq & 1) || seq != shm->seq);
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           is_queue_empty
+ *
+ * Check from the shared queue state whether a get_message request with these
+ * parameters would fail and leave the queue unchanged, so that it can be skipped.
+ */
+static BOOL is_queue_empty( HWND hwnd, UINT first, UINT last, UINT flags, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    UINT filter = flags >> 16, clear_bits = 0;
+    UINT wake_bits, changed_bits, shm_wake_mask, shm_changed_mask;
+
+    /* the server uses the time of the last get_message to detect hung applications */
+    if (GetTickCount() - thread_info->last_getmsg_time >= 3000) return FALSE;
+    /* this sets the idle event of the process */
+    if (hwnd == (HWND)-1) return FALSE;
+
+    if (!get_shared_queue_bits( &wake_bits, &changed_bits, &shm_wake_mask, &shm_changed_mask ))
+        return FALSE;
+
+    if (!filter) filter = QS_ALLINPUT;
+    if (filter & QS_POSTMESSAGE)
+    {
+        clear_bits |= QS_POSTMESSAGE | QS_HOTKEY | QS_TIMER;
+        if (first == 0 && last == ~0U) clear_bits |= QS_ALLPOSTMESSAGE;
+    }
+    if (filter & QS_INPUT) clear_bits |= QS_INPUT;
+    if (filter & QS_PAINT) clear_bits |= QS_PAINT;
+
+    if (wake_bits & (filter | QS_SENDMESSAGE)) return FALSE;
+    if (changed_bits & clear_bits) return FALSE;
+    return (shm_wake_mask == (changed_mask & (QS_SENDMESSAGE | QS_SMRESULT)) &&
+            shm_changed_mask == changed_mask);
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2738,17 +2857,25 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
     void *buffer;
     size_t buffer_size = 256;
 
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
-
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    if (is_queue_empty( hwnd, first, last, flags, changed_mask ))
+    {
+        thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+        thread_info->changed_mask = changed_mask;
+        return FALSE;
+    }
+
+    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
+
     for (;;)
     {
         NTSTATUS res;
         size_t size = 0;
         const message_data_t *msg_data = buffer;
 
+        thread_info->last_getmsg_time = GetTickCount();
         SERVER_START_REQ( get_message )
         {
             req->flags     = flags;
@@ -3290,16 +3417,48 @@ static BOOL send_message( struct send_message_info *info, DWORD_PTR *res_ptr, BO
 
 
 /***********************************************************************
- *		send_hardware_message
+ *		get_hw_input
+ *
+ * Convert an INPUT structure to the server representation.
  */
-NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags )
+static void get_hw_input( const INPUT *input, hw_input_t *hw_input )
+{
+    memset( hw_input, 0, sizeof(*hw_input) );
+    hw_input->type = input->type;
+    switch (input->type)
+    {
+    case INPUT_MOUSE:
+        hw_input->mouse.x     = input->u.mi.dx;
+        hw_input->mouse.y     = input->u.mi.dy;
+        hw_input->mouse.data  = input->u.mi.mouseData;
+        hw_input->mouse.flags = input->u.mi.dwFlags;
+        hw_input->mouse.time  = input->u.mi.time;
+        hw_input->mouse.info  = input->u.mi.dwExtraInfo;
+        break;
+    case INPUT_KEYBOARD:
+        hw_input->kbd.vkey  = input->u.ki.wVk;
+        hw_input->kbd.scan  = input->u.ki.wScan;
+        hw_input->kbd.flags = input->u.ki.dwFlags;
+        hw_input->kbd.time  = input->u.ki.time;
+        hw_input->kbd.info  = input->u.ki.dwExtraInfo;
+        break;
+    case INPUT_HARDWARE:
+        hw_input->hw.msg    = input->u.hi.uMsg;
+        hw_input->hw.lparam = MAKELONG( input->u.hi.wParamL, input->u.hi.wParamH );
+        break;
+    }
+}
+
+
+/***********************************************************************
+ *		wait_hardware_message_reply
+ *
+ * Wait for the low-level hooks to process a hardware message.
+ */
+static void wait_hardware_message_reply( HWND hwnd )
 {
-    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
     struct send_message_info info;
-    int prev_x, prev_y, new_x, new_y;
-    INT counter = global_key_state_counter;
-    NTSTATUS ret;
-    BOOL wait;
+    LRESULT ignored;
 
     info.type     = MSG_HARDWARE;
     info.dest_tid = 0;
@@ -3307,33 +3466,27 @@ NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags )
     info.flags    = 0;
     info.timeout  = 0;
 
+    wait_message_reply( 0 );
+    retrieve_reply( &info, 0, &ignored );
+}
+
+
+/***********************************************************************
+ *		send_hardware_message
+ */
+NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags )
+{
+    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+    int prev_x, prev_y, new_x, new_y;
+    INT counter = global_key_state_counter;
+    NTSTATUS ret;
+    BOOL wait;
+
     SERVER_START_REQ( send_hardware_message )
     {
-        req->win        = wine_server_user_handle( hwnd );
-        req->flags      = flags;
-        req->input.type = input->type;
-        switch (input->type)
-        {
-        case INPUT_MOUSE:
-            req->input.mouse.x     = input->u.mi.dx;
-            req->input.mouse.y     = input->u.mi.dy;
-            req->input.mouse.data  = input->u.mi.mouseData;
-            req->input.mouse.flags = input->u.mi.dwFlags;
-            req->input.mouse.time  = input->u.mi.time;
-            req->input.mouse.info  = input->u.mi.dwExtraInfo;
-            break;
-        case INPUT_KEYBOARD:
-            req->input.kbd.vkey  = input->u.ki.wVk;
-            req->input.kbd.scan  = input->u.ki.wScan;
-            req->input.kbd.flags = input->u.ki.dwFlags;
-            req->input.kbd.time  = input->u.ki.time;
-            req->input.kbd.info  = input->u.ki.dwExtraInfo;
-            break;
-        case INPUT_HARDWARE:
-            req->input.hw.msg    = input->u.hi.uMsg;
-            req->input.hw.lparam = MAKELONG( input->u.hi.wParamL, input->u.hi.wParamH );
-            break;
-        }
+        req->win   = wine_server_user_handle( hwnd );
+        req->flags = flags;
+        get_hw_input( input, &req->input );
         if (key_state_info) wine_server_set_reply( req, key_state_info->state,
                                                    sizeof(key_state_info->state) );
         ret = wine_server_call( req );
@@ -3356,12 +3509,73 @@ NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags )
             USER_Driver->pSetCursorPos( new_x, new_y );
     }
 
-    if (wait)
+    if (wait) wait_hardware_message_reply( hwnd );
+    return ret;
+}
+
+
+/***********************************************************************
+ *		send_hardware_messages
+ *
+ * Send a batch of hardware messages with as few server calls as possible.
+ * The server stops at each message that has to wait for a low-level hook,
+ * in which case we wait for the reply and resume with the next one.
+ */
+NTSTATUS send_hardware_messages( HWND hwnd, const INPUT *inputs, UINT count, UINT flags, UINT *sent )
+{
+    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+    hw_input_t hw_inputs[64];
+    int prev_x = 0, prev_y = 0, new_x = 0, new_y = 0;
+    UINT i, pos = 0, requests = 0, queued = 0, merged = 0, dropped = 0;
+    NTSTATUS ret = STATUS_SUCCESS;
+
+    while (pos < count)
     {
-        LRESULT ignored;
-        wait_message_reply( 0 );
-        retrieve_reply( &info, 0, &ignored );
+        INT counter = global_key_state_counter;
+        UINT done, batch = min( count - pos, sizeof(hw_inputs) / sizeof(hw_inputs[0]) );
+        BOOL wait;
+
+        for (i = 0; i < batch; i++) get_hw_input( &inputs[pos + i], &hw_inputs[i] );
+
+        SERVER_START_REQ( send_hardware_messages )
+        {
+            req->win   = wine_server_user_handle( hwnd );
+            req->flags = flags;
+            wine_server_add_data( req, hw_inputs, batch * sizeof(hw_inputs[0]) );
+            if (key_state_info) wine_server_set_reply( req, key_state_info->state,
+                                                       sizeof(key_state_info->state) );
+            ret = wine_server_call( req );
+            done = reply->count;
+            wait = reply->wait;
+            queued += reply->queued;
+            merged += reply->merged;
+            dropped += reply->dropped;
+            if (!requests++)
+            {
+                prev_x = reply->prev_x;
+                prev_y = reply->prev_y;
+            }
+            new_x = reply->new_x;
+            new_y = reply->new_y;
+        }
+        SERVER_END_REQ;
+
+        if (done && key_state_info)
+        {
+            key_state_info->time    = GetTickCount();
+            key_state_info->counter = counter;
+        }
+        pos += done;
+        if (wait) wait_hardware_message_reply( hwnd );
+        if (ret || !done) break;
     }
+
+    if (pos && (flags & SEND_HWMSG_INJECTED) && (prev_x != new_x || prev_y != new_y))
+        USER_Driver->pSetCursorPos( new_x, new_y );
+
+    TRACE( "sent %u/%u inputs in %u requests, %u queued, %u merged, %u dropped\n",
+           pos, count, requests, queued, merged, dropped );
+    if (sent) *sent = pos;
     return ret;
 }
 
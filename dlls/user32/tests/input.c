@@ -1353,6 +1353,53 @@ done:
     SetCursorPos(pt_org.x, pt_org.y);
 }
 
+static int ll_hook_count;
+
+static LRESULT CALLBACK ll_count_hook_proc( int code, WPARAM wparam, LPARAM lparam )
+{
+    if (code == HC_ACTION) ll_hook_count++;
+    return CallNextHookEx( 0, code, wparam, lparam );
+}
+
+static void test_SendInput_batch(void)
+{
+    INPUT inputs[150];
+    HHOOK hook;
+    POINT pt_org, pt;
+    UINT i, ret;
+
+    GetCursorPos(&pt_org);
+    memset(inputs, 0, sizeof(inputs));
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        inputs[i].type = INPUT_MOUSE;
+        U(inputs[i]).mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE;
+        U(inputs[i]).mi.dx = 0x8000 + ((i & 1) ? 0x100 : -0x100);
+        U(inputs[i]).mi.dy = 0x8000;
+    }
+
+    ret = pSendInput(sizeof(inputs) / sizeof(inputs[0]), inputs, sizeof(INPUT));
+    ok(ret == sizeof(inputs) / sizeof(inputs[0]), "SendInput returned %u\n", ret);
+
+    if (!(hook = SetWindowsHookExA(WH_MOUSE_LL, ll_count_hook_proc, GetModuleHandleA(0), 0)))
+    {
+        win_skip( "cannot set MOUSE_LL hook\n" );
+        goto done;
+    }
+
+    /* every input has to reach the low-level hook, even when sent in one call */
+    ll_hook_count = 0;
+    ret = pSendInput(sizeof(inputs) / sizeof(inputs[0]), inputs, sizeof(INPUT));
+    ok(ret == sizeof(inputs) / sizeof(inputs[0]), "SendInput returned %u\n", ret);
+    ok(ll_hook_count == sizeof(inputs) / sizeof(inputs[0]), "got %d hook calls\n", ll_hook_count);
+
+    GetCursorPos(&pt);
+    ok(pt.y == (0x8000 * GetSystemMetrics(SM_CYSCREEN)) >> 16, "wrong y position %d\n", pt.y);
+    UnhookWindowsHookEx(hook);
+done:
+    SetCursorPos(pt_org.x, pt_org.y);
+}
+
 static void test_GetMouseMovePointsEx(void)
 {
 #define BUFLIM  64
@@ -2542,6 +2589,7 @@ START_TEST(input)
         test_Input_whitebox();
         test_Input_unicode();
         test_Input_mouse();
+        test_SendInput_batch();
     }
     else win_skip("SendInput is not available\n");
 
@@ -11385,6 +11385,114 @@ done:
     DestroyWindow(info.hwnd);
 }
 
+struct cross_thread_post
+{
+    DWORD  tid;
+    HWND   hwnd;
+    UINT   message;
+};
+
+static DWORD CALLBACK cross_thread_post_proc(void *param)
+{
+    struct cross_thread_post *post = param;
+    BOOL ret;
+
+    if (post->hwnd)
+        ret = SendNotifyMessageA(post->hwnd, post->message, 0, 0);
+    else
+        ret = PostThreadMessageA(post->tid, post->message, 0, 0);
+    ok(ret, "failed to queue message %04x, error %u\n", post->message, GetLastError());
+    return 0;
+}
+
+static void cross_thread_post(HWND hwnd, UINT message)
+{
+    struct cross_thread_post post;
+    HANDLE thread;
+
+    post.tid = GetCurrentThreadId();
+    post.hwnd = hwnd;
+    post.message = message;
+    thread = CreateThread(NULL, 0, cross_thread_post_proc, &post, 0, NULL);
+    ok(thread != NULL, "CreateThread failed, error %u\n", GetLastError());
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+/* the queue bits must follow changes made by other threads, even after
+ * PeekMessage and GetQueueStatus have already found the queue empty */
+static void test_PeekMessage_cross_thread(void)
+{
+    HWND hwnd;
+    DWORD qstatus;
+    BOOL ret;
+    MSG msg;
+
+    hwnd = CreateWindowA("TestWindowClass", NULL, WS_OVERLAPPEDWINDOW,
+                         100, 100, 200, 200, 0, 0, 0, NULL);
+    assert(hwnd);
+    flush_events();
+    flush_sequence();
+
+    qstatus = GetQueueStatus(QS_POSTMESSAGE | QS_SENDMESSAGE);
+    ok(qstatus == 0, "wrong qstatus %08x\n", qstatus);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "PeekMessageA should have returned FALSE instead of msg %04x\n", msg.message);
+
+    cross_thread_post(0, WM_USER);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE);
+    ok(qstatus == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE);
+    ok(qstatus == MAKELONG(0, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+
+    /* a second post sets the changed bit again */
+    cross_thread_post(0, WM_USER + 1);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE);
+    ok(qstatus == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+
+    msg.message = 0;
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(ret && msg.message == WM_USER, "got %d msg %04x\n", ret, msg.message);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE);
+    ok(qstatus == MAKELONG(0, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER, "got %d msg %04x\n", ret, msg.message);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "got %d msg %04x\n", ret, msg.message);
+
+    qstatus = GetQueueStatus(QS_POSTMESSAGE);
+    ok(qstatus == 0, "wrong qstatus %08x\n", qstatus);
+    msg.message = 0;
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "PeekMessageA should have returned FALSE instead of msg %04x\n", msg.message);
+
+    /* a post right after an empty PeekMessage must not be missed */
+    cross_thread_post(0, WM_USER + 2);
+    msg.message = 0;
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(ret && msg.message == WM_USER + 2, "got %d msg %04x\n", ret, msg.message);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE);
+    ok(qstatus == MAKELONG(0, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 2, "got %d msg %04x\n", ret, msg.message);
+
+    /* sent messages are processed by PeekMessage and clear QS_SENDMESSAGE */
+    cross_thread_post(hwnd, WM_USER);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE | QS_SENDMESSAGE);
+    ok(qstatus == MAKELONG(QS_SENDMESSAGE, QS_SENDMESSAGE), "wrong qstatus %08x\n", qstatus);
+    msg.message = 0;
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "PeekMessageA should have returned FALSE instead of msg %04x\n", msg.message);
+    ok_sequence(WmUser, "WmUser", FALSE);
+    qstatus = GetQueueStatus(QS_POSTMESSAGE | QS_SENDMESSAGE);
+    ok(qstatus == 0, "wrong qstatus %08x\n", qstatus);
+
+    DestroyWindow(hwnd);
+    flush_events();
+    flush_sequence();
+}
+
 static void wait_move_event(HWND hwnd, int x, int y)
 {
     MSG msg;
@@ -16584,6 +16692,7 @@ START_TEST(msg)
     test_broadcast();
     test_ShowWindow();
     test_PeekMessage();
+    test_PeekMessage_cross_thread();
     test_PeekMessage2();
     test_PeekMessage3();
     test_WaitForInputIdle( test_argv[0] );
@@ -21,6 +21,16 @@
 
 #include <stdarg.h>
 #include <math.h>
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef __SSE2__
+#  define SSE2_FUNC
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define SSE2_FUNC __attribute__((target("sse2")))  /* selected at run time */
+# endif
+# ifdef SSE2_FUNC
+#  include <emmintrin.h>
+# endif
+#endif
 
 #define COBJMACROS
 
@@ -93,6 +103,191 @@ static inline float to_sRGB_component(float f)
     return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
 }
 
+static inline BYTE to_sRGB_byte_slow(float f)
+{
+    return (BYTE)floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+/* srgb_thresholds[i] is the smallest linear value that converts to the sRGB
+ * byte i. They are found by bisecting on the exact formula, so the table
+ * lookup gives the same results without calling powf for every pixel. */
+static float srgb_thresholds[256];
+static INIT_ONCE srgb_init_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL WINAPI init_srgb_thresholds(INIT_ONCE *once, void *param, void **context)
+{
+    union { float f; DWORD i; } lo, hi, mid;
+    UINT i;
+
+    srgb_thresholds[0] = 0.0f;
+
+    for (i = 1; i < 256; i++)
+    {
+        /* positive floats are ordered like their bit patterns */
+        lo.f = srgb_thresholds[i - 1];
+        hi.f = 1.0f;
+        while (lo.i < hi.i)
+        {
+            mid.i = lo.i + (hi.i - lo.i) / 2;
+            if (to_sRGB_byte_slow(mid.f) >= i)
+                hi.i = mid.i;
+            else
+                lo.i = mid.i + 1;
+        }
+        srgb_thresholds[i] = lo.f;
+    }
+
+    return TRUE;
+}
+
+static inline BYTE to_sRGB_byte(float f)
+{
+    UINT i = 0, step;
+
+    for (step = 128; step; step >>= 1)
+        if (f >= srgb_thresholds[i + step]) i += step;
+
+    return i;
+}
+
+/* x / 255 rounded down, for x <= 255 * 255 */
+static inline DWORD div255(DWORD x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+typedef void (*convert_line_func)(DWORD *dst, const BYTE *src, UINT len);
+typedef void (*premultiply_line_func)(DWORD *pixel, UINT len);
+
+static void convert_bgr_to_bgra_line(DWORD *dst, const BYTE *src, UINT len)
+{
+    UINT x;
+
+    for (x=0; x<len; x++) {
+        dst[x]=0xff000000 | /* alpha */
+               (src[2] << 16) | /* red */
+               (src[1] << 8) | /* green */
+               src[0]; /* blue */
+        src+=3;
+    }
+}
+
+static void convert_rgb_to_bgra_line(DWORD *dst, const BYTE *src, UINT len)
+{
+    UINT x;
+
+    for (x=0; x<len; x++) {
+        dst[x]=0xff000000 | /* alpha */
+               (src[0] << 16) | /* red */
+               (src[1] << 8) | /* green */
+               src[2]; /* blue */
+        src+=3;
+    }
+}
+
+static void premultiply_bgra_line(DWORD *pixel, UINT len)
+{
+    UINT x;
+
+    for (x=0; x<len; x++)
+    {
+        DWORD argb = pixel[x], alpha = argb >> 24;
+
+        pixel[x] = (argb & 0xff000000) |
+                   (div255(((argb >> 16) & 0xff) * alpha) << 16) |
+                   (div255(((argb >> 8) & 0xff) * alpha) << 8) |
+                   div255((argb & 0xff) * alpha);
+    }
+}
+
+#ifdef SSE2_FUNC
+
+static BOOL sse2_supported(void)
+{
+#ifdef __SSE2__
+    return TRUE;
+#else
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+#endif
+}
+
+/* gathers the four 24-bit pixels at the start of a 16-byte load into the
+ * low three bytes of each dword */
+static inline SSE2_FUNC __m128i unpack_24bpp_sse2(__m128i src)
+{
+    __m128i p01 = _mm_unpacklo_epi32(src, _mm_srli_si128(src, 3));
+    __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(src, 6), _mm_srli_si128(src, 9));
+    return _mm_unpacklo_epi64(p01, p23);
+}
+
+/* Four pixels at a time. Each load reads 16 bytes for 12 bytes of pixels, so
+ * the last few pixels are left to the C version to stay inside the row. */
+static SSE2_FUNC void convert_bgr_to_bgra_line_sse2(DWORD *dst, const BYTE *src, UINT len)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x=0; x+6<=len; x+=4)
+    {
+        __m128i pixels = unpack_24bpp_sse2(_mm_loadu_si128((const __m128i *)(src + 3 * x)));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(pixels, alpha));
+    }
+    convert_bgr_to_bgra_line(dst + x, src + 3 * x, len - x);
+}
+
+static SSE2_FUNC void convert_rgb_to_bgra_line_sse2(DWORD *dst, const BYTE *src, UINT len)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    const __m128i green = _mm_set1_epi32(0x0000ff00);
+    const __m128i blue = _mm_set1_epi32(0x000000ff);
+    UINT x;
+
+    for (x=0; x+6<=len; x+=4)
+    {
+        __m128i pixels = unpack_24bpp_sse2(_mm_loadu_si128((const __m128i *)(src + 3 * x)));
+        __m128i red = _mm_slli_epi32(_mm_and_si128(pixels, blue), 16);
+        pixels = _mm_or_si128(_mm_and_si128(pixels, green),
+                              _mm_and_si128(_mm_srli_epi32(pixels, 16), blue));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_or_si128(pixels, red), alpha));
+    }
+    convert_rgb_to_bgra_line(dst + x, src + 3 * x, len - x);
+}
+
+/* same rounding as div255() on 16-bit lanes */
+static inline SSE2_FUNC __m128i div255_sse2(__m128i x)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+/* multiplies two pixels unpacked to 16-bit channels by their alpha */
+static inline SSE2_FUNC __m128i premultiply_sse2(__m128i pixels)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xff), 0xff);
+    return div255_sse2(_mm_mullo_epi16(pixels, alpha));
+}
+
+static SSE2_FUNC void premultiply_bgra_line_sse2(DWORD *pixel, UINT len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x=0; x+4<=len; x+=4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(pixel + x));
+        __m128i lo = premultiply_sse2(_mm_unpacklo_epi8(pixels, zero));
+        __m128i hi = premultiply_sse2(_mm_unpackhi_epi8(pixels, zero));
+        __m128i color = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi));
+        _mm_storeu_si128((__m128i *)(pixel + x), _mm_or_si128(color, _mm_and_si128(pixels, alpha_mask)));
+    }
+    premultiply_bgra_line(pixel + x, len - x);
+}
+
+#endif  /* SSE2_FUNC */
+
 #if 0 /* FIXME: enable once needed */
 static void from_sRGB(BYTE *bgr)
 {
@@ -359,8 +554,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                     dstpixel=(DWORD*)dstrow;
                     for (x=0; x<prc->Width; x++)
                     {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
+                        *dstpixel++ = 0xff000000 | (*srcbyte++ * 0x010101);
                     }
                     srcrow += srcstride;
                     dstrow += cbStride;
@@ -593,7 +787,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                     for (x=0; x<prc->Width; x++) {
                         WORD srcval;
                         srcval=*srcpixel++;
-                        *dstpixel++=((srcval & 0x8000) ? 0xff000000 : 0) | /* alpha */
+                        *dstpixel++=((DWORD)(srcval >> 15) * 0xff000000) | /* alpha */
                                     ((srcval << 9) & 0xf80000) | /* r */
                                     ((srcval << 4) & 0x070000) | /* r - 3 bits */
                                     ((srcval << 6) & 0x00f800) | /* g */
@@ -615,13 +809,16 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
+            convert_line_func convert_line = convert_bgr_to_bgra_line;
+
+#ifdef SSE2_FUNC
+            if (sse2_supported()) convert_line = convert_bgr_to_bgra_line_sse2;
+#endif
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -636,14 +833,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    convert_line((DWORD *)dstrow, srcrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -658,14 +848,16 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
+            convert_line_func convert_line = convert_rgb_to_bgra_line;
+
+#ifdef SSE2_FUNC
+            if (sse2_supported()) convert_line = convert_rgb_to_bgra_line_sse2;
+#endif
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -680,18 +872,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    convert_line((DWORD *)dstrow, srcrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -713,8 +894,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
 
             /* set all alpha values to 255 */
             for (y=0; y<prc->Height; y++)
+            {
+                DWORD *dstpixel = (DWORD *)(pbBuffer + cbStride * y);
                 for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                    dstpixel[x] |= 0xff000000;
+            }
         }
         return S_OK;
     case format_32bppBGRA:
@@ -889,19 +1073,15 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            premultiply_line_func premultiply_line = premultiply_bgra_line;
+            INT y;
+
+#ifdef SSE2_FUNC
+            if (sse2_supported()) premultiply_line = premultiply_bgra_line_sse2;
+#endif
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                premultiply_line((DWORD *)(pbBuffer + cbStride * y), prc->Width);
         }
         return hr;
     }
@@ -989,6 +1169,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                InitOnceExecuteOnce(&srgb_init_once, init_srgb_thresholds, NULL, NULL);
+
                 for (y = 0; y < prc->Height; y++)
                 {
                     float *gray_float = (float *)src;
@@ -996,7 +1178,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1161,6 +1343,8 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
 
+        InitOnceExecuteOnce(&srgb_init_once, init_srgb_thresholds, NULL, NULL);
+
         for (y = 0; y < prc->Height; y++)
         {
             BYTE *bgr = src;
@@ -1169,8 +1353,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
@@ -61,6 +61,7 @@ WINE_DECLARE_DEBUG_CHANNEL(jpeg);
 static void *libjpeg_handle;
 
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f
+MAKE_FUNCPTR(jpeg_abort_decompress);
 MAKE_FUNCPTR(jpeg_CreateCompress);
 MAKE_FUNCPTR(jpeg_CreateDecompress);
 MAKE_FUNCPTR(jpeg_destroy_compress);
@@ -86,6 +87,7 @@ static void *load_libjpeg(void)
         return NULL; \
     }
 
+        LOAD_FUNCPTR(jpeg_abort_decompress);
         LOAD_FUNCPTR(jpeg_CreateCompress);
         LOAD_FUNCPTR(jpeg_CreateDecompress);
         LOAD_FUNCPTR(jpeg_destroy_compress);
@@ -140,6 +142,7 @@ typedef struct {
     IWICBitmapDecoder IWICBitmapDecoder_iface;
     IWICBitmapFrameDecode IWICBitmapFrameDecode_iface;
     IWICMetadataBlockReader IWICMetadataBlockReader_iface;
+    IWICBitmapSourceTransform IWICBitmapSourceTransform_iface;
     LONG ref;
     BOOL initialized;
     BOOL cinfo_initialized;
@@ -172,6 +175,11 @@ static inline JpegDecoder *impl_from_IWICMetadataBlockReader(IWICMetadataBlockRe
     return CONTAINING_RECORD(iface, JpegDecoder, IWICMetadataBlockReader_iface);
 }
 
+static inline JpegDecoder *impl_from_IWICBitmapSourceTransform(IWICBitmapSourceTransform *iface)
+{
+    return CONTAINING_RECORD(iface, JpegDecoder, IWICBitmapSourceTransform_iface);
+}
+
 static HRESULT WINAPI JpegDecoder_QueryInterface(IWICBitmapDecoder *iface, REFIID iid,
     void **ppv)
 {
@@ -289,6 +297,33 @@ static void source_mgr_term_source(j_decompress_ptr cinfo)
 {
 }
 
+/* Sets the decompression parameters after jpeg_read_header(), which resets them.
+ * Every decoding pass must go through here so that they all produce the same output. */
+static BOOL jpeg_set_decompress_params(JpegDecoder *This, UINT scale_denom)
+{
+    switch (This->cinfo.jpeg_color_space)
+    {
+    case JCS_GRAYSCALE:
+        This->cinfo.out_color_space = JCS_GRAYSCALE;
+        break;
+    case JCS_RGB:
+    case JCS_YCbCr:
+        This->cinfo.out_color_space = JCS_RGB;
+        break;
+    case JCS_CMYK:
+    case JCS_YCCK:
+        This->cinfo.out_color_space = JCS_CMYK;
+        break;
+    default:
+        ERR("Unknown JPEG color space %i\n", This->cinfo.jpeg_color_space);
+        return FALSE;
+    }
+
+    This->cinfo.scale_num = 1;
+    This->cinfo.scale_denom = scale_denom;
+    return TRUE;
+}
+
 static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
     WICDecodeOptions cacheOptions)
 {
@@ -348,21 +383,8 @@ static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *
         return E_FAIL;
     }
 
-    switch (This->cinfo.jpeg_color_space)
+    if (!jpeg_set_decompress_params(This, 1))
     {
-    case JCS_GRAYSCALE:
-        This->cinfo.out_color_space = JCS_GRAYSCALE;
-        break;
-    case JCS_RGB:
-    case JCS_YCbCr:
-        This->cinfo.out_color_space = JCS_RGB;
-        break;
-    case JCS_CMYK:
-    case JCS_YCCK:
-        This->cinfo.out_color_space = JCS_CMYK;
-        break;
-    default:
-        ERR("Unknown JPEG color space %i\n", This->cinfo.jpeg_color_space);
         LeaveCriticalSection(&This->lock);
         return E_FAIL;
     }
@@ -500,6 +522,10 @@ static HRESULT WINAPI JpegDecoder_Frame_QueryInterface(IWICBitmapFrameDecode *if
     {
         *ppv = &This->IWICBitmapFrameDecode_iface;
     }
+    else if (IsEqualIID(&IID_IWICBitmapSourceTransform, iid))
+    {
+        *ppv = &This->IWICBitmapSourceTransform_iface;
+    }
     else
     {
         *ppv = NULL;
@@ -526,8 +552,8 @@ static HRESULT WINAPI JpegDecoder_Frame_GetSize(IWICBitmapFrameDecode *iface,
     UINT *puiWidth, UINT *puiHeight)
 {
     JpegDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
-    *puiWidth = This->cinfo.output_width;
-    *puiHeight = This->cinfo.output_height;
+    *puiWidth = This->cinfo.image_width;
+    *puiHeight = This->cinfo.image_height;
     TRACE("(%p)->(%u,%u)\n", iface, *puiWidth, *puiHeight);
     return S_OK;
 }
@@ -586,6 +612,111 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPalette(IWICBitmapFrameDecode *iface
     return E_NOTIMPL;
 }
 
+static UINT jpeg_get_bpp(JpegDecoder *This)
+{
+    if (This->cinfo.out_color_space == JCS_GRAYSCALE) return 8;
+    else if (This->cinfo.out_color_space == JCS_CMYK) return 32;
+    else return 24;
+}
+
+/* Rewinds the stream and restarts decompression, producing output scaled
+ * down by scale_denom in the DCT domain. Needs an error handler installed. */
+static BOOL jpeg_restart_decompress(JpegDecoder *This, UINT scale_denom)
+{
+    LARGE_INTEGER seek;
+
+    TRACE("(%p,%u)\n", This, scale_denom);
+
+    pjpeg_abort_decompress(&This->cinfo);
+
+    seek.QuadPart = 0;
+    IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    This->source_mgr.bytes_in_buffer = 0;
+
+    /* jpeg_read_header() resets all the decompression parameters */
+    if (pjpeg_read_header(&This->cinfo, TRUE) != JPEG_HEADER_OK ||
+        !jpeg_set_decompress_params(This, scale_denom))
+        return FALSE;
+
+    return pjpeg_start_decompress(&This->cinfo);
+}
+
+/* Decodes the rows covered by rc into the buffer, one scanline at a time, so
+ * that no more than a single row of the image is held in memory. Decoding
+ * continues from the current scanline if possible and restarts otherwise.
+ * The caller must hold the lock and have validated the rectangle. */
+static HRESULT jpeg_decode_rect(JpegDecoder *This, UINT scale_denom,
+    const WICRect *rc, UINT stride, BYTE *buffer)
+{
+    UINT bytesperpixel = jpeg_get_bpp(This) / 8;
+    UINT line_size, y, i;
+    JSAMPROW line;
+    BYTE *dst;
+    jmp_buf jmpbuf;
+
+    line_size = bytesperpixel * ((This->cinfo.image_width + scale_denom - 1) / scale_denom);
+    line = HeapAlloc(GetProcessHeap(), 0, line_size);
+    if (!line) return E_OUTOFMEMORY;
+
+    This->cinfo.client_data = jmpbuf;
+
+    if (setjmp(jmpbuf))
+    {
+        /* Make the next request start over. */
+        pjpeg_abort_decompress(&This->cinfo);
+        This->cinfo.scale_denom = 0;
+        HeapFree(GetProcessHeap(), 0, line);
+        return E_FAIL;
+    }
+
+    if (This->cinfo.scale_denom != scale_denom || rc->Y < This->cinfo.output_scanline)
+    {
+        if (!jpeg_restart_decompress(This, scale_denom))
+        {
+            ERR("jpeg_start_decompress failed\n");
+            This->cinfo.scale_denom = 0;
+            HeapFree(GetProcessHeap(), 0, line);
+            return E_FAIL;
+        }
+    }
+
+    while (This->cinfo.output_scanline < rc->Y + rc->Height)
+    {
+        y = This->cinfo.output_scanline;
+
+        if (!pjpeg_read_scanlines(&This->cinfo, &line, 1))
+        {
+            ERR("read_scanlines failed\n");
+            pjpeg_abort_decompress(&This->cinfo);
+            This->cinfo.scale_denom = 0;
+            HeapFree(GetProcessHeap(), 0, line);
+            return E_FAIL;
+        }
+
+        if (y < rc->Y) continue;
+
+        dst = buffer + stride * (y - rc->Y);
+        memcpy(dst, line + bytesperpixel * rc->X, bytesperpixel * rc->Width);
+
+        if (bytesperpixel == 3)
+        {
+            /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
+            reverse_bgr8(3, dst, rc->Width, 1, stride);
+        }
+
+        if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
+        {
+            /* Adobe JPEG's have inverted CMYK data. */
+            for (i=0; i<bytesperpixel * rc->Width; i++)
+                dst[i] ^= 0xff;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, line);
+
+    return S_OK;
+}
+
 static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -593,38 +724,48 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     UINT bpp;
     UINT stride;
     UINT data_size;
-    UINT max_row_needed;
-    jmp_buf jmpbuf;
     WICRect rect;
+    HRESULT hr;
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
     if (!prc)
     {
         rect.X = 0;
         rect.Y = 0;
-        rect.Width = This->cinfo.output_width;
-        rect.Height = This->cinfo.output_height;
+        rect.Width = This->cinfo.image_width;
+        rect.Height = This->cinfo.image_height;
         prc = &rect;
     }
     else
     {
-        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->cinfo.output_width ||
-            prc->Y+prc->Height > This->cinfo.output_height)
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->cinfo.image_width ||
+            prc->Y+prc->Height > This->cinfo.image_height)
             return E_INVALIDARG;
     }
 
-    if (This->cinfo.out_color_space == JCS_GRAYSCALE) bpp = 8;
-    else if (This->cinfo.out_color_space == JCS_CMYK) bpp = 32;
-    else bpp = 24;
+    bpp = jpeg_get_bpp(This);
 
-    stride = bpp * This->cinfo.output_width;
-    data_size = stride * This->cinfo.output_height;
+    if (cbStride < (bpp * prc->Width + 7) / 8 ||
+        (prc->Height && cbStride * (prc->Height - 1) + (bpp * prc->Width + 7) / 8 > cbBufferSize))
+        return E_INVALIDARG;
 
-    max_row_needed = prc->Y + prc->Height;
-    if (max_row_needed > This->cinfo.output_height) return E_INVALIDARG;
+    if (!prc->Width || !prc->Height) return S_OK;
+
+    stride = bpp / 8 * This->cinfo.image_width;
+    data_size = stride * This->cinfo.image_height;
 
     EnterCriticalSection(&This->lock);
 
+    /* Scanlines are streamed straight into the caller's buffer as long as the
+     * requests move down the image. Only when rows that were already decoded
+     * are asked for again is the whole image decoded and kept. */
+    if (!This->image_data && (prc->Y >= This->cinfo.output_scanline || This->cinfo.scale_denom != 1))
+    {
+        hr = jpeg_decode_rect(This, 1, prc, cbStride, pbBuffer);
+        LeaveCriticalSection(&This->lock);
+        return hr;
+    }
+
     if (!This->image_data)
     {
         This->image_data = HeapAlloc(GetProcessHeap(), 0, data_size);
@@ -633,55 +774,25 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
             LeaveCriticalSection(&This->lock);
             return E_OUTOFMEMORY;
         }
-    }
-
-    This->cinfo.client_data = jmpbuf;
-
-    if (setjmp(jmpbuf))
-    {
-        LeaveCriticalSection(&This->lock);
-        return E_FAIL;
-    }
-
-    while (max_row_needed > This->cinfo.output_scanline)
-    {
-        UINT first_scanline = This->cinfo.output_scanline;
-        UINT max_rows;
-        JSAMPROW out_rows[4];
-        UINT i;
-        JDIMENSION ret;
 
-        max_rows = min(This->cinfo.output_height-first_scanline, 4);
-        for (i=0; i<max_rows; i++)
-            out_rows[i] = This->image_data + stride * (first_scanline+i);
-
-        ret = pjpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
-
-        if (ret == 0)
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->cinfo.image_width;
+        rect.Height = This->cinfo.image_height;
+        hr = jpeg_decode_rect(This, 1, &rect, stride, This->image_data);
+        if (FAILED(hr))
         {
-            ERR("read_scanlines failed\n");
+            HeapFree(GetProcessHeap(), 0, This->image_data);
+            This->image_data = NULL;
             LeaveCriticalSection(&This->lock);
-            return E_FAIL;
-        }
-
-        if (bpp == 24)
-        {
-            /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
-            reverse_bgr8(3, This->image_data + stride * first_scanline,
-                This->cinfo.output_width, This->cinfo.output_scanline - first_scanline,
-                stride);
+            return hr;
         }
-
-        if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
-            /* Adobe JPEG's have inverted CMYK data. */
-            for (i=0; i<data_size; i++)
-                This->image_data[i] ^= 0xff;
     }
 
     LeaveCriticalSection(&This->lock);
 
     return copy_pixels(bpp, This->image_data,
-        This->cinfo.output_width, This->cinfo.output_height, stride,
+        This->cinfo.image_width, This->cinfo.image_height, stride,
         prc, cbStride, cbBufferSize, pbBuffer);
 }
 
@@ -793,6 +904,160 @@ static const IWICMetadataBlockReaderVtbl JpegDecoder_Block_Vtbl = {
     JpegDecoder_Block_GetEnumerator,
 };
 
+/* libjpeg can scale down by these factors while decoding, without ever
+ * producing the full size image. */
+static const UINT jpeg_scale_denoms[] = { 8, 4, 2, 1 };
+
+static HRESULT WINAPI JpegDecoder_SourceTransform_QueryInterface(IWICBitmapSourceTransform *iface, REFIID iid,
+    void **ppv)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapFrameDecode_QueryInterface(&This->IWICBitmapFrameDecode_iface, iid, ppv);
+}
+
+static ULONG WINAPI JpegDecoder_SourceTransform_AddRef(IWICBitmapSourceTransform *iface)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapDecoder_AddRef(&This->IWICBitmapDecoder_iface);
+}
+
+static ULONG WINAPI JpegDecoder_SourceTransform_Release(IWICBitmapSourceTransform *iface)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapDecoder_Release(&This->IWICBitmapDecoder_iface);
+}
+
+static HRESULT WINAPI JpegDecoder_SourceTransform_CopyPixels(IWICBitmapSourceTransform *iface,
+    const WICRect *prc, UINT width, UINT height, WICPixelFormatGUID *format,
+    WICBitmapTransformOptions transform, UINT stride, UINT buffer_size, BYTE *buffer)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    WICPixelFormatGUID src_format;
+    UINT bpp, scale_denom = 0, i;
+    WICRect rect;
+    HRESULT hr;
+
+    TRACE("(%p,%p,%u,%u,%s,%u,%u,%u,%p)\n", iface, prc, width, height, debugstr_guid(format),
+          transform, stride, buffer_size, buffer);
+
+    if (transform != WICBitmapTransformRotate0)
+    {
+        FIXME("unsupported transform %#x\n", transform);
+        return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    }
+
+    JpegDecoder_Frame_GetPixelFormat(&This->IWICBitmapFrameDecode_iface, &src_format);
+    if (format && !IsEqualGUID(format, &src_format))
+    {
+        FIXME("unsupported pixel format %s\n", debugstr_guid(format));
+        return WINCODEC_ERR_UNSUPPORTEDPIXELFORMAT;
+    }
+
+    for (i = 0; i < sizeof(jpeg_scale_denoms) / sizeof(jpeg_scale_denoms[0]); i++)
+    {
+        if (width == (This->cinfo.image_width + jpeg_scale_denoms[i] - 1) / jpeg_scale_denoms[i] &&
+            height == (This->cinfo.image_height + jpeg_scale_denoms[i] - 1) / jpeg_scale_denoms[i])
+        {
+            scale_denom = jpeg_scale_denoms[i];
+            break;
+        }
+    }
+
+    if (!scale_denom)
+    {
+        WARN("size %ux%u is not supported\n", width, height);
+        return E_INVALIDARG;
+    }
+
+    if (scale_denom == 1)
+        return JpegDecoder_Frame_CopyPixels(&This->IWICBitmapFrameDecode_iface, prc, stride, buffer_size, buffer);
+
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = width;
+        rect.Height = height;
+        prc = &rect;
+    }
+    else if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > width || prc->Y+prc->Height > height)
+        return E_INVALIDARG;
+
+    bpp = jpeg_get_bpp(This);
+
+    if (stride < (bpp * prc->Width + 7) / 8 ||
+        (prc->Height && stride * (prc->Height - 1) + (bpp * prc->Width + 7) / 8 > buffer_size))
+        return E_INVALIDARG;
+
+    if (!prc->Width || !prc->Height) return S_OK;
+
+    EnterCriticalSection(&This->lock);
+    hr = jpeg_decode_rect(This, scale_denom, prc, stride, buffer);
+    LeaveCriticalSection(&This->lock);
+
+    return hr;
+}
+
+static HRESULT WINAPI JpegDecoder_SourceTransform_GetClosestSize(IWICBitmapSourceTransform *iface,
+    UINT *width, UINT *height)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    UINT scale_denom, i;
+
+    TRACE("(%p,%p,%p)\n", iface, width, height);
+
+    if (!width || !height) return E_INVALIDARG;
+
+    /* Pick the smallest DCT scaled size that is still at least as large as
+     * requested, leaving any remaining scaling to the caller. */
+    for (i = 0; i < sizeof(jpeg_scale_denoms) / sizeof(jpeg_scale_denoms[0]); i++)
+    {
+        scale_denom = jpeg_scale_denoms[i];
+        if ((This->cinfo.image_width + scale_denom - 1) / scale_denom >= *width &&
+            (This->cinfo.image_height + scale_denom - 1) / scale_denom >= *height)
+            break;
+    }
+
+    *width = (This->cinfo.image_width + scale_denom - 1) / scale_denom;
+    *height = (This->cinfo.image_height + scale_denom - 1) / scale_denom;
+
+    return S_OK;
+}
+
+static HRESULT WINAPI JpegDecoder_SourceTransform_GetClosestPixelFormat(IWICBitmapSourceTransform *iface,
+    WICPixelFormatGUID *format)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+
+    TRACE("(%p,%p)\n", iface, format);
+
+    if (!format) return E_INVALIDARG;
+
+    return JpegDecoder_Frame_GetPixelFormat(&This->IWICBitmapFrameDecode_iface, format);
+}
+
+static HRESULT WINAPI JpegDecoder_SourceTransform_DoesSupportTransform(IWICBitmapSourceTransform *iface,
+    WICBitmapTransformOptions transform, BOOL *supported)
+{
+    TRACE("(%p,%u,%p)\n", iface, transform, supported);
+
+    if (!supported) return E_INVALIDARG;
+
+    *supported = transform == WICBitmapTransformRotate0;
+
+    return S_OK;
+}
+
+static const IWICBitmapSourceTransformVtbl JpegDecoder_SourceTransform_Vtbl = {
+    JpegDecoder_SourceTransform_QueryInterface,
+    JpegDecoder_SourceTransform_AddRef,
+    JpegDecoder_SourceTransform_Release,
+    JpegDecoder_SourceTransform_CopyPixels,
+    JpegDecoder_SourceTransform_GetClosestSize,
+    JpegDecoder_SourceTransform_GetClosestPixelFormat,
+    JpegDecoder_SourceTransform_DoesSupportTransform
+};
+
 HRESULT JpegDecoder_CreateInstance(REFIID iid, void** ppv)
 {
     JpegDecoder *This;
@@ -814,6 +1079,7 @@ HRESULT JpegDecoder_CreateInstance(REFIID iid, void** ppv)
     This->IWICBitmapDecoder_iface.lpVtbl = &JpegDecoder_Vtbl;
     This->IWICBitmapFrameDecode_iface.lpVtbl = &JpegDecoder_Frame_Vtbl;
     This->IWICMetadataBlockReader_iface.lpVtbl = &JpegDecoder_Block_Vtbl;
+    This->IWICBitmapSourceTransform_iface.lpVtbl = &JpegDecoder_SourceTransform_Vtbl;
     This->ref = 1;
     This->initialized = FALSE;
     This->cinfo_initialized = FALSE;
@@ -334,9 +334,9 @@ MAKE_FUNCPTR(png_set_read_fn);
 MAKE_FUNCPTR(png_set_strip_16);
 MAKE_FUNCPTR(png_set_tRNS_to_alpha);
 MAKE_FUNCPTR(png_set_write_fn);
-MAKE_FUNCPTR(png_read_end);
 MAKE_FUNCPTR(png_read_image);
 MAKE_FUNCPTR(png_read_info);
+MAKE_FUNCPTR(png_read_row);
 MAKE_FUNCPTR(png_write_end);
 MAKE_FUNCPTR(png_write_info);
 MAKE_FUNCPTR(png_write_rows);
@@ -403,9 +403,9 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_set_strip_16);
         LOAD_FUNCPTR(png_set_tRNS_to_alpha);
         LOAD_FUNCPTR(png_set_write_fn);
-        LOAD_FUNCPTR(png_read_end);
         LOAD_FUNCPTR(png_read_image);
         LOAD_FUNCPTR(png_read_info);
+        LOAD_FUNCPTR(png_read_row);
         LOAD_FUNCPTR(png_write_end);
         LOAD_FUNCPTR(png_write_info);
         LOAD_FUNCPTR(png_write_rows);
@@ -457,6 +457,9 @@ typedef struct {
     UINT stride;
     const WICPixelFormatGUID *format;
     BYTE *image_bits;
+    int passes;
+    UINT next_row; /* first row not yet read by png_read_row */
+    ULARGE_INTEGER decode_pos; /* stream offset to continue reading rows from */
     CRITICAL_SECTION lock; /* must be held when png structures are accessed or initialized is set */
     ULONG metadata_count;
     metadata_block_info* metadata_blocks;
@@ -571,45 +574,31 @@ static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t lengt
     }
 }
 
-static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
-    WICDecodeOptions cacheOptions)
+/* Creates the libpng read structures and reads the header, setting up the
+ * transforms needed for the WIC pixel format. The image data is not read,
+ * the stream is left positioned at its start. */
+static HRESULT png_start_read(PngDecoder *This, IStream *stream)
 {
-    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
     LARGE_INTEGER seek;
     HRESULT hr=S_OK;
-    png_bytep *row_pointers=NULL;
-    UINT image_size;
-    UINT i;
     int color_type, bit_depth;
     png_bytep trans;
     int num_trans;
     png_uint_32 transparency;
     png_color_16p trans_values;
     jmp_buf jmpbuf;
-    BYTE chunk_type[4];
-    ULONG chunk_size;
-    ULARGE_INTEGER chunk_start;
-    ULONG metadata_blocks_size = 0;
-
-    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
-
-    EnterCriticalSection(&This->lock);
 
     /* initialize libpng */
     This->png_ptr = ppng_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!This->png_ptr)
-    {
-        hr = E_FAIL;
-        goto end;
-    }
+        return E_FAIL;
 
     This->info_ptr = ppng_create_info_struct(This->png_ptr);
     if (!This->info_ptr)
     {
         ppng_destroy_read_struct(&This->png_ptr, NULL, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     This->end_info = ppng_create_info_struct(This->png_ptr);
@@ -617,29 +606,26 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     /* set up setjmp/longjmp error handling */
     if (setjmp(jmpbuf))
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
-        HeapFree(GetProcessHeap(), 0, row_pointers);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
     ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
     ppng_set_crc_action(This->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
 
     /* seek to the start of the stream */
     seek.QuadPart = 0;
-    hr = IStream_Seek(pIStream, seek, STREAM_SEEK_SET, NULL);
-    if (FAILED(hr)) goto end;
+    hr = IStream_Seek(stream, seek, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr)) return hr;
 
     /* set up custom i/o handling */
-    ppng_set_read_fn(This->png_ptr, pIStream, user_read_data);
+    ppng_set_read_fn(This->png_ptr, stream, user_read_data);
 
     /* read the header */
     ppng_read_info(This->png_ptr, This->info_ptr);
@@ -684,8 +670,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat16bppGray; break;
         default:
             ERR("invalid grayscale bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_GRAY_ALPHA:
@@ -703,8 +688,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat64bppRGBA; break;
         default:
             ERR("invalid RGBA bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_PALETTE:
@@ -717,8 +701,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 8: This->format = &GUID_WICPixelFormat8bppIndexed; break;
         default:
             ERR("invalid indexed color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_RGB:
@@ -732,45 +715,43 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat48bppRGB; break;
         default:
             ERR("invalid RGB color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     default:
         ERR("invalid color type %i\n", color_type);
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
-    /* read the image data */
     This->width = ppng_get_image_width(This->png_ptr, This->info_ptr);
     This->height = ppng_get_image_height(This->png_ptr, This->info_ptr);
     This->stride = (This->width * This->bpp + 7) / 8;
-    image_size = This->stride * This->height;
 
-    This->image_bits = HeapAlloc(GetProcessHeap(), 0, image_size);
-    if (!This->image_bits)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+    This->passes = ppng_set_interlace_handling(This->png_ptr);
+    This->next_row = 0;
 
-    row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
-    if (!row_pointers)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+    seek.QuadPart = 0;
+    return IStream_Seek(stream, seek, STREAM_SEEK_CUR, &This->decode_pos);
+}
 
-    for (i=0; i<This->height; i++)
-        row_pointers[i] = This->image_bits + i * This->stride;
+static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
+    WICDecodeOptions cacheOptions)
+{
+    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
+    LARGE_INTEGER seek;
+    HRESULT hr=S_OK;
+    BYTE chunk_type[4];
+    ULONG chunk_size;
+    ULARGE_INTEGER chunk_start;
+    ULONG metadata_blocks_size = 0;
 
-    ppng_read_image(This->png_ptr, row_pointers);
+    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
 
-    HeapFree(GetProcessHeap(), 0, row_pointers);
-    row_pointers = NULL;
+    EnterCriticalSection(&This->lock);
 
-    ppng_read_end(This->png_ptr, This->end_info);
+    /* The image data is only decoded when the pixels are requested. */
+    hr = png_start_read(This, pIStream);
+    if (FAILED(hr)) goto end;
 
     /* Find the metadata chunks in the file. */
     seek.QuadPart = 8;
@@ -1085,15 +1066,171 @@ end:
     return hr;
 }
 
+/* Decodes the whole image into image_bits, starting over if rows were
+ * already consumed. */
+static HRESULT png_decode_image(PngDecoder *This)
+{
+    png_bytep *row_pointers;
+    LARGE_INTEGER seek;
+    jmp_buf jmpbuf;
+    HRESULT hr;
+    UINT i;
+
+    if (This->next_row)
+    {
+        ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
+        This->png_ptr = NULL;
+        hr = png_start_read(This, This->stream);
+        if (FAILED(hr)) return hr;
+    }
+    else
+    {
+        seek.QuadPart = This->decode_pos.QuadPart;
+        hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+        if (FAILED(hr)) return hr;
+    }
+
+    This->image_bits = HeapAlloc(GetProcessHeap(), 0, This->stride * This->height);
+    row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep) * This->height);
+    if (!This->image_bits || !row_pointers)
+    {
+        HeapFree(GetProcessHeap(), 0, This->image_bits);
+        HeapFree(GetProcessHeap(), 0, row_pointers);
+        This->image_bits = NULL;
+        return E_OUTOFMEMORY;
+    }
+
+    for (i=0; i<This->height; i++)
+        row_pointers[i] = This->image_bits + i * This->stride;
+
+    if (setjmp(jmpbuf))
+    {
+        HeapFree(GetProcessHeap(), 0, This->image_bits);
+        HeapFree(GetProcessHeap(), 0, row_pointers);
+        This->image_bits = NULL;
+        This->next_row = This->height;
+        return E_FAIL;
+    }
+    ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+
+    ppng_read_image(This->png_ptr, row_pointers);
+
+    HeapFree(GetProcessHeap(), 0, row_pointers);
+    This->next_row = This->height;
+
+    return S_OK;
+}
+
+/* Reads the rows of a non-interlaced image up to the end of rc, copying the
+ * ones inside rc to the buffer, without keeping the rest of the image. */
+static HRESULT png_decode_rect(PngDecoder *This, const WICRect *rc,
+    UINT stride, UINT buffer_size, BYTE *buffer)
+{
+    WICRect row_rect;
+    LARGE_INTEGER seek;
+    jmp_buf jmpbuf;
+    BYTE *row;
+    HRESULT hr;
+
+    row = HeapAlloc(GetProcessHeap(), 0, This->stride);
+    if (!row) return E_OUTOFMEMORY;
+
+    seek.QuadPart = This->decode_pos.QuadPart;
+    hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, row);
+        return hr;
+    }
+
+    if (setjmp(jmpbuf))
+    {
+        HeapFree(GetProcessHeap(), 0, row);
+        /* The read state is unusable now, force a restart next time. */
+        This->next_row = This->height;
+        return E_FAIL;
+    }
+    ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+
+    row_rect.X = rc->X;
+    row_rect.Y = 0;
+    row_rect.Width = rc->Width;
+    row_rect.Height = 1;
+
+    while (This->next_row < rc->Y + rc->Height && SUCCEEDED(hr))
+    {
+        ppng_read_row(This->png_ptr, row, NULL);
+
+        if (This->next_row >= rc->Y)
+            hr = copy_pixels(This->bpp, row, This->width, 1, This->stride, &row_rect, stride,
+                buffer_size - stride * (This->next_row - rc->Y),
+                buffer + stride * (This->next_row - rc->Y));
+
+        This->next_row++;
+    }
+
+    HeapFree(GetProcessHeap(), 0, row);
+
+    seek.QuadPart = 0;
+    IStream_Seek(This->stream, seek, STREAM_SEEK_CUR, &This->decode_pos);
+
+    return hr;
+}
+
 static HRESULT WINAPI PngDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     PngDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    WICRect rect;
+    HRESULT hr = S_OK;
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
-    return copy_pixels(This->bpp, This->image_bits,
-        This->width, This->height, This->stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->width;
+        rect.Height = This->height;
+        prc = &rect;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->width ||
+            prc->Y+prc->Height > This->height)
+            return E_INVALIDARG;
+    }
+
+    if (cbStride < (This->bpp * prc->Width + 7) / 8 ||
+        (prc->Height && cbStride * (prc->Height - 1) + (This->bpp * prc->Width + 7) / 8 > cbBufferSize))
+        return E_INVALIDARG;
+
+    if (!prc->Width || !prc->Height) return S_OK;
+
+    EnterCriticalSection(&This->lock);
+
+    /* Non-interlaced images are streamed straight into the caller's buffer
+     * while the requests move down the image; otherwise the whole image is
+     * decoded and kept. */
+    if (!This->image_bits)
+    {
+        if (This->passes == 1 && prc->Y >= This->next_row)
+        {
+            hr = png_decode_rect(This, prc, cbStride, cbBufferSize, pbBuffer);
+            LeaveCriticalSection(&This->lock);
+            return hr;
+        }
+
+        hr = png_decode_image(This);
+    }
+
+    if (SUCCEEDED(hr))
+        hr = copy_pixels(This->bpp, This->image_bits,
+            This->width, This->height, This->stride,
+            prc, cbStride, cbBufferSize, pbBuffer);
+
+    LeaveCriticalSection(&This->lock);
+
+    return hr;
 }
 
 static HRESULT WINAPI PngDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -1307,6 +1444,9 @@ HRESULT PngDecoder_CreateInstance(REFIID iid, void** ppv)
     This->stream = NULL;
     This->initialized = FALSE;
     This->image_bits = NULL;
+    This->passes = 0;
+    This->next_row = 0;
+    This->decode_pos.QuadPart = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": PngDecoder.lock");
     This->metadata_count = 0;
@@ -19,6 +19,17 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef __SSE2__
+#  define SSE2_FUNC
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define SSE2_FUNC __attribute__((target("sse2")))  /* selected at run time */
+# endif
+# ifdef SSE2_FUNC
+#  include <emmintrin.h>
+# endif
+#endif
 
 #define COBJMACROS
 
@@ -32,19 +43,45 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* Upper bound on the amount of source data fetched by a single
+ * IWICBitmapSource_CopyPixels call, unless one destination row needs more. */
+#define SCALER_MAX_SOURCE_CHUNK (4 * 1024 * 1024)
+
+/* Per-axis weights of a separable filter. Destination pixel d is computed from
+ * count[d] source pixels starting at start[d], with weights[d * taps + k]. */
+struct scaler_filter
+{
+    UINT *start;
+    UINT *count;
+    float *weights;
+    UINT taps;
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
     IWICBitmapSource *source;
+    IWICBitmapSourceTransform *transform;
+    WICPixelFormatGUID transform_format;
     UINT width, height;
     UINT src_width, src_height;
     WICBitmapInterpolationMode mode;
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct scaler_filter filter_x, filter_y;
+    float *filter_row; /* only valid during CopyPixels */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
+static void free_scaler_filter(struct scaler_filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->count);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    memset(filter, 0, sizeof(*filter));
+}
+
 static inline BitmapScaler *impl_from_IWICBitmapScaler(IWICBitmapScaler *iface)
 {
     return CONTAINING_RECORD(iface, BitmapScaler, IWICBitmapScaler_iface);
@@ -96,6 +133,9 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        if (This->transform) IWICBitmapSourceTransform_Release(This->transform);
+        free_scaler_filter(&This->filter_x);
+        free_scaler_filter(&This->filter_y);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -190,6 +230,278 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+/* Catmull-Rom spline */
+static float cubic_kernel(float x)
+{
+    x = fabsf(x);
+    if (x < 1.0f)
+        return (1.5f * x - 2.5f) * x * x + 1.0f;
+    if (x < 2.0f)
+        return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+    return 0.0f;
+}
+
+static HRESULT init_scaler_filter(struct scaler_filter *filter, UINT src_size,
+    UINT dst_size, WICBitmapInterpolationMode mode)
+{
+    double scale, stretch, radius, center, a = 0.0, b = 0.0;
+    int lo, hi, i, first, last;
+    float *weights, w, sum;
+    UINT d, k;
+
+    if (!dst_size || !src_size)
+        return S_OK;
+
+    scale = (double)src_size / dst_size;
+    /* Widen the kernel when downscaling so that every source pixel contributes. */
+    stretch = scale > 1.0 ? scale : 1.0;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        radius = stretch;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        radius = 2.0 * stretch;
+        break;
+    default:
+        radius = scale / 2.0 + 1.0;
+        break;
+    }
+
+    filter->taps = (UINT)ceil(2.0 * radius) + 1;
+    if (filter->taps > src_size) filter->taps = src_size;
+
+    filter->start = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*filter->start));
+    filter->count = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*filter->count));
+    filter->weights = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+        dst_size * filter->taps * sizeof(*filter->weights));
+    if (!filter->start || !filter->count || !filter->weights)
+    {
+        free_scaler_filter(filter);
+        return E_OUTOFMEMORY;
+    }
+
+    for (d = 0; d < dst_size; d++)
+    {
+        center = (d + 0.5) * scale - 0.5;
+
+        if (mode == WICBitmapInterpolationModeFant)
+        {
+            /* Area average over the source span covered by the pixel. */
+            a = d * scale;
+            b = (d + 1) * scale;
+            lo = (int)floor(a);
+            hi = (int)ceil(b) - 1;
+        }
+        else
+        {
+            lo = (int)floor(center - radius) + 1;
+            hi = (int)ceil(center + radius) - 1;
+        }
+
+        first = lo < 0 ? 0 : lo;
+        last = hi >= (int)src_size ? src_size - 1 : hi;
+        if (first > last) first = last = min(max(lo, 0), (int)src_size - 1);
+
+        filter->start[d] = first;
+        filter->count[d] = last - first + 1;
+        weights = filter->weights + d * filter->taps;
+
+        sum = 0.0f;
+        for (i = lo; i <= hi; i++)
+        {
+            switch (mode)
+            {
+            case WICBitmapInterpolationModeLinear:
+                w = 1.0f - fabs(i - center) / stretch;
+                if (w < 0.0f) w = 0.0f;
+                break;
+            case WICBitmapInterpolationModeCubic:
+                w = cubic_kernel((i - center) / stretch);
+                break;
+            default:
+                w = min(i + 1, b) - max(i, a);
+                break;
+            }
+            /* Edge pixels are repeated outside the source. */
+            weights[min(max(i, first), last) - first] += w;
+            sum += w;
+        }
+
+        if (sum != 0.0f)
+        {
+            for (k = 0; k < filter->count[d]; k++)
+                weights[k] /= sum;
+        }
+        else
+        {
+            weights[0] = 1.0f;
+        }
+    }
+
+    return S_OK;
+}
+
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->filter_x.start[x];
+    src_rect->Y = This->filter_y.start[y];
+    src_rect->Width = This->filter_x.count[x];
+    src_rect->Height = This->filter_y.count[y];
+}
+
+typedef void (*filter_accumulate_func)(float *row, const BYTE *src, float weight, UINT count);
+typedef void (*filter_resample_func)(BYTE *dst, const float *row, const struct scaler_filter *fx,
+    UINT dst_x, UINT dst_width, UINT first_x, UINT channels);
+
+static void filter_accumulate(float *row, const BYTE *src, float weight, UINT count)
+{
+    UINT j;
+
+    for (j = 0; j < count; j++)
+        row[j] += weight * src[j];
+}
+
+static void filter_resample(BYTE *dst, const float *row, const struct scaler_filter *fx,
+    UINT dst_x, UINT dst_width, UINT first_x, UINT channels)
+{
+    const float *weights;
+    UINT i, k, c;
+    float v;
+
+    for (i = 0; i < dst_width; i++)
+    {
+        const float *pixel = row + (fx->start[dst_x + i] - first_x) * channels;
+
+        weights = fx->weights + (dst_x + i) * fx->taps;
+        for (c = 0; c < channels; c++)
+        {
+            v = 0.5f;
+            for (k = 0; k < fx->count[dst_x + i]; k++)
+                v += weights[k] * pixel[k * channels + c];
+            dst[i * channels + c] = v <= 0.0f ? 0 : v >= 255.0f ? 255 : (BYTE)v;
+        }
+    }
+}
+
+#ifdef SSE2_FUNC
+
+static BOOL sse2_supported(void)
+{
+#ifdef __SSE2__
+    return TRUE;
+#else
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+#endif
+}
+
+static SSE2_FUNC void filter_accumulate_sse2(float *row, const BYTE *src, float weight, UINT count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 w = _mm_set1_ps(weight);
+    __m128i bytes, lo, hi;
+    UINT j;
+
+    for (j = 0; j + 16 <= count; j += 16)
+    {
+        bytes = _mm_loadu_si128((const __m128i *)(src + j));
+        lo = _mm_unpacklo_epi8(bytes, zero);
+        hi = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(row + j, _mm_add_ps(_mm_loadu_ps(row + j),
+            _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)))));
+        _mm_storeu_ps(row + j + 4, _mm_add_ps(_mm_loadu_ps(row + j + 4),
+            _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)))));
+        _mm_storeu_ps(row + j + 8, _mm_add_ps(_mm_loadu_ps(row + j + 8),
+            _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)))));
+        _mm_storeu_ps(row + j + 12, _mm_add_ps(_mm_loadu_ps(row + j + 12),
+            _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)))));
+    }
+
+    filter_accumulate(row + j, src + j, weight, count - j);
+}
+
+/* 32bpp only: the four channels of a pixel are filtered in one vector */
+static SSE2_FUNC void filter_resample_4_sse2(BYTE *dst, const float *row, const struct scaler_filter *fx,
+    UINT dst_x, UINT dst_width, UINT first_x, UINT channels)
+{
+    const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps(), limit = _mm_set1_ps(255.0f);
+    const float *weights;
+    __m128i n;
+    __m128 v;
+    UINT i, k;
+
+    for (i = 0; i < dst_width; i++)
+    {
+        const float *pixel = row + (fx->start[dst_x + i] - first_x) * 4;
+
+        weights = fx->weights + (dst_x + i) * fx->taps;
+        v = half;
+        for (k = 0; k < fx->count[dst_x + i]; k++)
+            v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(pixel + k * 4)));
+        n = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, zero), limit));
+        n = _mm_packs_epi32(n, n);
+        ((DWORD *)dst)[i] = _mm_cvtsi128_si32(_mm_packus_epi16(n, n));
+    }
+}
+
+#endif  /* SSE2_FUNC */
+
+/* Every byte is filtered as an independent 8-bit channel. The vertical pass
+ * accumulates the needed source span into a float row, which the horizontal
+ * pass then resamples; both inner loops run over contiguous data. */
+static void Filter_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT channels = This->bpp / 8;
+    const struct scaler_filter *fx = &This->filter_x, *fy = &This->filter_y;
+    filter_accumulate_func accumulate = filter_accumulate;
+    filter_resample_func resample = filter_resample;
+    float *row = This->filter_row;
+    const float *weights;
+    UINT first_x, span, j, k;
+    const BYTE *src;
+
+#ifdef SSE2_FUNC
+    if (sse2_supported())
+    {
+        accumulate = filter_accumulate_sse2;
+        if (channels == 4) resample = filter_resample_4_sse2;
+    }
+#endif
+
+    first_x = fx->start[dst_x];
+    span = (fx->start[dst_x + dst_width - 1] + fx->count[dst_x + dst_width - 1] - first_x) * channels;
+
+    weights = fy->weights + dst_y * fy->taps;
+    for (j = 0; j < span; j++)
+        row[j] = 0.0f;
+    for (k = 0; k < fy->count[dst_y]; k++)
+    {
+        src = src_data[fy->start[dst_y] - src_data_y + k] + (first_x - src_data_x) * channels;
+        accumulate(row, src, weights[k], span);
+    }
+
+    resample(pbBuffer, row, fx, dst_x, dst_width, first_x, channels);
+}
+
+static BOOL is_byte_channel_format(const WICPixelFormatGUID *format)
+{
+    return IsEqualGUID(format, &GUID_WICPixelFormat8bppGray) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat24bppBGR) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat24bppRGB) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppBGR) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppBGRA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppPBGRA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppRGBA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppPRGBA);
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -197,12 +509,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     HRESULT hr;
     WICRect dest_rect;
     WICRect src_rect_ul, src_rect_br, src_rect;
-    BYTE **src_rows;
-    BYTE *src_bits;
+    BYTE **src_rows = NULL;
+    BYTE *src_bits = NULL;
     ULONG bytesperrow;
     ULONG src_bytesperrow;
-    ULONG buffer_size;
-    UINT y;
+    ULONG buffer_size, allocated_rows = 0;
+    UINT y, band_y, band_height;
 
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
@@ -244,54 +556,96 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    hr = S_OK;
+    if (!dest_rect.Width || !dest_rect.Height)
+        goto end;
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
      * once, by saving the data that will be useful for the next scanline after
      * the call returns. The GetRequiredSourceRect/CopyScanline functions are
      * designed to make it possible to do this in a generic way, but for now we
-     * just grab all the data we need in each call. */
+     * just grab the data we need in each call, in bands of bounded size so
+     * that scaling a huge source does not require buffering all of it. */
 
     This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y, &src_rect_ul);
     This->fn_get_required_source_rect(This, dest_rect.X+dest_rect.Width-1,
-        dest_rect.Y+dest_rect.Height-1, &src_rect_br);
+        dest_rect.Y, &src_rect_br);
 
     src_rect.X = src_rect_ul.X;
-    src_rect.Y = src_rect_ul.Y;
     src_rect.Width = src_rect_br.Width + src_rect_br.X - src_rect_ul.X;
-    src_rect.Height = src_rect_br.Height + src_rect_br.Y - src_rect_ul.Y;
-
     src_bytesperrow = (src_rect.Width * This->bpp + 7)/8;
-    buffer_size = src_bytesperrow * src_rect.Height;
 
-    src_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * src_rect.Height);
-    src_bits = HeapAlloc(GetProcessHeap(), 0, buffer_size);
-
-    if (!src_rows || !src_bits)
+    if (This->fn_copy_scanline == Filter_CopyScanline)
     {
-        HeapFree(GetProcessHeap(), 0, src_rows);
-        HeapFree(GetProcessHeap(), 0, src_bits);
-        hr = E_OUTOFMEMORY;
-        goto end;
+        This->filter_row = HeapAlloc(GetProcessHeap(), 0,
+            src_rect.Width * (This->bpp / 8) * sizeof(*This->filter_row));
+        if (!This->filter_row)
+        {
+            hr = E_OUTOFMEMORY;
+            goto end;
+        }
     }
 
-    for (y=0; y<src_rect.Height; y++)
-        src_rows[y] = src_bits + y * src_bytesperrow;
+    for (band_y = 0; band_y < dest_rect.Height && SUCCEEDED(hr); band_y += band_height)
+    {
+        This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y+band_y, &src_rect_ul);
+        src_rect.Y = src_rect_ul.Y;
+        src_rect.Height = src_rect_ul.Height;
 
-    hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
-        buffer_size, src_bits);
+        for (band_height = 1; band_y + band_height < dest_rect.Height; band_height++)
+        {
+            This->fn_get_required_source_rect(This, dest_rect.X,
+                dest_rect.Y+band_y+band_height, &src_rect_br);
+            if ((ULONG)(src_rect_br.Y + src_rect_br.Height - src_rect.Y) * src_bytesperrow
+                    > SCALER_MAX_SOURCE_CHUNK)
+                break;
+            src_rect.Height = src_rect_br.Y + src_rect_br.Height - src_rect.Y;
+        }
 
-    if (SUCCEEDED(hr))
-    {
-        for (y=0; y < dest_rect.Height; y++)
+        buffer_size = src_bytesperrow * src_rect.Height;
+
+        if (src_rect.Height > allocated_rows)
         {
-            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
-                src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
+            HeapFree(GetProcessHeap(), 0, src_rows);
+            HeapFree(GetProcessHeap(), 0, src_bits);
+            src_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * src_rect.Height);
+            src_bits = HeapAlloc(GetProcessHeap(), 0, buffer_size);
+
+            if (!src_rows || !src_bits)
+            {
+                hr = E_OUTOFMEMORY;
+                break;
+            }
+            allocated_rows = src_rect.Height;
+        }
+
+        for (y=0; y<src_rect.Height; y++)
+            src_rows[y] = src_bits + y * src_bytesperrow;
+
+        if (This->transform)
+            hr = IWICBitmapSourceTransform_CopyPixels(This->transform, &src_rect,
+                This->src_width, This->src_height, &This->transform_format,
+                WICBitmapTransformRotate0, src_bytesperrow, buffer_size, src_bits);
+        else
+            hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
+                buffer_size, src_bits);
+
+        if (SUCCEEDED(hr))
+        {
+            for (y=band_y; y < band_y + band_height; y++)
+            {
+                This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
+                    src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
+            }
         }
     }
 
     HeapFree(GetProcessHeap(), 0, src_rows);
     HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, This->filter_row);
+    This->filter_row = NULL;
 
 end:
     LeaveCriticalSection(&This->lock);
@@ -299,6 +653,35 @@ end:
     return hr;
 }
 
+/* Lets a decoder that can scale while decoding, like JPEG in the DCT domain,
+ * do most of a large reduction so that the filter only handles the rest. */
+static void init_source_transform(BitmapScaler *This, IWICBitmapSource *source,
+    const WICPixelFormatGUID *format)
+{
+    IWICBitmapSourceTransform *transform;
+    WICPixelFormatGUID closest_format = *format;
+    UINT width = This->width, height = This->height;
+
+    if (FAILED(IWICBitmapSource_QueryInterface(source, &IID_IWICBitmapSourceTransform, (void **)&transform)))
+        return;
+
+    if (SUCCEEDED(IWICBitmapSourceTransform_GetClosestSize(transform, &width, &height)) &&
+        SUCCEEDED(IWICBitmapSourceTransform_GetClosestPixelFormat(transform, &closest_format)) &&
+        IsEqualGUID(&closest_format, format) &&
+        width >= This->width && height >= This->height &&
+        (width < This->src_width || height < This->src_height))
+    {
+        TRACE("decoding source at %ux%u\n", width, height);
+        This->transform = transform;
+        This->transform_format = *format;
+        This->src_width = width;
+        This->src_height = height;
+        return;
+    }
+
+    IWICBitmapSourceTransform_Release(transform);
+}
+
 static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     IWICBitmapSource *pISource, UINT uiWidth, UINT uiHeight,
     WICBitmapInterpolationMode mode)
@@ -335,6 +718,38 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            if (is_byte_channel_format(&src_pixelformat))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+                init_source_transform(This, pISource, &src_pixelformat);
+            }
+            else
+            {
+                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                    pISource, &This->source);
+                This->bpp = 32;
+            }
+
+            if (SUCCEEDED(hr))
+                hr = init_scaler_filter(&This->filter_x, This->src_width, uiWidth, mode);
+            if (SUCCEEDED(hr))
+                hr = init_scaler_filter(&This->filter_y, This->src_height, uiHeight, mode);
+            if (FAILED(hr))
+            {
+                free_scaler_filter(&This->filter_x);
+                if (This->source) IWICBitmapSource_Release(This->source);
+                if (This->transform) IWICBitmapSourceTransform_Release(This->transform);
+                This->source = NULL;
+                This->transform = NULL;
+                break;
+            }
+            This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+            This->fn_copy_scanline = Filter_CopyScanline;
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -384,12 +799,16 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->IWICBitmapScaler_iface.lpVtbl = &BitmapScaler_Vtbl;
     This->ref = 1;
     This->source = NULL;
+    This->transform = NULL;
     This->width = 0;
     This->height = 0;
     This->src_width = 0;
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->filter_row = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 
@@ -972,6 +973,271 @@ static void test_clipper(void)
     IWICBitmapClipper_Release(clipper);
 }
 
+static IWICBitmapScaler *create_scaler(IWICBitmapSource *source, UINT width, UINT height,
+                                       WICBitmapInterpolationMode mode, WICPixelFormatGUID *format)
+{
+    IWICBitmapScaler *scaler;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "CreateBitmapScaler error %#x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, source, width, height, mode);
+    ok(hr == S_OK, "%u: Initialize error %#x\n", mode, hr);
+
+    hr = IWICBitmapScaler_GetPixelFormat(scaler, format);
+    ok(hr == S_OK, "GetPixelFormat error %#x\n", hr);
+
+    return scaler;
+}
+
+/* Checks that the interior of a 1:2 downscaled 1-pixel checkerboard is
+ * filtered to mid gray, in 32bppBGRA. */
+static void check_scaled_checkerboard(IWICBitmapSource *source, UINT size, WICBitmapInterpolationMode mode)
+{
+    DWORD data[8 * 8];
+    IWICBitmapScaler *scaler;
+    WICPixelFormatGUID format;
+    UINT x, y, i;
+    HRESULT hr;
+
+    scaler = create_scaler(source, size / 2, size / 2, mode, &format);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat32bppBGRA),
+       "%u: unexpected format %s\n", mode, wine_dbgstr_guid(&format));
+
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, size / 2 * 4, sizeof(data), (BYTE *)data);
+    ok(hr == S_OK, "%u: CopyPixels error %#x\n", mode, hr);
+
+    for (y = 1; y < size / 2 - 1; y++)
+    {
+        for (x = 1; x < size / 2 - 1; x++)
+        {
+            DWORD pixel = data[y * size / 2 + x];
+
+            ok(pixel >> 24 == 0xff, "%u: %u,%u: got alpha %#x\n", mode, x, y, pixel >> 24);
+            for (i = 0; i < 24; i += 8)
+                ok(abs((int)((pixel >> i) & 0xff) - 0x80) <= 2, "%u: %u,%u: got %08x\n",
+                   mode, x, y, pixel);
+        }
+    }
+
+    IWICBitmapScaler_Release(scaler);
+}
+
+static void test_scaler_filtering(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+    };
+    static const WICColor colors[2] = { 0xff000000, 0xffffffff };
+    BYTE src_data[16 * 16 * 4], data[16 * 16 * 4];
+    IWICBitmapScaler *scaler;
+    IWICPalette *palette;
+    IWICBitmap *bitmap;
+    WICPixelFormatGUID format;
+    UINT i, x, y, d, lo, hi;
+    BYTE *pixel;
+    HRESULT hr;
+
+    /* Upscaling a gradient: blue follows x, green follows y. */
+    for (y = 0; y < 8; y++)
+    {
+        for (x = 0; x < 8; x++)
+        {
+            pixel = src_data + (y * 8 + x) * 4;
+            pixel[0] = x * 32;
+            pixel[1] = y * 32;
+            pixel[2] = 0x80;
+            pixel[3] = 0xff;
+        }
+    }
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 8, &GUID_WICPixelFormat32bppBGRA,
+                                                   32, 8 * 8 * 4, src_data, &bitmap);
+    ok(hr == S_OK, "IWICImagingFactory_CreateBitmapFromMemory error %#x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        scaler = create_scaler((IWICBitmapSource *)bitmap, 16, 16, modes[i], &format);
+        ok(IsEqualGUID(&format, &GUID_WICPixelFormat32bppBGRA),
+           "%u: unexpected format %s\n", modes[i], wine_dbgstr_guid(&format));
+
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 16 * 4, sizeof(data), data);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", modes[i], hr);
+
+        for (d = 0; d < 16; d++)
+        {
+            BYTE b = data[(5 * 16 + d) * 4], g = data[(d * 16 + 5) * 4 + 1];
+
+            /* Destination pixel d is centered on source coordinate d / 2 - 0.25. */
+            if (modes[i] == WICBitmapInterpolationModeFant)
+            {
+                lo = d < 2 ? 0 : (d - 1) / 2 * 32;
+                hi = d > 13 ? 224 : (d + 1) / 2 * 32;
+                ok(b >= lo && b <= hi, "%u: x %u: got %u, expected %u-%u\n", modes[i], d, b, lo, hi);
+                ok(g >= lo && g <= hi, "%u: y %u: got %u, expected %u-%u\n", modes[i], d, g, lo, hi);
+            }
+            else if (modes[i] == WICBitmapInterpolationModeLinear ? d >= 1 && d <= 14 : d >= 3 && d <= 12)
+            {
+                /* Both kernels reproduce a linear ramp away from the edges. */
+                ok(abs(b - (int)(d * 16 - 8)) <= 2, "%u: x %u: got %u, expected %u\n",
+                   modes[i], d, b, d * 16 - 8);
+                ok(abs(g - (int)(d * 16 - 8)) <= 2, "%u: y %u: got %u, expected %u\n",
+                   modes[i], d, g, d * 16 - 8);
+            }
+        }
+
+        for (d = 0; d < 16 * 16; d++)
+        {
+            if (data[d * 4 + 2] != 0x80 || data[d * 4 + 3] != 0xff)
+                break;
+        }
+        ok(d == 16 * 16, "%u: wrong red or alpha at pixel %u\n", modes[i], d);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* Downscaling a checkerboard averages it to gray. */
+    for (y = 0; y < 16; y++)
+    {
+        for (x = 0; x < 16; x++)
+        {
+            pixel = src_data + (y * 16 + x) * 4;
+            memset(pixel, (x ^ y) & 1 ? 0xff : 0, 3);
+            pixel[3] = 0xff;
+        }
+    }
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 16, 16, &GUID_WICPixelFormat32bppBGRA,
+                                                   64, 16 * 16 * 4, src_data, &bitmap);
+    ok(hr == S_OK, "IWICImagingFactory_CreateBitmapFromMemory error %#x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+        check_scaled_checkerboard((IWICBitmapSource *)bitmap, 16, modes[i]);
+
+    IWICBitmap_Release(bitmap);
+
+    /* Formats without 8-bit channels are filtered as 32bppBGRA. */
+    for (y = 0; y < 8; y++)
+        for (x = 0; x < 8; x++)
+            src_data[y * 8 + x] = (x ^ y) & 1;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 8, &GUID_WICPixelFormat8bppIndexed,
+                                                   8, 8 * 8, src_data, &bitmap);
+    ok(hr == S_OK, "IWICImagingFactory_CreateBitmapFromMemory error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreatePalette(factory, &palette);
+    ok(hr == S_OK, "CreatePalette error %#x\n", hr);
+    hr = IWICPalette_InitializeCustom(palette, (WICColor *)colors, 2);
+    ok(hr == S_OK, "InitializeCustom error %#x\n", hr);
+    hr = IWICBitmap_SetPalette(bitmap, palette);
+    ok(hr == S_OK, "SetPalette error %#x\n", hr);
+    IWICPalette_Release(palette);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+        check_scaled_checkerboard((IWICBitmapSource *)bitmap, 8, modes[i]);
+
+    /* Nearest neighbor keeps the source format. */
+    scaler = create_scaler((IWICBitmapSource *)bitmap, 4, 4, WICBitmapInterpolationModeNearestNeighbor, &format);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat8bppIndexed),
+       "unexpected format %s\n", wine_dbgstr_guid(&format));
+    IWICBitmapScaler_Release(scaler);
+
+    IWICBitmap_Release(bitmap);
+
+    for (y = 0; y < 8; y++)
+    {
+        for (x = 0; x < 8; x++)
+        {
+            pixel = src_data + (y * 8 + x) * 8;
+            memset(pixel, (x ^ y) & 1 ? 0xff : 0, 6);
+            pixel[6] = pixel[7] = 0xff;
+        }
+    }
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 8, &GUID_WICPixelFormat64bppRGBA,
+                                                   64, 8 * 8 * 8, src_data, &bitmap);
+    ok(hr == S_OK, "IWICImagingFactory_CreateBitmapFromMemory error %#x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+        check_scaled_checkerboard((IWICBitmapSource *)bitmap, 8, modes[i]);
+
+    IWICBitmap_Release(bitmap);
+}
+
+static void test_scaler(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+    };
+    static const struct
+    {
+        UINT width, height;
+    } sizes[] = { {11, 7}, {2, 2} };
+    BYTE src_data[5 * 3 * 3], data[11 * 7 * 3];
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    WICPixelFormatGUID format;
+    UINT i, j, k, width, height;
+    HRESULT hr;
+
+    for (i = 0; i < sizeof(src_data); i++)
+        src_data[i] = 0x20 + (i % 3) * 0x40;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 5, 3, &GUID_WICPixelFormat24bppBGR,
+                                                   15, sizeof(src_data), src_data, &bitmap);
+    ok(hr == S_OK, "IWICImagingFactory_CreateBitmapFromMemory error %#x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+        {
+            hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+            ok(hr == S_OK, "CreateBitmapScaler error %#x\n", hr);
+
+            hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap,
+                                             sizes[j].width, sizes[j].height, modes[i]);
+            ok(hr == S_OK, "%u: Initialize error %#x\n", modes[i], hr);
+
+            hr = IWICBitmapScaler_GetSize(scaler, &width, &height);
+            ok(hr == S_OK, "GetSize error %#x\n", hr);
+            ok(width == sizes[j].width && height == sizes[j].height,
+               "%u: got %ux%u\n", modes[i], width, height);
+
+            hr = IWICBitmapScaler_GetPixelFormat(scaler, &format);
+            ok(hr == S_OK, "GetPixelFormat error %#x\n", hr);
+            ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR),
+               "%u: unexpected format %s\n", modes[i], wine_dbgstr_guid(&format));
+
+            /* Any interpolation has to preserve a solid color. */
+            memset(data, 0, sizeof(data));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, width * 3, sizeof(data), data);
+            ok(hr == S_OK, "%u: CopyPixels error %#x\n", modes[i], hr);
+            for (k = 0; k < width * height * 3; k++)
+            {
+                if (data[k] != 0x20 + (k % 3) * 0x40)
+                    break;
+            }
+            ok(k == width * height * 3, "%u: %ux%u: wrong data at byte %u\n",
+               modes[i], width, height, k);
+
+            IWICBitmapScaler_Release(scaler);
+        }
+    }
+
+    IWICBitmap_Release(bitmap);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -988,6 +1254,8 @@ START_TEST(bitmap)
     test_CreateBitmapFromHICON();
     test_CreateBitmapFromHBITMAP();
     test_clipper();
+    test_scaler();
+    test_scaler_filtering();
 
     IWICImagingFactory_Release(factory);
 
@@ -311,6 +311,19 @@ static const BYTE bits_32bppBGRA[] = {
 static const struct bitmap_data testdata_32bppBGRA = {
     &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA, 4, 2, 96.0, 96.0};
 
+/* premultiplied values are chosen so that no rounding is involved */
+static const BYTE bits_32bppBGRA_alpha[] = {
+    255,0,85,51, 102,51,255,5, 10,20,30,0, 12,34,56,255,
+    170,85,0,3, 255,255,255,128, 0,0,0,77, 51,102,153,85};
+static const struct bitmap_data testdata_32bppBGRA_alpha = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA_alpha, 4, 2, 96.0, 96.0};
+
+static const BYTE bits_32bppPBGRA[] = {
+    51,0,17,51, 2,1,5,5, 0,0,0,0, 12,34,56,255,
+    2,1,0,3, 128,128,128,128, 0,0,0,77, 17,34,51,85};
+static const struct bitmap_data testdata_32bppPBGRA = {
+    &GUID_WICPixelFormat32bppPBGRA, 32, bits_32bppPBGRA, 4, 2, 96.0, 96.0};
+
 /* XP and 2003 use linear color conversion, later versions use sRGB gamma */
 static const float bits_32bppGrayFloat_xp[] = {
     0.114000f,0.587000f,0.299000f,0.000000f,
@@ -342,6 +355,31 @@ static const BYTE bits_24bppBGR_gray[] = {
 static const struct bitmap_data testdata_24bppBGR_gray = {
     &GUID_WICPixelFormat24bppBGR, 24, bits_24bppBGR_gray, 4, 2, 96.0, 96.0};
 
+static const BYTE bits_32bppBGRA_gray[] = {
+    76,76,76,255, 220,220,220,255, 127,127,127,255, 0,0,0,255,
+    247,247,247,255, 145,145,145,255, 230,230,230,255, 255,255,255,255};
+static const struct bitmap_data testdata_32bppBGRA_gray = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA_gray, 4, 2, 96.0, 96.0};
+
+/* wide enough for the vectorized conversions to handle part of each row */
+static const BYTE bits_24bppBGR_wide[] = {
+    1,2,3, 4,5,6, 7,8,9, 10,11,12, 13,14,15,
+    16,17,18, 19,20,21, 22,23,24, 25,26,27, 28,29,30};
+static const struct bitmap_data testdata_24bppBGR_wide = {
+    &GUID_WICPixelFormat24bppBGR, 24, bits_24bppBGR_wide, 10, 1, 96.0, 96.0};
+
+static const BYTE bits_24bppRGB_wide[] = {
+    3,2,1, 6,5,4, 9,8,7, 12,11,10, 15,14,13,
+    18,17,16, 21,20,19, 24,23,22, 27,26,25, 30,29,28};
+static const struct bitmap_data testdata_24bppRGB_wide = {
+    &GUID_WICPixelFormat24bppRGB, 24, bits_24bppRGB_wide, 10, 1, 96.0, 96.0};
+
+static const BYTE bits_32bppBGRA_wide[] = {
+    1,2,3,255, 4,5,6,255, 7,8,9,255, 10,11,12,255, 13,14,15,255,
+    16,17,18,255, 19,20,21,255, 22,23,24,255, 25,26,27,255, 28,29,30,255};
+static const struct bitmap_data testdata_32bppBGRA_wide = {
+    &GUID_WICPixelFormat32bppBGRA, 32, bits_32bppBGRA_wide, 10, 1, 96.0, 96.0};
+
 static void test_conversion(const struct bitmap_data *src, const struct bitmap_data *dst, const char *name, BOOL todo)
 {
     BitmapTestSrc *src_obj;
@@ -835,6 +873,7 @@ START_TEST(converter)
     test_conversion(&testdata_32bppBGRA, &testdata_32bppBGR, "BGRA -> BGR", FALSE);
     test_conversion(&testdata_32bppBGR, &testdata_32bppBGRA, "BGR -> BGRA", FALSE);
     test_conversion(&testdata_32bppBGRA, &testdata_32bppBGRA, "BGRA -> BGRA", FALSE);
+    test_conversion(&testdata_32bppBGRA_alpha, &testdata_32bppPBGRA, "BGRA -> PBGRA", FALSE);
 
     test_conversion(&testdata_24bppBGR, &testdata_24bppBGR, "24bppBGR -> 24bppBGR", FALSE);
     test_conversion(&testdata_24bppBGR, &testdata_24bppRGB, "24bppBGR -> 24bppRGB", FALSE);
@@ -844,6 +883,10 @@ START_TEST(converter)
 
     test_conversion(&testdata_32bppBGR, &testdata_24bppRGB, "32bppBGR -> 24bppRGB", FALSE);
     test_conversion(&testdata_24bppRGB, &testdata_32bppBGR, "24bppRGB -> 32bppBGR", FALSE);
+    test_conversion(&testdata_24bppBGR, &testdata_32bppBGRA, "24bppBGR -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_24bppRGB, &testdata_32bppBGRA, "24bppRGB -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_24bppBGR_wide, &testdata_32bppBGRA_wide, "wide 24bppBGR -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_24bppRGB_wide, &testdata_32bppBGRA_wide, "wide 24bppRGB -> 32bppBGRA", FALSE);
     test_conversion(&testdata_32bppBGRA, &testdata_24bppRGB, "32bppBGRA -> 24bppRGB", FALSE);
 
     test_conversion(&testdata_24bppRGB, &testdata_32bppGrayFloat, "24bppRGB -> 32bppGrayFloat", FALSE);
@@ -852,6 +895,7 @@ START_TEST(converter)
     test_conversion(&testdata_24bppBGR, &testdata_8bppGray, "24bppBGR -> 8bppGray", FALSE);
     test_conversion(&testdata_32bppBGR, &testdata_8bppGray, "32bppBGR -> 8bppGray", FALSE);
     test_conversion(&testdata_32bppGrayFloat, &testdata_24bppBGR_gray, "32bppGrayFloat -> 24bppBGR gray", FALSE);
+    test_conversion(&testdata_8bppGray, &testdata_32bppBGRA_gray, "8bppGray -> 32bppBGRA", FALSE);
 
     test_invalid_conversion();
     test_default_converter();
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2026 agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COBJMACROS
+
+#include "windef.h"
+#include "wincodec.h"
+#include "wine/test.h"
+
+/* 16x32 grayscale JPEG image made of uniform 8x8 blocks, see block_value() */
+static const BYTE jpeg_16x32[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01,
+  0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43,
+  0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0xff, 0xc0, 0x00, 0x0b, 0x08, 0x00, 0x20,
+  0x00, 0x10, 0x01, 0x01, 0x11, 0x00, 0xff, 0xc4, 0x00, 0x16, 0x00, 0x01,
+  0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x08, 0x09, 0x0a, 0xff, 0xc4, 0x00, 0x14, 0x10, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00,
+  0x3f, 0x00, 0xc7, 0xf9, 0x00, 0xb0, 0x04, 0x02, 0xc0, 0x10, 0x0b, 0x00,
+  0x40, 0x3f, 0xff, 0xd9
+};
+
+static IWICImagingFactory *factory;
+
+static IWICBitmapDecoder *create_decoder(const void *image_data, UINT image_size)
+{
+    HGLOBAL hmem;
+    BYTE *data;
+    HRESULT hr;
+    IWICBitmapDecoder *decoder = NULL;
+    IStream *stream;
+    GUID format;
+    LONG refcount;
+
+    hmem = GlobalAlloc(0, image_size);
+    data = GlobalLock(hmem);
+    memcpy(data, image_data, image_size);
+    GlobalUnlock(hmem);
+
+    hr = CreateStreamOnHGlobal(hmem, TRUE, &stream);
+    ok(hr == S_OK, "CreateStreamOnHGlobal error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+    if (FAILED(hr)) return NULL;
+
+    hr = IWICBitmapDecoder_GetContainerFormat(decoder, &format);
+    ok(hr == S_OK, "GetContainerFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_ContainerFormatJpeg),
+       "wrong container format %s\n", wine_dbgstr_guid(&format));
+
+    refcount = IStream_Release(stream);
+    ok(refcount > 0, "expected stream refcount > 0\n");
+
+    return decoder;
+}
+
+/* value of the pixel at x,y of the image scaled down by scale */
+static BYTE block_value(INT x, INT y, UINT scale)
+{
+    return 32 + (y * scale / 8) * 64 + (x * scale / 8) * 16;
+}
+
+static BOOL check_16x32_pixels(const BYTE *data, const WICRect *rc, UINT stride, UINT scale)
+{
+    INT x, y;
+
+    for (y = 0; y < rc->Height; y++)
+    {
+        for (x = 0; x < rc->Width; x++)
+        {
+            if (abs(data[y * stride + x] - block_value(rc->X + x, rc->Y + y, scale)) > 1)
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void test_jpeg_copy_pixels(void)
+{
+    static const WICRect rects[] =
+    {
+        /* out of order, going back up the image */
+        { 8, 24, 8, 8 },
+        { 0, 0, 16, 16 },
+        { 3, 20, 10, 4 },
+        { 0, 16, 16, 16 },
+    };
+    HRESULT hr;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    WICRect rc;
+    BYTE data[16 * 32];
+    GUID format;
+    UINT width, height, i;
+
+    decoder = create_decoder(jpeg_16x32, sizeof(jpeg_16x32));
+    ok(decoder != 0, "Failed to load JPEG image data\n");
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    hr = IWICBitmapFrameDecode_GetPixelFormat(frame, &format);
+    ok(hr == S_OK, "GetPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat8bppGray),
+       "got wrong format %s\n", wine_dbgstr_guid(&format));
+
+    hr = IWICBitmapFrameDecode_GetSize(frame, &width, &height);
+    ok(hr == S_OK, "GetSize error %#x\n", hr);
+    ok(width == 16 && height == 32, "got %ux%u\n", width, height);
+
+    /* scanline by scanline from top to bottom */
+    for (i = 0; i < 32; i++)
+    {
+        rc.X = 2;
+        rc.Y = i;
+        rc.Width = 12;
+        rc.Height = 1;
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 12, 12, data);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+        ok(check_16x32_pixels(data, &rc, 12, 1), "%u: wrong pixel data\n", i);
+    }
+
+    for (i = 0; i < sizeof(rects) / sizeof(rects[0]); i++)
+    {
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rects[i], 16, sizeof(data), data);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+        ok(check_16x32_pixels(data, &rects[i], 16, 1), "%u: wrong pixel data\n", i);
+    }
+
+    rc.X = 0;
+    rc.Y = 0;
+    rc.Width = 16;
+    rc.Height = 32;
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 16, sizeof(data), data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(check_16x32_pixels(data, &rc, 16, 1), "wrong pixel data\n");
+
+    rc.Y = 8;
+    rc.Height = 0;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 16, 0, data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+
+    rc.Height = 2;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 15, sizeof(data), data);
+    ok(hr == E_INVALIDARG, "expected E_INVALIDARG, got %#x\n", hr);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
+static void test_jpeg_source_transform(void)
+{
+    HRESULT hr;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapSourceTransform *transform;
+    WICPixelFormatGUID format = GUID_WICPixelFormat8bppGray;
+    WICRect rc;
+    BYTE data[16 * 32];
+    UINT width, height, scale, i;
+
+    decoder = create_decoder(jpeg_16x32, sizeof(jpeg_16x32));
+    ok(decoder != 0, "Failed to load JPEG image data\n");
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    hr = IWICBitmapFrameDecode_QueryInterface(frame, &IID_IWICBitmapSourceTransform, (void **)&transform);
+    if (FAILED(hr))
+    {
+        win_skip("IWICBitmapSourceTransform is not supported\n");
+        IWICBitmapFrameDecode_Release(frame);
+        IWICBitmapDecoder_Release(decoder);
+        return;
+    }
+
+    width = 2;
+    height = 4;
+    hr = IWICBitmapSourceTransform_GetClosestSize(transform, &width, &height);
+    ok(hr == S_OK, "GetClosestSize error %#x\n", hr);
+    ok(width >= 2 && width <= 16 && height >= 4 && height <= 32, "got %ux%u\n", width, height);
+
+    scale = 32 / height;
+    if (scale * height != 32 || scale * width != 16)
+    {
+        skip("can't check %ux%u scaled image\n", width, height);
+        IWICBitmapSourceTransform_Release(transform);
+        IWICBitmapFrameDecode_Release(frame);
+        IWICBitmapDecoder_Release(decoder);
+        return;
+    }
+
+    rc.X = 0;
+    rc.Y = 0;
+    rc.Width = width;
+    rc.Height = height;
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapSourceTransform_CopyPixels(transform, NULL, width, height, &format,
+                                              WICBitmapTransformRotate0, width, sizeof(data), data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(check_16x32_pixels(data, &rc, width, scale), "wrong pixel data\n");
+
+    /* scaled rows from the bottom up */
+    for (i = height; i > 0; i--)
+    {
+        rc.X = 0;
+        rc.Y = i - 1;
+        rc.Width = width;
+        rc.Height = 1;
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapSourceTransform_CopyPixels(transform, &rc, width, height, &format,
+                                                  WICBitmapTransformRotate0, width, width, data);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+        ok(check_16x32_pixels(data, &rc, width, scale), "%u: wrong pixel data\n", i);
+    }
+
+    /* full size after a scaled decode */
+    rc.X = 0;
+    rc.Y = 4;
+    rc.Width = 16;
+    rc.Height = 20;
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 16, sizeof(data), data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(check_16x32_pixels(data, &rc, 16, 1), "wrong pixel data\n");
+
+    IWICBitmapSourceTransform_Release(transform);
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
+static void test_jpeg_scaler(void)
+{
+    static const struct
+    {
+        UINT width, height;
+        WICBitmapInterpolationMode mode;
+    } tests[] =
+    {
+        { 8, 16, WICBitmapInterpolationModeFant },
+        { 4, 8, WICBitmapInterpolationModeFant },
+        { 2, 4, WICBitmapInterpolationModeNearestNeighbor },
+        /* between the 1/2 and 1/1 decoder scales, 4:3 from 8x16 */
+        { 6, 12, WICBitmapInterpolationModeFant },
+    };
+    HRESULT hr;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapScaler *scaler;
+    WICPixelFormatGUID format;
+    WICRect rc;
+    BYTE data[16 * 32];
+    UINT width, height, i, x, y;
+    BOOL match;
+
+    decoder = create_decoder(jpeg_16x32, sizeof(jpeg_16x32));
+    ok(decoder != 0, "Failed to load JPEG image data\n");
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "CreateBitmapScaler error %#x\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)frame,
+                                         tests[i].width, tests[i].height, tests[i].mode);
+        ok(hr == S_OK, "%u: Initialize error %#x\n", i, hr);
+
+        hr = IWICBitmapScaler_GetSize(scaler, &width, &height);
+        ok(hr == S_OK, "%u: GetSize error %#x\n", i, hr);
+        ok(width == tests[i].width && height == tests[i].height, "%u: got %ux%u\n", i, width, height);
+
+        hr = IWICBitmapScaler_GetPixelFormat(scaler, &format);
+        ok(hr == S_OK, "%u: GetPixelFormat error %#x\n", i, hr);
+        ok(IsEqualGUID(&format, &GUID_WICPixelFormat8bppGray),
+           "%u: got wrong format %s\n", i, wine_dbgstr_guid(&format));
+
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, width, sizeof(data), data);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+
+        if (16 % width == 0)
+        {
+            rc.X = 0;
+            rc.Y = 0;
+            rc.Width = width;
+            rc.Height = height;
+            ok(check_16x32_pixels(data, &rc, width, 16 / width), "%u: wrong pixel data\n", i);
+        }
+        else
+        {
+            /* every 3x3 destination block covers exactly one 8x8 source block */
+            match = TRUE;
+            for (y = 0; y < height; y++)
+                for (x = 0; x < width; x++)
+                    if (abs(data[y * width + x] - (32 + (y / 3) * 64 + (x / 3) * 16)) > 1)
+                        match = FALSE;
+            ok(match, "%u: wrong pixel data\n", i);
+        }
+
+        /* a single row from the bottom of the image */
+        rc.X = 0;
+        rc.Y = height - 1;
+        rc.Width = width;
+        rc.Height = 1;
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapScaler_CopyPixels(scaler, &rc, width, width, data);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+        if (16 % width == 0)
+            ok(check_16x32_pixels(data, &rc, width, 16 / width), "%u: wrong pixel data in the last row\n", i);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    /* the frame still decodes at full size afterwards */
+    rc.X = 0;
+    rc.Y = 0;
+    rc.Width = 16;
+    rc.Height = 32;
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 16, sizeof(data), data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(check_16x32_pixels(data, &rc, 16, 1), "wrong pixel data\n");
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
+START_TEST(jpegformat)
+{
+    HRESULT hr;
+
+    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+                          &IID_IWICImagingFactory, (void **)&factory);
+    ok(hr == S_OK, "CoCreateInstance error %#x\n", hr);
+    if (FAILED(hr)) return;
+
+    test_jpeg_copy_pixels();
+    test_jpeg_source_transform();
+    test_jpeg_scaler();
+
+    IWICImagingFactory_Release(factory);
+    CoUninitialize();
+}
@@ -579,6 +579,96 @@ static void test_png_palette(void)
     IWICBitmapDecoder_Release(decoder);
 }
 
+/* 24 bpp 4x3 PNG image, pixel (x,y) has red x * 0x40, green y * 0x40 and blue 0x80 */
+static const char png_4x3[] = {
+  0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+  0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x03,
+  0x08, 0x02, 0x00, 0x00, 0x00, 0x3b, 0x96, 0x39, 0x91, 0x00, 0x00, 0x00,
+  0x23, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x15, 0xc7, 0x31, 0x01, 0x00,
+  0x30, 0x0c, 0x84, 0x40, 0xa4, 0x21, 0x0d, 0x69, 0x2f, 0xad, 0x0d, 0xd3,
+  0x01, 0x24, 0x45, 0x23, 0x30, 0x2d, 0x9b, 0x7f, 0x0e, 0xd7, 0xea, 0x01,
+  0xe0, 0xa7, 0x0d, 0x81, 0x61, 0xa9, 0x74, 0xbb, 0x00, 0x00, 0x00, 0x00,
+  0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+};
+
+static BOOL check_4x3_pixels(const BYTE *data, const WICRect *rc, UINT stride)
+{
+    INT x, y;
+
+    for (y = 0; y < rc->Height; y++)
+    {
+        for (x = 0; x < rc->Width; x++)
+        {
+            const BYTE *pixel = data + y * stride + x * 3;
+            if (pixel[0] != 0x80 || pixel[1] != (rc->Y + y) * 0x40 || pixel[2] != (rc->X + x) * 0x40)
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void test_png_copy_pixels(void)
+{
+    HRESULT hr;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    WICRect rc;
+    BYTE data[4 * 3 * 3];
+    GUID format;
+    INT y;
+
+    decoder = create_decoder(png_4x3, sizeof(png_4x3));
+    ok(decoder != 0, "Failed to load PNG image data\n");
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    hr = IWICBitmapFrameDecode_GetPixelFormat(frame, &format);
+    ok(hr == S_OK, "GetPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR),
+       "got wrong format %s\n", wine_dbgstr_guid(&format));
+
+    /* scanline by scanline from top to bottom */
+    for (y = 0; y < 3; y++)
+    {
+        rc.X = 1;
+        rc.Y = y;
+        rc.Width = 3;
+        rc.Height = 1;
+        memset(data, 0, sizeof(data));
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 9, 9, data);
+        ok(hr == S_OK, "%d: CopyPixels error %#x\n", y, hr);
+        ok(check_4x3_pixels(data, &rc, 9), "%d: wrong pixel data\n", y);
+    }
+
+    /* the whole image again */
+    rc.X = 0;
+    rc.Y = 0;
+    rc.Width = 4;
+    rc.Height = 3;
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 12, sizeof(data), data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(check_4x3_pixels(data, &rc, 12), "wrong pixel data\n");
+
+    rc.X = 0;
+    rc.Y = 1;
+    rc.Width = 2;
+    rc.Height = 2;
+    memset(data, 0, sizeof(data));
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 6, sizeof(data), data);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+    ok(check_4x3_pixels(data, &rc, 6), "wrong pixel data\n");
+
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, 5, sizeof(data), data);
+    ok(hr == E_INVALIDARG, "expected E_INVALIDARG, got %#x\n", hr);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -591,6 +681,7 @@ START_TEST(pngformat)
 
     test_color_contexts();
     test_png_palette();
+    test_png_copy_pixels();
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
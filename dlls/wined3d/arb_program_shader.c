@@ -5963,12 +5963,12 @@ static void alpha_test_arbfp(struct wined3d_context *context, const struct wined
 
     if (state->render_states[WINED3D_RS_ALPHATESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable GL_ALPHA_TEST");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable GL_ALPHA_TEST");
         return;
     }
@@ -40,6 +40,8 @@ WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 #define VB_MAXFULLCONVERSIONS 5       /* Number of full conversions before we stop converting */
 #define VB_RESETFULLCONVS     20      /* Reset full conversion counts after that number of draws */
 
+#define WINED3D_BUFFER_MAX_RETIRED_BOS 32  /* Number of retired persistent BOs kept for reuse per device */
+
 static void wined3d_buffer_evict_sysmem(struct wined3d_buffer *buffer)
 {
     if (buffer->flags & WINED3D_BUFFER_PIN_SYSMEM)
@@ -143,24 +145,10 @@ static void buffer_bind(struct wined3d_buffer *buffer, struct wined3d_context *c
     GL_EXTCALL(glBindBuffer(buffer->buffer_type_hint, buffer->buffer_object));
 }
 
-/* Context activation is done by the caller. */
-static void buffer_destroy_buffer_object(struct wined3d_buffer *buffer, const struct wined3d_context *context)
+static void buffer_invalidate_bindings(struct wined3d_buffer *buffer)
 {
-    const struct wined3d_gl_info *gl_info = context->gl_info;
     struct wined3d_resource *resource = &buffer->resource;
 
-    if (!buffer->buffer_object)
-        return;
-
-    GL_EXTCALL(glDeleteBuffers(1, &buffer->buffer_object));
-    checkGLcall("glDeleteBuffers");
-    buffer->buffer_object = 0;
-
-    /* The stream source state handler might have read the memory of the
-     * vertex buffer already and got the memory in the vbo which is not
-     * valid any longer. Dirtify the stream source to force a reload. This
-     * happens only once per changed vertexbuffer and should occur rather
-     * rarely. */
     if (resource->bind_count)
     {
         if (buffer->bind_flags & WINED3D_BIND_VERTEX_BUFFER)
@@ -177,6 +165,183 @@ static void buffer_destroy_buffer_object(struct wined3d_buffer *buffer, const st
             device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_COMPUTE));
         }
     }
+}
+
+/* Dynamic buffers are backed by persistently mapped buffer objects when
+ * GL_ARB_buffer_storage is available. NOOVERWRITE maps then simply return the
+ * persistent pointer, while DISCARD maps switch the buffer to a different
+ * buffer object. Buffer objects replaced that way are fenced and kept on a
+ * per-device list in retirement order, and are reused by later DISCARD maps
+ * of buffers of the same size once the GPU is done with them. */
+static BOOL buffer_use_persistent_bo(const struct wined3d_buffer *buffer, const struct wined3d_gl_info *gl_info)
+{
+    /* Views and stream output targets reference the GL buffer object
+     * directly, so only buffers that are bound through device state can be
+     * switched to a different buffer object. */
+    static const unsigned int renamable_bind_flags = WINED3D_BIND_VERTEX_BUFFER
+            | WINED3D_BIND_INDEX_BUFFER | WINED3D_BIND_CONSTANT_BUFFER;
+
+    return (buffer->resource.usage & WINED3DUSAGE_DYNAMIC)
+            && !(buffer->bind_flags & ~renamable_bind_flags)
+            && gl_info->supported[ARB_BUFFER_STORAGE] && gl_info->supported[ARB_SYNC];
+}
+
+/* Context activation is done by the caller. */
+static void buffer_delete_persistent_bo(const struct wined3d_gl_info *gl_info, struct wined3d_persistent_bo *bo)
+{
+    /* Deleting the buffer object implicitly unmaps it. */
+    GL_EXTCALL(glDeleteBuffers(1, &bo->name));
+    checkGLcall("glDeleteBuffers");
+    if (bo->query)
+        wined3d_event_query_destroy(bo->query);
+    HeapFree(GetProcessHeap(), 0, bo);
+}
+
+/* Context activation is done by the caller. */
+static struct wined3d_persistent_bo *buffer_create_persistent_bo(struct wined3d_buffer *buffer,
+        struct wined3d_context *context)
+{
+    static const GLbitfield map_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+            | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct wined3d_persistent_bo *bo;
+    GLenum error;
+
+    if (!(bo = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*bo))))
+        return NULL;
+
+    while (gl_info->gl_ops.gl.p_glGetError() != GL_NO_ERROR);
+
+    if (buffer->buffer_type_hint == GL_ELEMENT_ARRAY_BUFFER)
+        context_invalidate_state(context, STATE_INDEXBUFFER);
+
+    GL_EXTCALL(glGenBuffers(1, &bo->name));
+    GL_EXTCALL(glBindBuffer(buffer->buffer_type_hint, bo->name));
+    GL_EXTCALL(glBufferStorage(buffer->buffer_type_hint, buffer->resource.size, NULL,
+            map_flags | GL_DYNAMIC_STORAGE_BIT));
+    if ((error = gl_info->gl_ops.gl.p_glGetError()) == GL_NO_ERROR)
+    {
+        bo->map_ptr = GL_EXTCALL(glMapBufferRange(buffer->buffer_type_hint,
+                0, buffer->resource.size, map_flags));
+        error = gl_info->gl_ops.gl.p_glGetError();
+    }
+
+    if (!bo->map_ptr || ((DWORD_PTR)bo->map_ptr) & (RESOURCE_ALIGNMENT - 1))
+    {
+        WARN("Failed to create a persistently mapped BO, error %s (%#x), pointer %p.\n",
+                debug_glerror(error), error, bo->map_ptr);
+        GL_EXTCALL(glDeleteBuffers(1, &bo->name));
+        HeapFree(GetProcessHeap(), 0, bo);
+        return NULL;
+    }
+    bo->size = buffer->resource.size;
+
+    TRACE("Created persistently mapped BO %u for buffer %p, pointer %p.\n", bo->name, buffer, bo->map_ptr);
+
+    return bo;
+}
+
+/* Context activation is done by the caller. Replaces the buffer object of a
+ * buffer using a persistently mapped buffer object on DISCARD maps. */
+static BOOL buffer_rename_persistent_bo(struct wined3d_buffer *buffer, struct wined3d_context *context)
+{
+    struct wined3d_persistent_bo *old_bo = buffer->persistent_bo, *new_bo = NULL, *bo;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct wined3d_device *device = buffer->resource.device;
+    enum wined3d_event_query_result ret;
+
+    /* The list is in retirement order, so if the oldest suitable buffer
+     * object is still busy, the newer ones are busy as well. */
+    LIST_FOR_EACH_ENTRY(bo, &device->retired_bos, struct wined3d_persistent_bo, entry)
+    {
+        if (bo->size != old_bo->size)
+            continue;
+
+        ret = wined3d_event_query_test(bo->query, device, 0);
+        if (ret == WINED3D_EVENT_QUERY_OK || ret == WINED3D_EVENT_QUERY_NOT_STARTED)
+            new_bo = bo;
+        break;
+    }
+
+    if (new_bo)
+    {
+        TRACE("Reusing retired BO %u for buffer %p.\n", new_bo->name, buffer);
+        list_remove(&new_bo->entry);
+        --device->retired_bo_count;
+    }
+    else if (!(new_bo = buffer_create_persistent_bo(buffer, context)))
+    {
+        return FALSE;
+    }
+
+    if (!old_bo->query && !(old_bo->query = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*old_bo->query))))
+    {
+        ERR("Failed to allocate event query memory.\n");
+        buffer_delete_persistent_bo(gl_info, old_bo);
+    }
+    else
+    {
+        wined3d_event_query_issue(old_bo->query, device);
+        list_add_tail(&device->retired_bos, &old_bo->entry);
+        ++device->retired_bo_count;
+    }
+
+    /* Deleting a buffer object the GPU still uses is fine, GL defers the
+     * actual destruction. */
+    while (device->retired_bo_count > WINED3D_BUFFER_MAX_RETIRED_BOS)
+    {
+        bo = LIST_ENTRY(list_head(&device->retired_bos), struct wined3d_persistent_bo, entry);
+        list_remove(&bo->entry);
+        --device->retired_bo_count;
+        buffer_delete_persistent_bo(gl_info, bo);
+    }
+
+    buffer->persistent_bo = new_bo;
+    buffer->buffer_object = new_bo->name;
+    buffer_invalidate_bindings(buffer);
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+void buffer_destroy_retired_bos(struct wined3d_device *device, const struct wined3d_context *context)
+{
+    struct wined3d_persistent_bo *bo, *cursor;
+
+    LIST_FOR_EACH_ENTRY_SAFE(bo, cursor, &device->retired_bos, struct wined3d_persistent_bo, entry)
+    {
+        list_remove(&bo->entry);
+        buffer_delete_persistent_bo(context->gl_info, bo);
+    }
+    device->retired_bo_count = 0;
+}
+
+/* Context activation is done by the caller. */
+static void buffer_destroy_buffer_object(struct wined3d_buffer *buffer, const struct wined3d_context *context)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    if (!buffer->buffer_object)
+        return;
+
+    if (buffer->persistent_bo)
+    {
+        buffer_delete_persistent_bo(gl_info, buffer->persistent_bo);
+        buffer->persistent_bo = NULL;
+    }
+    else
+    {
+        GL_EXTCALL(glDeleteBuffers(1, &buffer->buffer_object));
+        checkGLcall("glDeleteBuffers");
+    }
+    buffer->buffer_object = 0;
+
+    /* The stream source state handler might have read the memory of the
+     * vertex buffer already and got the memory in the vbo which is not
+     * valid any longer. Dirtify the stream source to force a reload. This
+     * happens only once per changed vertexbuffer and should occur rather
+     * rarely. */
+    buffer_invalidate_bindings(buffer);
 
     if (buffer->query)
     {
@@ -203,6 +368,18 @@ static BOOL buffer_create_buffer_object(struct wined3d_buffer *buffer, struct wi
      */
     while (gl_info->gl_ops.gl.p_glGetError() != GL_NO_ERROR);
 
+    if (buffer_use_persistent_bo(buffer, gl_info))
+    {
+        if ((buffer->persistent_bo = buffer_create_persistent_bo(buffer, context)))
+        {
+            buffer->buffer_object = buffer->persistent_bo->name;
+            buffer->buffer_object_usage = GL_STREAM_DRAW_ARB;
+            buffer_invalidate_bo_range(buffer, 0, 0);
+            return TRUE;
+        }
+        WARN("Falling back to a regular BO for buffer %p.\n", buffer);
+    }
+
     /* Basically the FVF parameter passed to CreateVertexBuffer is no good.
      * The vertex declaration from the device determines how the data in the
      * buffer is interpreted. This means that on each draw call the buffer has
@@ -1058,7 +1235,18 @@ static HRESULT wined3d_buffer_map(struct wined3d_buffer *buffer, UINT offset, UI
             if ((flags & WINED3D_MAP_DISCARD) && buffer->resource.heap_memory)
                 wined3d_buffer_evict_sysmem(buffer);
 
-            if (count == 1)
+            if (count == 1 && buffer->persistent_bo)
+            {
+                /* Writing to a buffer object the GPU may still be reading
+                 * from would need a glFinish() here, so use a different one. */
+                if ((flags & WINED3D_MAP_DISCARD) && !buffer_rename_persistent_bo(buffer, context))
+                {
+                    WARN("Failed to rename buffer %p, synchronising.\n", buffer);
+                    gl_info->gl_ops.gl.p_glFinish();
+                }
+                buffer->map_ptr = buffer->persistent_bo->map_ptr;
+            }
+            else if (count == 1)
             {
                 buffer_bind(buffer, context);
 
@@ -1144,7 +1332,13 @@ static void wined3d_buffer_unmap(struct wined3d_buffer *buffer)
         return;
     }
 
-    if (buffer->map_ptr)
+    if (buffer->map_ptr && buffer->persistent_bo)
+    {
+        /* The mapping is coherent, there's nothing to flush. */
+        buffer_clear_dirty_areas(buffer);
+        buffer->map_ptr = NULL;
+    }
+    else if (buffer->map_ptr)
     {
         struct wined3d_device *device = buffer->resource.device;
         const struct wined3d_gl_info *gl_info;
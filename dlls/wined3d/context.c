@@ -2226,28 +2226,28 @@ static void SetupForBlit(const struct wined3d_device *device, struct wined3d_con
     }
 
     /* Other misc states */
-    gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+    context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
     checkGLcall("glDisable(GL_ALPHA_TEST)");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ALPHATESTENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_LIGHTING);
+    context_set_gl_cap(context, GL_LIGHTING, FALSE);
     checkGLcall("glDisable GL_LIGHTING");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_LIGHTING));
-    gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_TEST);
+    context_set_gl_cap(context, GL_DEPTH_TEST, FALSE);
     checkGLcall("glDisable GL_DEPTH_TEST");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ZENABLE));
     glDisableWINE(GL_FOG);
     checkGLcall("glDisable GL_FOG");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_FOGENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
+    context_set_gl_cap(context, GL_BLEND, FALSE);
     checkGLcall("glDisable GL_BLEND");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ALPHABLENDENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_CULL_FACE);
+    context_set_gl_cap(context, GL_CULL_FACE, FALSE);
     checkGLcall("glDisable GL_CULL_FACE");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_CULLMODE));
-    gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
+    context_set_gl_cap(context, GL_STENCIL_TEST, FALSE);
     checkGLcall("glDisable GL_STENCIL_TEST");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    context_set_gl_cap(context, GL_SCISSOR_TEST, FALSE);
     checkGLcall("glDisable GL_SCISSOR_TEST");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
     if (gl_info->supported[ARB_POINT_SPRITE])
@@ -2447,6 +2447,56 @@ void context_bind_texture(struct wined3d_context *context, GLenum target, GLuint
     }
 }
 
+static unsigned int context_get_gl_cap_idx(GLenum cap)
+{
+    switch (cap)
+    {
+        case GL_ALPHA_TEST:             return 0;
+        case GL_BLEND:                  return 1;
+        case GL_CULL_FACE:              return 2;
+        case GL_DEPTH_TEST:             return 3;
+        case GL_DITHER:                 return 4;
+        case GL_FRAMEBUFFER_SRGB:       return 5;
+        case GL_LIGHTING:               return 6;
+        case GL_POLYGON_OFFSET_FILL:    return 7;
+        case GL_SCISSOR_TEST:           return 8;
+        case GL_STENCIL_TEST:           return 9;
+        default:                        return ~0u;
+    }
+}
+
+/* Context activation is done by the caller. State handlers commonly get
+ * invoked because some related state changed, and would otherwise keep
+ * setting capabilities to the value they already have. All changes to the
+ * capabilities tracked here have to go through this function. */
+void context_set_gl_cap(struct wined3d_context *context, GLenum cap, BOOL enable)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    unsigned int idx = context_get_gl_cap_idx(cap);
+    DWORD mask;
+
+    if (idx != ~0u)
+    {
+        mask = 1u << idx;
+        if ((context->gl_caps_valid & mask) && !(context->gl_caps_enabled & mask) == !enable)
+        {
+            ++context->state_stats.filtered_caps;
+            return;
+        }
+        context->gl_caps_valid |= mask;
+        if (enable)
+            context->gl_caps_enabled |= mask;
+        else
+            context->gl_caps_enabled &= ~mask;
+    }
+
+    ++context->state_stats.applied_caps;
+    if (enable)
+        gl_info->gl_ops.gl.p_glEnable(cap);
+    else
+        gl_info->gl_ops.gl.p_glDisable(cap);
+}
+
 static void context_set_render_offscreen(struct wined3d_context *context, BOOL offscreen)
 {
     if (context->render_offscreen == offscreen) return;
@@ -2689,14 +2739,14 @@ BOOL context_apply_clear_state(struct wined3d_context *context, const struct win
     /* Blending and clearing should be orthogonal, but tests on the nvidia
      * driver show that disabling blending when clearing improves the clearing
      * performance incredibly. */
-    gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
-    gl_info->gl_ops.gl.p_glEnable(GL_SCISSOR_TEST);
+    context_set_gl_cap(context, GL_BLEND, FALSE);
+    context_set_gl_cap(context, GL_SCISSOR_TEST, TRUE);
     if (rt_count && gl_info->supported[ARB_FRAMEBUFFER_SRGB])
     {
         if (needs_srgb_write(context, state, fb))
-            gl_info->gl_ops.gl.p_glEnable(GL_FRAMEBUFFER_SRGB);
+            context_set_gl_cap(context, GL_FRAMEBUFFER_SRGB, TRUE);
         else
-            gl_info->gl_ops.gl.p_glDisable(GL_FRAMEBUFFER_SRGB);
+            context_set_gl_cap(context, GL_FRAMEBUFFER_SRGB, FALSE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SRGBWRITEENABLE));
     }
     checkGLcall("setting up state for clear");
@@ -3533,6 +3583,7 @@ BOOL context_apply_draw_state(struct wined3d_context *context,
             wined3d_buffer_load_sysmem(state->index_buffer, context);
     }
 
+    context->state_stats.applied_states += context->numDirtyEntries;
     for (i = 0; i < context->numDirtyEntries; ++i)
     {
         DWORD rep = context->dirtyArray[i];
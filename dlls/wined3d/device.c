@@ -989,6 +989,7 @@ static void wined3d_device_delete_opengl_contexts_cs(void *object)
     device->shader_backend->shader_free_private(device);
     destroy_dummy_textures(device, context);
     destroy_default_samplers(device, context);
+    buffer_destroy_retired_bos(device, context);
     context_release(context);
 
     while (device->context_count)
@@ -1003,6 +1004,7 @@ static void wined3d_device_delete_opengl_contexts_cs(void *object)
 static void wined3d_device_delete_opengl_contexts(struct wined3d_device *device)
 {
     wined3d_cs_destroy_object(device->cs, wined3d_device_delete_opengl_contexts_cs, device);
+    device->cs->ops->finish(device->cs);
 }
 
 static void wined3d_device_create_primary_opengl_context_cs(void *object)
@@ -1038,6 +1040,7 @@ static void wined3d_device_create_primary_opengl_context_cs(void *object)
 static HRESULT wined3d_device_create_primary_opengl_context(struct wined3d_device *device)
 {
     wined3d_cs_init_object(device->cs, wined3d_device_create_primary_opengl_context_cs, device);
+    device->cs->ops->finish(device->cs);
     if (!device->swapchains[0]->num_contexts)
         return E_FAIL;
 
@@ -3377,8 +3380,6 @@ HRESULT CDECL wined3d_device_begin_scene(struct wined3d_device *device)
 
 HRESULT CDECL wined3d_device_end_scene(struct wined3d_device *device)
 {
-    struct wined3d_context *context;
-
     TRACE("device %p.\n", device);
 
     if (!device->inScene)
@@ -3387,12 +3388,8 @@ HRESULT CDECL wined3d_device_end_scene(struct wined3d_device *device)
         return WINED3DERR_INVALIDCALL;
     }
 
-    context = context_acquire(device, NULL, 0);
     /* We only have to do this if we need to read the, swapbuffers performs a flush for us */
-    context->gl_info->gl_ops.gl.p_glFlush();
-    /* No checkGLcall here to avoid locking the lock just for checking a call that hardly ever
-     * fails. */
-    context_release(context);
+    wined3d_cs_emit_flush(device->cs);
 
     device->inScene = FALSE;
     return WINED3D_OK;
@@ -3594,14 +3591,83 @@ done:
     return hr;
 }
 
+struct wined3d_update_texture
+{
+    struct wined3d_device *device;
+    struct wined3d_texture *src_texture;
+    struct wined3d_texture *dst_texture;
+    unsigned int src_skip_levels;
+    unsigned int layer_count;
+    unsigned int level_count;
+    HRESULT hr;
+};
+
+static HRESULT wined3d_device_update_texture_sub_resources(struct wined3d_device *device,
+        struct wined3d_texture *src_texture, unsigned int src_skip_levels, struct wined3d_texture *dst_texture,
+        unsigned int layer_count, unsigned int level_count)
+{
+    struct wined3d_context *context;
+    unsigned int i, j;
+    HRESULT hr;
+
+    /* Make sure that the destination texture is loaded. */
+    context = context_acquire(device, NULL, 0);
+    wined3d_texture_load(dst_texture, context, FALSE);
+    context_release(context);
+
+    /* Update every surface level of the texture. */
+    switch (src_texture->resource.type)
+    {
+        case WINED3D_RTYPE_TEXTURE_2D:
+        {
+            unsigned int src_levels = src_texture->level_count;
+            unsigned int dst_levels = dst_texture->level_count;
+            struct wined3d_surface *src_surface;
+            struct wined3d_surface *dst_surface;
+
+            for (i = 0; i < layer_count; ++i)
+            {
+                for (j = 0; j < level_count; ++j)
+                {
+                    src_surface = src_texture->sub_resources[i * src_levels + j + src_skip_levels].u.surface;
+                    dst_surface = dst_texture->sub_resources[i * dst_levels + j].u.surface;
+                    if (FAILED(hr = surface_upload_from_surface(dst_surface, NULL, src_surface, NULL)))
+                    {
+                        WARN("Failed to update surface, hr %#x.\n", hr);
+                        return hr;
+                    }
+                }
+            }
+            return WINED3D_OK;
+        }
+
+        case WINED3D_RTYPE_TEXTURE_3D:
+            if (FAILED(hr = wined3d_device_update_texture_3d(device,
+                    src_texture, src_skip_levels, dst_texture, level_count)))
+                WARN("Failed to update 3D texture, hr %#x.\n", hr);
+            return hr;
+
+        default:
+            FIXME("Unsupported texture type %#x.\n", src_texture->resource.type);
+            return WINED3DERR_INVALIDCALL;
+    }
+}
+
+static void wined3d_device_update_texture_cs(void *object)
+{
+    struct wined3d_update_texture *data = object;
+
+    data->hr = wined3d_device_update_texture_sub_resources(data->device, data->src_texture,
+            data->src_skip_levels, data->dst_texture, data->layer_count, data->level_count);
+}
+
 HRESULT CDECL wined3d_device_update_texture(struct wined3d_device *device,
         struct wined3d_texture *src_texture, struct wined3d_texture *dst_texture)
 {
     unsigned int src_size, dst_size, src_skip_levels = 0;
-    unsigned int layer_count, level_count, i, j;
+    unsigned int layer_count, level_count;
+    struct wined3d_update_texture data;
     enum wined3d_resource_type type;
-    HRESULT hr;
-    struct wined3d_context *context;
 
     TRACE("device %p, src_texture %p, dst_texture %p.\n", device, src_texture, dst_texture);
 
@@ -3654,47 +3720,15 @@ HRESULT CDECL wined3d_device_update_texture(struct wined3d_device *device,
         ++src_skip_levels;
     }
 
-    /* Make sure that the destination texture is loaded. */
-    context = context_acquire(device, NULL, 0);
-    wined3d_texture_load(dst_texture, context, FALSE);
-    context_release(context);
-
-    /* Update every surface level of the texture. */
-    switch (type)
-    {
-        case WINED3D_RTYPE_TEXTURE_2D:
-        {
-            unsigned int src_levels = src_texture->level_count;
-            unsigned int dst_levels = dst_texture->level_count;
-            struct wined3d_surface *src_surface;
-            struct wined3d_surface *dst_surface;
+    data.device = device;
+    data.src_texture = src_texture;
+    data.dst_texture = dst_texture;
+    data.src_skip_levels = src_skip_levels;
+    data.layer_count = layer_count;
+    data.level_count = level_count;
+    wined3d_cs_call(device->cs, wined3d_device_update_texture_cs, &data);
 
-            for (i = 0; i < layer_count; ++i)
-            {
-                for (j = 0; j < level_count; ++j)
-                {
-                    src_surface = src_texture->sub_resources[i * src_levels + j + src_skip_levels].u.surface;
-                    dst_surface = dst_texture->sub_resources[i * dst_levels + j].u.surface;
-                    if (FAILED(hr = surface_upload_from_surface(dst_surface, NULL, src_surface, NULL)))
-                    {
-                        WARN("Failed to update surface, hr %#x.\n", hr);
-                        return hr;
-                    }
-                }
-            }
-            return WINED3D_OK;
-        }
-
-        case WINED3D_RTYPE_TEXTURE_3D:
-            if (FAILED(hr = wined3d_device_update_texture_3d(device,
-                    src_texture, src_skip_levels, dst_texture, level_count)))
-                WARN("Failed to update 3D texture, hr %#x.\n", hr);
-            return hr;
-
-        default:
-            FIXME("Unsupported texture type %#x.\n", type);
-            return WINED3DERR_INVALIDCALL;
-    }
+    return data.hr;
 }
 
 HRESULT CDECL wined3d_device_validate_device(const struct wined3d_device *device, DWORD *num_passes)
@@ -4949,6 +4983,7 @@ HRESULT device_init(struct wined3d_device *device, struct wined3d *wined3d,
     device->device_parent = device_parent;
     list_init(&device->resources);
     list_init(&device->shaders);
+    list_init(&device->retired_bos);
     device->surface_alignment = surface_alignment;
 
     /* Save the creation parameters. */
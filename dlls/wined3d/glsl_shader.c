@@ -558,6 +558,78 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* Context activation is done by the caller. Computes a key identifying the
+ * program for the persistent program cache from the sources of its attached
+ * shaders and any additional link state passed in "extra". */
+static BOOL shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        GLuint program, const void *extra, SIZE_T extra_size, UINT64 *key)
+{
+    GLint shader_count, source_size, tmp;
+    UINT64 *hashes, hash;
+    GLuint *shaders;
+    char *source;
+    unsigned int i, j;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_ATTACHED_SHADERS, &shader_count));
+    if (shader_count <= 0)
+        return FALSE;
+
+    shaders = HeapAlloc(GetProcessHeap(), 0, shader_count * sizeof(*shaders));
+    hashes = HeapAlloc(GetProcessHeap(), 0, shader_count * sizeof(*hashes));
+    if (!shaders || !hashes)
+    {
+        HeapFree(GetProcessHeap(), 0, hashes);
+        HeapFree(GetProcessHeap(), 0, shaders);
+        return FALSE;
+    }
+
+    GL_EXTCALL(glGetAttachedShaders(program, shader_count, NULL, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &tmp));
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &source_size));
+        hash = wined3d_program_cache_hash(0, &tmp, sizeof(tmp));
+        if (source_size > 0 && (source = HeapAlloc(GetProcessHeap(), 0, source_size)))
+        {
+            GL_EXTCALL(glGetShaderSource(shaders[i], source_size, NULL, source));
+            hash = wined3d_program_cache_hash(hash, source, source_size);
+            HeapFree(GetProcessHeap(), 0, source);
+        }
+
+        /* The order in which shaders are attached doesn't matter. */
+        for (j = i; j && hashes[j - 1] > hash; --j)
+            hashes[j] = hashes[j - 1];
+        hashes[j] = hash;
+    }
+    checkGLcall("get program sources");
+
+    *key = wined3d_program_cache_hash(0, hashes, shader_count * sizeof(*hashes));
+    if (extra_size)
+        *key = wined3d_program_cache_hash(*key, extra, extra_size);
+
+    HeapFree(GetProcessHeap(), 0, hashes);
+    HeapFree(GetProcessHeap(), 0, shaders);
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info,
+        GLuint program, const void *extra, SIZE_T extra_size)
+{
+    BOOL use_cache = wined3d_settings.program_cache && gl_info->supported[ARB_GET_PROGRAM_BINARY];
+    UINT64 key;
+
+    if (use_cache && (use_cache = shader_glsl_get_program_cache_key(gl_info, program, extra, extra_size, &key))
+            && wined3d_program_cache_load(gl_info, program, key))
+        return;
+
+    GL_EXTCALL(glLinkProgram(program));
+    shader_glsl_validate_link(gl_info, program);
+
+    if (use_cache)
+        wined3d_program_cache_store(gl_info, program, key);
+}
+
 static void shader_glsl_init_uniform_block_bindings(const struct wined3d_gl_info *gl_info,
         struct shader_glsl_priv *priv, GLuint program_id,
         const struct wined3d_shader_reg_maps *reg_maps)
@@ -8694,8 +8766,7 @@ static void set_glsl_compute_shader_program(const struct wined3d_context *contex
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, program_id, NULL, 0);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -8726,6 +8797,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     struct list *ps_list, *vs_list;
     WORD attribs_map;
     struct wined3d_string_buffer *tmp_name;
+    GLint gs_link_state[3] = {0};
 
     if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_VERTEX)) && ctx_data->glsl_program)
     {
@@ -8918,6 +8990,9 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
                     debug_d3dprimitivetype(gshader->u.gs.input_type),
                     debug_d3dprimitivetype(gshader->u.gs.output_type),
                     gshader->u.gs.vertices_out);
+            gs_link_state[0] = gl_primitive_type_from_d3d(gshader->u.gs.input_type);
+            gs_link_state[1] = gl_primitive_type_from_d3d(gshader->u.gs.output_type);
+            gs_link_state[2] = gshader->u.gs.vertices_out;
             GL_EXTCALL(glProgramParameteriARB(program_id, GL_GEOMETRY_INPUT_TYPE_ARB,
                     gl_primitive_type_from_d3d(gshader->u.gs.input_type)));
             GL_EXTCALL(glProgramParameteriARB(program_id, GL_GEOMETRY_OUTPUT_TYPE_ARB,
@@ -8942,8 +9017,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
 
     /* Link the program */
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, program_id, gs_link_state, sizeof(gs_link_state));
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -10571,12 +10645,12 @@ static void glsl_fragment_pipe_alpha_test(struct wined3d_context *context,
 
     if (state->render_states[WINED3D_RS_ALPHATESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable(GL_ALPHA_TEST)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable(GL_ALPHA_TEST)");
     }
 }
@@ -0,0 +1,420 @@
+/*
+ * Persistent cache of linked GLSL program binaries
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include "wined3d_private.h"
+#include "wine/library.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
+
+/* The cache is a single file per driver in the prefix directory. It starts
+ * with a header identifying the driver, followed by a list of records, each
+ * holding the binary of one linked program. New records are only ever
+ * appended; the whole file is discarded when the driver changes. */
+
+#define WINED3D_PROGRAM_CACHE_MAGIC         0x42505744 /* DWPB */
+#define WINED3D_PROGRAM_CACHE_VERSION       1
+#define WINED3D_PROGRAM_CACHE_MAX_BINARY    (16 * 1024 * 1024)
+
+struct wined3d_program_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 driver_key;
+};
+
+struct wined3d_program_cache_record
+{
+    UINT64 key;
+    DWORD format;
+    DWORD size;
+    /* followed by "size" bytes of program binary */
+};
+
+struct wined3d_program_cache_entry
+{
+    struct wine_rb_entry entry;
+    UINT64 key;
+    DWORD format;
+    DWORD size;
+    off_t offset;
+};
+
+static struct
+{
+    BOOL initialized;
+    int fd;
+    UINT64 driver_key;
+    struct wine_rb_tree entries;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int rejected;
+    unsigned int stored;
+} program_cache = {FALSE, -1};
+
+static CRITICAL_SECTION program_cache_cs;
+static CRITICAL_SECTION_DEBUG program_cache_cs_debug =
+{
+    0, 0, &program_cache_cs,
+    {&program_cache_cs_debug.ProcessLocksList,
+    &program_cache_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": program_cache_cs")}
+};
+static CRITICAL_SECTION program_cache_cs = {&program_cache_cs_debug, -1, 0, 0, 0, 0};
+
+/* 64-bit FNV-1a. */
+UINT64 wined3d_program_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *p = data;
+
+    if (!hash)
+        hash = 0xcbf29ce484222325ull;
+    while (size--)
+    {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static int wined3d_program_cache_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct wined3d_program_cache_entry *e = WINE_RB_ENTRY_VALUE(entry,
+            const struct wined3d_program_cache_entry, entry);
+    UINT64 k = *(const UINT64 *)key;
+
+    return k < e->key ? -1 : k > e->key ? 1 : 0;
+}
+
+static void wined3d_program_cache_free_entry(struct wine_rb_entry *entry, void *context)
+{
+    HeapFree(GetProcessHeap(), 0, WINE_RB_ENTRY_VALUE(entry, struct wined3d_program_cache_entry, entry));
+}
+
+static void wined3d_program_cache_add_entry(UINT64 key, DWORD format, DWORD size, off_t offset)
+{
+    struct wined3d_program_cache_entry *entry;
+    struct wine_rb_entry *e;
+
+    if ((e = wine_rb_get(&program_cache.entries, &key)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(e, struct wined3d_program_cache_entry, entry);
+    }
+    else
+    {
+        if (!(entry = HeapAlloc(GetProcessHeap(), 0, sizeof(*entry))))
+            return;
+        entry->key = key;
+        wine_rb_put(&program_cache.entries, &key, &entry->entry);
+    }
+    entry->format = format;
+    entry->size = size;
+    entry->offset = offset;
+}
+
+static BOOL wined3d_program_cache_lock(int fd, short type)
+{
+    struct flock lock;
+
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    return fcntl(fd, F_SETLKW, &lock) != -1;
+}
+
+static UINT64 wined3d_program_cache_get_driver_key(const struct wined3d_gl_info *gl_info)
+{
+    static const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    const char *str;
+    UINT64 key = 0;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(names); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(names[i])))
+            key = wined3d_program_cache_hash(key, str, strlen(str) + 1);
+    }
+
+    return key;
+}
+
+/* Read the record list of an opened cache file. Returns FALSE if the file
+ * needs to be reset. */
+static BOOL wined3d_program_cache_read(int fd, UINT64 driver_key)
+{
+    struct wined3d_program_cache_record record;
+    struct wined3d_program_cache_header header;
+    off_t offset, file_size;
+    struct stat st;
+
+    if (fstat(fd, &st) == -1)
+        return FALSE;
+    file_size = st.st_size;
+
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+            || header.magic != WINED3D_PROGRAM_CACHE_MAGIC
+            || header.version != WINED3D_PROGRAM_CACHE_VERSION
+            || header.driver_key != driver_key)
+        return FALSE;
+
+    for (offset = sizeof(header); offset + (off_t)sizeof(record) <= file_size;)
+    {
+        if (pread(fd, &record, sizeof(record), offset) != sizeof(record))
+            break;
+        offset += sizeof(record);
+        if (!record.size || record.size > WINED3D_PROGRAM_CACHE_MAX_BINARY
+                || offset + (off_t)record.size > file_size)
+        {
+            WARN("Ignoring truncated or invalid record at offset %lu.\n", (unsigned long)offset);
+            break;
+        }
+        wined3d_program_cache_add_entry(record.key, record.format, record.size, offset);
+        offset += record.size;
+    }
+
+    return TRUE;
+}
+
+static void wined3d_program_cache_init(const struct wined3d_gl_info *gl_info)
+{
+    struct wined3d_program_cache_header header;
+    const char *config_dir;
+    char *path;
+    int fd;
+
+    program_cache.initialized = TRUE;
+    wine_rb_init(&program_cache.entries, wined3d_program_cache_compare);
+
+    if (!wined3d_settings.program_cache || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return;
+
+    if (!(config_dir = wine_get_config_dir()))
+        return;
+    if (!(path = HeapAlloc(GetProcessHeap(), 0, strlen(config_dir) + sizeof("/wined3d-programs.bin"))))
+        return;
+    strcpy(path, config_dir);
+    strcat(path, "/wined3d-programs.bin");
+
+    fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (fd == -1)
+    {
+        WARN("Failed to open %s.\n", debugstr_a(path));
+        HeapFree(GetProcessHeap(), 0, path);
+        return;
+    }
+
+    program_cache.driver_key = wined3d_program_cache_get_driver_key(gl_info);
+
+    if (!wined3d_program_cache_lock(fd, F_WRLCK))
+    {
+        WARN("Failed to lock %s.\n", debugstr_a(path));
+        close(fd);
+        HeapFree(GetProcessHeap(), 0, path);
+        return;
+    }
+
+    if (!wined3d_program_cache_read(fd, program_cache.driver_key))
+    {
+        TRACE("Resetting program cache %s.\n", debugstr_a(path));
+        wine_rb_clear(&program_cache.entries, wined3d_program_cache_free_entry, NULL);
+
+        header.magic = WINED3D_PROGRAM_CACHE_MAGIC;
+        header.version = WINED3D_PROGRAM_CACHE_VERSION;
+        header.driver_key = program_cache.driver_key;
+        if (ftruncate(fd, 0) == -1 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            WARN("Failed to reset %s.\n", debugstr_a(path));
+            wined3d_program_cache_lock(fd, F_UNLCK);
+            close(fd);
+            HeapFree(GetProcessHeap(), 0, path);
+            return;
+        }
+    }
+
+    wined3d_program_cache_lock(fd, F_UNLCK);
+    program_cache.fd = fd;
+
+    TRACE("Using program cache %s.\n", debugstr_a(path));
+    HeapFree(GetProcessHeap(), 0, path);
+}
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_program_cache_usable(const struct wined3d_gl_info *gl_info)
+{
+    if (!program_cache.initialized)
+        wined3d_program_cache_init(gl_info);
+    if (program_cache.fd == -1)
+        return FALSE;
+
+    /* Only one driver can use the cache file at a time. */
+    return gl_info->supported[ARB_GET_PROGRAM_BINARY]
+            && wined3d_program_cache_get_driver_key(gl_info) == program_cache.driver_key;
+}
+
+/* Context activation is done by the caller. Returns TRUE if the program was
+ * successfully loaded from the cache, in which case the caller doesn't need
+ * to link it. Otherwise, prepares the program for wined3d_program_cache_store(). */
+BOOL wined3d_program_cache_load(const struct wined3d_gl_info *gl_info, GLuint program_id, UINT64 key)
+{
+    struct wined3d_program_cache_entry *entry;
+    struct wine_rb_entry *e;
+    GLint status = GL_FALSE;
+    void *data;
+
+    EnterCriticalSection(&program_cache_cs);
+
+    if (!wined3d_program_cache_usable(gl_info))
+    {
+        LeaveCriticalSection(&program_cache_cs);
+        return FALSE;
+    }
+
+    GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    checkGLcall("glProgramParameteri");
+
+    if (!(e = wine_rb_get(&program_cache.entries, &key)))
+    {
+        ++program_cache.misses;
+        LeaveCriticalSection(&program_cache_cs);
+        return FALSE;
+    }
+    entry = WINE_RB_ENTRY_VALUE(e, struct wined3d_program_cache_entry, entry);
+
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, entry->size)))
+    {
+        LeaveCriticalSection(&program_cache_cs);
+        return FALSE;
+    }
+
+    if (pread(program_cache.fd, data, entry->size, entry->offset) == entry->size)
+    {
+        GL_EXTCALL(glProgramBinary(program_id, entry->format, data, entry->size));
+        /* The driver is free to reject binaries, e.g. after an update. Don't
+         * report the resulting error. */
+        gl_info->gl_ops.gl.p_glGetError();
+        GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    }
+    HeapFree(GetProcessHeap(), 0, data);
+
+    if (status)
+    {
+        TRACE("Loaded program %u from the cache, key %s.\n", program_id, wine_dbgstr_longlong(key));
+        ++program_cache.hits;
+    }
+    else
+    {
+        TRACE("Cached binary for key %s was rejected.\n", wine_dbgstr_longlong(key));
+        ++program_cache.rejected;
+        wine_rb_remove(&program_cache.entries, e);
+        HeapFree(GetProcessHeap(), 0, entry);
+    }
+
+    LeaveCriticalSection(&program_cache_cs);
+    return status;
+}
+
+/* Context activation is done by the caller. */
+void wined3d_program_cache_store(const struct wined3d_gl_info *gl_info, GLuint program_id, UINT64 key)
+{
+    struct wined3d_program_cache_record *record;
+    GLint status, size;
+    GLenum format;
+    off_t offset;
+
+    EnterCriticalSection(&program_cache_cs);
+
+    if (!wined3d_program_cache_usable(gl_info))
+    {
+        LeaveCriticalSection(&program_cache_cs);
+        return;
+    }
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &size));
+    checkGLcall("glGetProgramiv");
+    if (!status || size <= 0 || size > WINED3D_PROGRAM_CACHE_MAX_BINARY)
+    {
+        LeaveCriticalSection(&program_cache_cs);
+        return;
+    }
+
+    if (!(record = HeapAlloc(GetProcessHeap(), 0, sizeof(*record) + size)))
+    {
+        LeaveCriticalSection(&program_cache_cs);
+        return;
+    }
+
+    GL_EXTCALL(glGetProgramBinary(program_id, size, &size, &format, record + 1));
+    checkGLcall("glGetProgramBinary");
+    record->key = key;
+    record->format = format;
+    record->size = size;
+
+    /* Other processes may append to the file as well. */
+    if (size && wined3d_program_cache_lock(program_cache.fd, F_WRLCK))
+    {
+        if ((offset = lseek(program_cache.fd, 0, SEEK_END)) != -1
+                && pwrite(program_cache.fd, record, sizeof(*record) + size, offset) == sizeof(*record) + size)
+        {
+            wined3d_program_cache_add_entry(key, format, size, offset + sizeof(*record));
+            ++program_cache.stored;
+        }
+        else
+        {
+            WARN("Failed to write program %u to the cache.\n", program_id);
+        }
+        wined3d_program_cache_lock(program_cache.fd, F_UNLCK);
+    }
+
+    HeapFree(GetProcessHeap(), 0, record);
+    LeaveCriticalSection(&program_cache_cs);
+}
+
+void wined3d_program_cache_cleanup(void)
+{
+    EnterCriticalSection(&program_cache_cs);
+
+    if (program_cache.initialized)
+    {
+        if (program_cache.fd != -1)
+            TRACE_(d3d_perf)("Program cache: %u hits, %u misses, %u rejected, %u stored.\n",
+                    program_cache.hits, program_cache.misses, program_cache.rejected, program_cache.stored);
+
+        wine_rb_destroy(&program_cache.entries, wined3d_program_cache_free_entry, NULL);
+        if (program_cache.fd != -1)
+            close(program_cache.fd);
+        program_cache.fd = -1;
+        program_cache.initialized = FALSE;
+    }
+
+    LeaveCriticalSection(&program_cache_cs);
+}
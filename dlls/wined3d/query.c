@@ -65,7 +65,7 @@ void wined3d_event_query_destroy(struct wined3d_event_query *query)
     HeapFree(GetProcessHeap(), 0, query);
 }
 
-static enum wined3d_event_query_result wined3d_event_query_test(const struct wined3d_event_query *query,
+enum wined3d_event_query_result wined3d_event_query_test(const struct wined3d_event_query *query,
         const struct wined3d_device *device, DWORD flags)
 {
     struct wined3d_context *context;
@@ -317,9 +317,25 @@ ULONG CDECL wined3d_query_decref(struct wined3d_query *query)
     return refcount;
 }
 
+struct wined3d_query_poll
+{
+    struct wined3d_query *query;
+    DWORD flags;
+    BOOL ret;
+};
+
+static void wined3d_query_poll_cs(void *object)
+{
+    struct wined3d_query_poll *poll = object;
+
+    poll->ret = poll->query->query_ops->query_poll(poll->query, poll->flags);
+}
+
 HRESULT CDECL wined3d_query_get_data(struct wined3d_query *query,
         void *data, UINT data_size, DWORD flags)
 {
+    struct wined3d_query_poll poll;
+
     TRACE("query %p, data %p, data_size %u, flags %#x.\n",
             query, data, data_size, flags);
 
@@ -338,7 +354,10 @@ HRESULT CDECL wined3d_query_get_data(struct wined3d_query *query,
         return WINED3DERR_INVALIDCALL;
     }
 
-    if (!query->query_ops->query_poll(query, flags))
+    poll.query = query;
+    poll.flags = flags;
+    wined3d_cs_call(query->device->cs, wined3d_query_poll_cs, &poll);
+    if (!poll.ret)
         return S_FALSE;
 
     if (data)
@@ -136,12 +136,12 @@ static void state_lighting(struct wined3d_context *context, const struct wined3d
     if (state->render_states[WINED3D_RS_LIGHTING]
             && !context->stream_info.position_transformed)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_LIGHTING);
+        context_set_gl_cap(context, GL_LIGHTING, TRUE);
         checkGLcall("glEnable GL_LIGHTING");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_LIGHTING);
+        context_set_gl_cap(context, GL_LIGHTING, FALSE);
         checkGLcall("glDisable GL_LIGHTING");
     }
 }
@@ -161,15 +161,15 @@ static void state_zenable(struct wined3d_context *context, const struct wined3d_
     switch (zenable)
     {
         case WINED3D_ZB_FALSE:
-            gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_TEST);
+            context_set_gl_cap(context, GL_DEPTH_TEST, FALSE);
             checkGLcall("glDisable GL_DEPTH_TEST");
             break;
         case WINED3D_ZB_TRUE:
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_TEST);
+            context_set_gl_cap(context, GL_DEPTH_TEST, TRUE);
             checkGLcall("glEnable GL_DEPTH_TEST");
             break;
         case WINED3D_ZB_USEW:
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_TEST);
+            context_set_gl_cap(context, GL_DEPTH_TEST, TRUE);
             checkGLcall("glEnable GL_DEPTH_TEST");
             FIXME("W buffer is not well handled\n");
             break;
@@ -191,17 +191,17 @@ static void state_cullmode(struct wined3d_context *context, const struct wined3d
     switch (state->render_states[WINED3D_RS_CULLMODE])
     {
         case WINED3D_CULL_NONE:
-            gl_info->gl_ops.gl.p_glDisable(GL_CULL_FACE);
+            context_set_gl_cap(context, GL_CULL_FACE, FALSE);
             checkGLcall("glDisable GL_CULL_FACE");
             break;
         case WINED3D_CULL_FRONT:
-            gl_info->gl_ops.gl.p_glEnable(GL_CULL_FACE);
+            context_set_gl_cap(context, GL_CULL_FACE, TRUE);
             checkGLcall("glEnable GL_CULL_FACE");
             gl_info->gl_ops.gl.p_glCullFace(GL_FRONT);
             checkGLcall("glCullFace(GL_FRONT)");
             break;
         case WINED3D_CULL_BACK:
-            gl_info->gl_ops.gl.p_glEnable(GL_CULL_FACE);
+            context_set_gl_cap(context, GL_CULL_FACE, TRUE);
             checkGLcall("glEnable GL_CULL_FACE");
             gl_info->gl_ops.gl.p_glCullFace(GL_BACK);
             checkGLcall("glCullFace(GL_BACK)");
@@ -241,12 +241,12 @@ static void state_ditherenable(struct wined3d_context *context, const struct win
 
     if (state->render_states[WINED3D_RS_DITHERENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_DITHER);
+        context_set_gl_cap(context, GL_DITHER, TRUE);
         checkGLcall("glEnable GL_DITHER");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_DITHER);
+        context_set_gl_cap(context, GL_DITHER, FALSE);
         checkGLcall("glDisable GL_DITHER");
     }
 }
@@ -480,12 +480,12 @@ static void state_blend(struct wined3d_context *context, const struct wined3d_st
 
     if (enable_blend)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_BLEND);
+        context_set_gl_cap(context, GL_BLEND, TRUE);
         checkGLcall("glEnable(GL_BLEND)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
+        context_set_gl_cap(context, GL_BLEND, FALSE);
         checkGLcall("glDisable(GL_BLEND)");
         if (enable_line_smooth)
             WARN("LINE/EDGEANTIALIAS enabled with disabled blending.\n");
@@ -584,12 +584,12 @@ void state_alpha_test(struct wined3d_context *context, const struct wined3d_stat
     if (state->render_states[WINED3D_RS_ALPHATESTENABLE]
             || (state->render_states[WINED3D_RS_COLORKEYENABLE] && enable_ckey))
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable GL_ALPHA_TEST");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable GL_ALPHA_TEST");
         /* Alpha test is disabled, don't bother setting the params - it will happen on the next
          * enable call
@@ -859,7 +859,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
     /* No stencil test without a stencil buffer. */
     if (!state->fb->depth_stencil)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
+        context_set_gl_cap(context, GL_STENCIL_TEST, FALSE);
         checkGLcall("glDisable GL_STENCIL_TEST");
         return;
     }
@@ -888,7 +888,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
 
     if (twosided_enable && onesided_enable)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST);
+        context_set_gl_cap(context, GL_STENCIL_TEST, TRUE);
         checkGLcall("glEnable GL_STENCIL_TEST");
 
         if (gl_info->supported[WINED3D_GL_VERSION_2_0])
@@ -937,7 +937,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
         /* This code disables the ATI extension as well, since the standard stencil functions are equal
          * to calling the ATI functions with GL_FRONT_AND_BACK as face parameter
          */
-        gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST);
+        context_set_gl_cap(context, GL_STENCIL_TEST, TRUE);
         checkGLcall("glEnable GL_STENCIL_TEST");
         gl_info->gl_ops.gl.p_glStencilFunc(func, ref, mask);
         checkGLcall("glStencilFunc(...)");
@@ -946,7 +946,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
+        context_set_gl_cap(context, GL_STENCIL_TEST, FALSE);
         checkGLcall("glDisable GL_STENCIL_TEST");
     }
 }
@@ -1673,12 +1673,12 @@ static void state_scissor(struct wined3d_context *context, const struct wined3d_
 
     if (state->render_states[WINED3D_RS_SCISSORTESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_SCISSOR_TEST);
+        context_set_gl_cap(context, GL_SCISSOR_TEST, TRUE);
         checkGLcall("glEnable(GL_SCISSOR_TEST)");
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+        context_set_gl_cap(context, GL_SCISSOR_TEST, FALSE);
         checkGLcall("glDisable(GL_SCISSOR_TEST)");
     }
 }
@@ -1717,7 +1717,7 @@ static void state_depthbias(struct wined3d_context *context, const struct wined3
         scale_bias.d = state->render_states[WINED3D_RS_SLOPESCALEDEPTHBIAS];
         const_bias.d = state->render_states[WINED3D_RS_DEPTHBIAS];
 
-        gl_info->gl_ops.gl.p_glEnable(GL_POLYGON_OFFSET_FILL);
+        context_set_gl_cap(context, GL_POLYGON_OFFSET_FILL, TRUE);
         checkGLcall("glEnable(GL_POLYGON_OFFSET_FILL)");
 
         if (context->d3d_info->wined3d_creation_flags & WINED3D_LEGACY_DEPTH_BIAS)
@@ -1751,7 +1751,7 @@ static void state_depthbias(struct wined3d_context *context, const struct wined3
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_POLYGON_OFFSET_FILL);
+        context_set_gl_cap(context, GL_POLYGON_OFFSET_FILL, FALSE);
         checkGLcall("glDisable(GL_POLYGON_OFFSET_FILL)");
     }
 }
@@ -4934,14 +4934,12 @@ static void psorigin(struct wined3d_context *context, const struct wined3d_state
 
 void state_srgbwrite(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    const struct wined3d_gl_info *gl_info = context->gl_info;
-
     TRACE("context %p, state %p, state_id %#x.\n", context, state, state_id);
 
     if (needs_srgb_write(context, state, state->fb))
-        gl_info->gl_ops.gl.p_glEnable(GL_FRAMEBUFFER_SRGB);
+        context_set_gl_cap(context, GL_FRAMEBUFFER_SRGB, TRUE);
     else
-        gl_info->gl_ops.gl.p_glDisable(GL_FRAMEBUFFER_SRGB);
+        context_set_gl_cap(context, GL_FRAMEBUFFER_SRGB, FALSE);
 }
 
 static void state_cb(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
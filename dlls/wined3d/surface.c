@@ -252,8 +252,9 @@ static void get_color_masks(const struct wined3d_format *format, DWORD *masks)
     masks[2] = ((1u << format->blue_size) - 1) << format->blue_offset;
 }
 
-void wined3d_surface_destroy_dc(struct wined3d_surface *surface)
+static void surface_destroy_dc_cs(void *object)
 {
+    struct wined3d_surface *surface = object;
     unsigned int sub_resource_idx = surface_get_sub_resource_idx(surface);
     struct wined3d_texture *texture = surface->container;
     struct wined3d_device *device = texture->resource.device;
@@ -291,7 +292,18 @@ void wined3d_surface_destroy_dc(struct wined3d_surface *surface)
         context_release(context);
 }
 
-HRESULT wined3d_surface_create_dc(struct wined3d_surface *surface)
+void wined3d_surface_destroy_dc(struct wined3d_surface *surface)
+{
+    wined3d_cs_call(surface->container->resource.device->cs, surface_destroy_dc_cs, surface);
+}
+
+struct surface_create_dc
+{
+    struct wined3d_surface *surface;
+    HRESULT hr;
+};
+
+static HRESULT surface_create_dc(struct wined3d_surface *surface)
 {
     unsigned int sub_resource_idx = surface_get_sub_resource_idx(surface);
     struct wined3d_texture *texture = surface->container;
@@ -350,6 +362,23 @@ HRESULT wined3d_surface_create_dc(struct wined3d_surface *surface)
     return WINED3D_OK;
 }
 
+static void surface_create_dc_cs(void *object)
+{
+    struct surface_create_dc *data = object;
+
+    data->hr = surface_create_dc(data->surface);
+}
+
+HRESULT wined3d_surface_create_dc(struct wined3d_surface *surface)
+{
+    struct surface_create_dc data;
+
+    data.surface = surface;
+    wined3d_cs_call(surface->container->resource.device->cs, surface_create_dc_cs, &data);
+
+    return data.hr;
+}
+
 static BOOL surface_is_full_rect(const struct wined3d_surface *surface, const RECT *r)
 {
     unsigned int t;
@@ -448,7 +477,7 @@ static void surface_depth_blt_fbo(const struct wined3d_device *device,
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILWRITEMASK));
     }
 
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    context_set_gl_cap(context, GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
     gl_info->fbo_ops.glBlitFramebuffer(src_rect->left, src_rect->top, src_rect->right, src_rect->bottom,
@@ -580,7 +609,7 @@ static void surface_blt_fbo(const struct wined3d_device *device,
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE2));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE3));
 
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    context_set_gl_cap(context, GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
     gl_info->fbo_ops.glBlitFramebuffer(src_rect.left, src_rect.top, src_rect.right, src_rect.bottom,
@@ -2237,7 +2266,7 @@ static void surface_blt_to_drawable(const struct wined3d_device *device,
 
     if (alpha_test)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, TRUE);
         checkGLcall("glEnable(GL_ALPHA_TEST)");
 
         /* For P8 surfaces, the alpha component contains the palette index.
@@ -2252,7 +2281,7 @@ static void surface_blt_to_drawable(const struct wined3d_device *device,
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable(GL_ALPHA_TEST)");
     }
 
@@ -2260,7 +2289,7 @@ static void surface_blt_to_drawable(const struct wined3d_device *device,
 
     if (alpha_test)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
         checkGLcall("glDisable(GL_ALPHA_TEST)");
     }
 
@@ -2886,7 +2915,6 @@ static void ffp_blit_blit_surface(struct wined3d_device *device, enum wined3d_bl
     unsigned int dst_sub_resource_idx = surface_get_sub_resource_idx(dst_surface);
     struct wined3d_texture *dst_texture = dst_surface->container;
     struct wined3d_texture *src_texture = src_surface->container;
-    const struct wined3d_gl_info *gl_info;
     struct wined3d_context *context;
 
     /* Blit from offscreen surface to render target */
@@ -2898,16 +2926,15 @@ static void ffp_blit_blit_surface(struct wined3d_device *device, enum wined3d_bl
     wined3d_texture_set_color_key(src_texture, WINED3D_CKEY_SRC_BLT, color_key);
 
     context = context_acquire(device, dst_texture, dst_sub_resource_idx);
-    gl_info = context->gl_info;
 
     if (op == WINED3D_BLIT_OP_COLOR_BLIT_ALPHATEST)
-        gl_info->gl_ops.gl.p_glEnable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, TRUE);
 
     surface_blt_to_drawable(device, context, filter,
             !!color_key, src_surface, src_rect, dst_surface, dst_rect);
 
     if (op == WINED3D_BLIT_OP_COLOR_BLIT_ALPHATEST)
-        gl_info->gl_ops.gl.p_glDisable(GL_ALPHA_TEST);
+        context_set_gl_cap(context, GL_ALPHA_TEST, FALSE);
 
     context_release(context);
 
@@ -25,6 +25,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
 static void wined3d_swapchain_destroy_object(void *object)
@@ -66,6 +67,7 @@ static void swapchain_cleanup(struct wined3d_swapchain *swapchain)
     }
 
     wined3d_cs_destroy_object(swapchain->device->cs, wined3d_swapchain_destroy_object, swapchain);
+    swapchain->device->cs->ops->finish(swapchain->device->cs);
 
     /* Restore the screen resolution if we rendered in fullscreen.
      * This will restore the screen resolution to what it was before creating
@@ -348,7 +350,7 @@ static void swapchain_blit(const struct wined3d_swapchain *swapchain,
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE2));
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE3));
 
-        gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+        context_set_gl_cap(context, GL_SCISSOR_TEST, FALSE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
         /* Note that the texture is upside down */
@@ -606,6 +608,11 @@ static void swapchain_gl_present(struct wined3d_swapchain *swapchain,
         }
     }
 
+    TRACE_(d3d_perf)("Context %p: %u states applied, %u GL capability changes, %u redundant changes filtered.\n",
+            context, context->state_stats.applied_states, context->state_stats.applied_caps,
+            context->state_stats.filtered_caps);
+    memset(&context->state_stats, 0, sizeof(context->state_stats));
+
     wined3d_texture_validate_location(swapchain->front_buffer, 0, WINED3D_LOCATION_DRAWABLE);
     wined3d_texture_invalidate_location(swapchain->front_buffer, 0, ~WINED3D_LOCATION_DRAWABLE);
     /* If the swapeffect is DISCARD, the back buffer is undefined. That means the SYSMEM
@@ -961,6 +968,7 @@ static HRESULT swapchain_init(struct wined3d_swapchain *swapchain, struct wined3
         }
 
         wined3d_cs_init_object(device->cs, wined3d_swapchain_cs_init, swapchain);
+        device->cs->ops->finish(device->cs);
 
         if (!swapchain->context[0])
         {
@@ -1057,6 +1065,7 @@ err:
     }
 
     wined3d_cs_destroy_object(swapchain->device->cs, wined3d_swapchain_destroy_object, swapchain);
+    swapchain->device->cs->ops->finish(swapchain->device->cs);
 
     if (swapchain->front_buffer)
     {
@@ -1189,8 +1198,9 @@ void swapchain_update_draw_bindings(struct wined3d_swapchain *swapchain)
     }
 }
 
-void swapchain_update_swap_interval(struct wined3d_swapchain *swapchain)
+static void swapchain_update_swap_interval_cs(void *object)
 {
+    struct wined3d_swapchain *swapchain = object;
     const struct wined3d_gl_info *gl_info;
     struct wined3d_context *context;
     int swap_interval;
@@ -1231,6 +1241,11 @@ void swapchain_update_swap_interval(struct wined3d_swapchain *swapchain)
     context_release(context);
 }
 
+void swapchain_update_swap_interval(struct wined3d_swapchain *swapchain)
+{
+    wined3d_cs_call(swapchain->device->cs, swapchain_update_swap_interval_cs, swapchain);
+}
+
 void wined3d_swapchain_activate(struct wined3d_swapchain *swapchain, BOOL activate)
 {
     struct wined3d_device *device = swapchain->device;
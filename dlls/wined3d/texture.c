@@ -447,8 +447,9 @@ static void wined3d_texture_remove_buffer_object(struct wined3d_texture *texture
             *buffer_object, texture, sub_resource_idx);
 }
 
-static void wined3d_texture_update_map_binding(struct wined3d_texture *texture)
+static void wined3d_texture_update_map_binding_cs(void *object)
 {
+    struct wined3d_texture *texture = object;
     unsigned int sub_count = texture->level_count * texture->layer_count;
     const struct wined3d_device *device = texture->resource.device;
     DWORD map_binding = texture->update_map_binding;
@@ -474,6 +475,46 @@ static void wined3d_texture_update_map_binding(struct wined3d_texture *texture)
     texture->update_map_binding = 0;
 }
 
+static void wined3d_texture_update_map_binding(struct wined3d_texture *texture)
+{
+    wined3d_cs_call(texture->resource.device->cs, wined3d_texture_update_map_binding_cs, texture);
+}
+
+struct wined3d_texture_load_map_binding
+{
+    struct wined3d_texture *texture;
+    unsigned int sub_resource_idx;
+    BOOL ret;
+};
+
+static void wined3d_texture_load_map_binding_cs(void *object)
+{
+    struct wined3d_texture_load_map_binding *data = object;
+    struct wined3d_texture *texture = data->texture;
+    const struct wined3d_device *device = texture->resource.device;
+    DWORD map_binding = texture->resource.map_binding;
+    struct wined3d_context *context = NULL;
+
+    if (device->d3d_initialized)
+        context = context_acquire(device, NULL, 0);
+    if ((data->ret = wined3d_texture_load_location(texture, data->sub_resource_idx, context, map_binding)))
+        wined3d_texture_invalidate_location(texture, data->sub_resource_idx, ~map_binding);
+    if (context)
+        context_release(context);
+}
+
+/* Make the map binding the only valid location of a sub-resource. */
+static BOOL wined3d_texture_load_map_binding(struct wined3d_texture *texture, unsigned int sub_resource_idx)
+{
+    struct wined3d_texture_load_map_binding data;
+
+    data.texture = texture;
+    data.sub_resource_idx = sub_resource_idx;
+    wined3d_cs_call(texture->resource.device->cs, wined3d_texture_load_map_binding_cs, &data);
+
+    return data.ret;
+}
+
 void wined3d_texture_set_map_binding(struct wined3d_texture *texture, DWORD map_binding)
 {
     texture->update_map_binding = map_binding;
@@ -1532,7 +1573,6 @@ static struct wined3d_texture_sub_resource *wined3d_texture_get_sub_resource(str
 HRESULT CDECL wined3d_texture_add_dirty_region(struct wined3d_texture *texture,
         UINT layer, const struct wined3d_box *dirty_region)
 {
-    struct wined3d_context *context;
     unsigned int sub_resource_idx;
 
     TRACE("texture %p, layer %u, dirty_region %s.\n", texture, layer, debug_box(dirty_region));
@@ -1547,15 +1587,11 @@ HRESULT CDECL wined3d_texture_add_dirty_region(struct wined3d_texture *texture,
     if (dirty_region)
         FIXME("Ignoring dirty_region %s.\n", debug_box(dirty_region));
 
-    context = context_acquire(texture->resource.device, NULL, 0);
-    if (!wined3d_texture_load_location(texture, sub_resource_idx, context, texture->resource.map_binding))
+    if (!wined3d_texture_load_map_binding(texture, sub_resource_idx))
     {
         ERR("Failed to load location %s.\n", wined3d_debug_location(texture->resource.map_binding));
-        context_release(context);
         return E_OUTOFMEMORY;
     }
-    wined3d_texture_invalidate_location(texture, sub_resource_idx, ~texture->resource.map_binding);
-    context_release(context);
 
     return WINED3D_OK;
 }
@@ -2979,9 +3015,7 @@ HRESULT CDECL wined3d_texture_create(struct wined3d_device *device, const struct
 
 HRESULT CDECL wined3d_texture_get_dc(struct wined3d_texture *texture, unsigned int sub_resource_idx, HDC *dc)
 {
-    struct wined3d_device *device = texture->resource.device;
     struct wined3d_texture_sub_resource *sub_resource;
-    struct wined3d_context *context = NULL;
     struct wined3d_surface *surface;
     HRESULT hr = WINED3D_OK;
 
@@ -3008,16 +3042,10 @@ HRESULT CDECL wined3d_texture_get_dc(struct wined3d_texture *texture, unsigned i
     if (texture->resource.map_count && !(texture->flags & WINED3D_TEXTURE_GET_DC_LENIENT))
         return WINED3DERR_INVALIDCALL;
 
-    if (device->d3d_initialized)
-        context = context_acquire(device, NULL, 0);
-
-    wined3d_texture_load_location(texture, sub_resource_idx, context, texture->resource.map_binding);
-    wined3d_texture_invalidate_location(texture, sub_resource_idx, ~texture->resource.map_binding);
+    wined3d_texture_load_map_binding(texture, sub_resource_idx);
 
     if (!surface->dc)
         hr = wined3d_surface_create_dc(surface);
-    if (context)
-        context_release(context);
     if (FAILED(hr))
         return WINED3DERR_INVALIDCALL;
 
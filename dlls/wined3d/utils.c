@@ -28,6 +28,16 @@
 #include "wine/port.h"
 
 #include <stdio.h>
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef __SSE2__
+#  define SSE2_FUNC
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define SSE2_FUNC __attribute__((target("sse2")))  /* selected at run time */
+# endif
+# ifdef SSE2_FUNC
+#  include <emmintrin.h>
+# endif
+#endif
 
 #include "wined3d_private.h"
 
@@ -427,6 +437,52 @@ struct wined3d_format_texture_info
             UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth);
 };
 
+#ifdef SSE2_FUNC
+static BOOL sse2_supported(void)
+{
+#ifdef __SSE2__
+    return TRUE;
+#else
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+#endif
+}
+#endif
+
+static void convert_l4a4_unorm_row(const BYTE *src, WORD *dst, unsigned int width)
+{
+    unsigned int x;
+
+    for (x = 0; x < width; ++x)
+    {
+        unsigned int color = src[x];
+        /* A in the high byte, L in the low byte. */
+        dst[x] = ((color & 0xf0u) << 8) | ((color & 0x0fu) << 4);
+    }
+}
+
+#ifdef SSE2_FUNC
+static SSE2_FUNC void convert_l4a4_unorm_row_sse2(const BYTE *src, WORD *dst, unsigned int width)
+{
+    const __m128i mask = _mm_set1_epi8(0xf0);
+    __m128i color, l, a;
+    unsigned int x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        color = _mm_loadu_si128((const __m128i *)(src + x));
+        l = _mm_and_si128(_mm_slli_epi16(color, 4), mask);
+        a = _mm_and_si128(color, mask);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_unpacklo_epi8(l, a));
+        _mm_storeu_si128((__m128i *)(dst + x + 8), _mm_unpackhi_epi8(l, a));
+    }
+
+    convert_l4a4_unorm_row(src + x, dst + x, width - x);
+}
+#endif
+
 static void convert_l4a4_unorm(const BYTE *src, BYTE *dst, UINT src_row_pitch, UINT src_slice_pitch,
         UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth)
 {
@@ -434,23 +490,20 @@ static void convert_l4a4_unorm(const BYTE *src, BYTE *dst, UINT src_row_pitch, U
      * format+type combination to load it. Thus convert it to A8L8, then load it
      * with A4L4 internal, but A8L8 format+type
      */
-    unsigned int x, y, z;
-    const unsigned char *Source;
-    unsigned char *Dest;
+    void (*convert_row)(const BYTE *src, WORD *dst, unsigned int width) = convert_l4a4_unorm_row;
+    unsigned int y, z;
+
+#ifdef SSE2_FUNC
+    if (sse2_supported())
+        convert_row = convert_l4a4_unorm_row_sse2;
+#endif
 
     for (z = 0; z < depth; z++)
     {
         for (y = 0; y < height; y++)
         {
-            Source = src + z * src_slice_pitch + y * src_row_pitch;
-            Dest = dst + z * dst_slice_pitch + y * dst_row_pitch;
-            for (x = 0; x < width; x++ )
-            {
-                unsigned char color = (*Source++);
-                /* A */ Dest[1] = (color & 0xf0u) << 0;
-                /* L */ Dest[0] = (color & 0x0fu) << 4;
-                Dest += 2;
-            }
+            convert_row(src + z * src_slice_pitch + y * src_row_pitch,
+                    (WORD *)(dst + z * dst_slice_pitch + y * dst_row_pitch), width);
         }
     }
 }
@@ -626,31 +679,79 @@ static void convert_r8g8_snorm_l8x8_unorm(const BYTE *src, BYTE *dst, UINT src_r
     }
 }
 
+static void convert_r8g8_snorm_l8x8_unorm_nv_row(const DWORD *src, DWORD *dst, unsigned int width)
+{
+    unsigned int x;
+
+    for (x = 0; x < width; ++x)
+        dst[x] = src[x] | 0xff000000;
+}
+
+/* Swap U and W into BGRA order, and bias all four channels by 128 at once;
+ * adding 128 to a byte is the same as flipping its top bit. */
+static void convert_r8g8b8a8_snorm_row(const DWORD *src, DWORD *dst, unsigned int width)
+{
+    unsigned int x;
+
+    for (x = 0; x < width; ++x)
+    {
+        DWORD color = src[x];
+        dst[x] = ((color & 0xff00ff00) | ((color >> 16) & 0xff) | ((color & 0xff) << 16)) ^ 0x80808080;
+    }
+}
+
+#ifdef SSE2_FUNC
+static SSE2_FUNC void convert_r8g8_snorm_l8x8_unorm_nv_row_sse2(const DWORD *src, DWORD *dst, unsigned int width)
+{
+    const __m128i x8 = _mm_set1_epi32(0xff000000);
+    unsigned int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_loadu_si128((const __m128i *)(src + x)), x8));
+
+    convert_r8g8_snorm_l8x8_unorm_nv_row(src + x, dst + x, width - x);
+}
+
+static SSE2_FUNC void convert_r8g8b8a8_snorm_row_sse2(const DWORD *src, DWORD *dst, unsigned int width)
+{
+    const __m128i ga = _mm_set1_epi32(0xff00ff00), byte = _mm_set1_epi32(0xff), bias = _mm_set1_epi8(0x80);
+    __m128i color, swapped;
+    unsigned int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        color = _mm_loadu_si128((const __m128i *)(src + x));
+        swapped = _mm_or_si128(_mm_and_si128(color, ga),
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(color, 16), byte),
+                _mm_slli_epi32(_mm_and_si128(color, byte), 16)));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(swapped, bias));
+    }
+
+    convert_r8g8b8a8_snorm_row(src + x, dst + x, width - x);
+}
+#endif
+
 static void convert_r8g8_snorm_l8x8_unorm_nv(const BYTE *src, BYTE *dst, UINT src_row_pitch, UINT src_slice_pitch,
         UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth)
 {
-    unsigned int x, y, z;
-    const DWORD *Source;
-    unsigned char *Dest;
+    void (*convert_row)(const DWORD *src, DWORD *dst, unsigned int width) = convert_r8g8_snorm_l8x8_unorm_nv_row;
+    unsigned int y, z;
+
+#ifdef SSE2_FUNC
+    if (sse2_supported())
+        convert_row = convert_r8g8_snorm_l8x8_unorm_nv_row_sse2;
+#endif
 
     /* This implementation works with the fixed function pipeline and shaders
-     * without further modification after converting the surface.
+     * without further modification after converting the surface. U, V and L
+     * keep their positions, only X is forced to 255.
      */
     for (z = 0; z < depth; z++)
     {
         for (y = 0; y < height; y++)
         {
-            Source = (const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch);
-            Dest = dst + z * dst_slice_pitch + y * dst_row_pitch;
-            for (x = 0; x < width; x++ )
-            {
-                LONG color = (*Source++);
-                /* L */ Dest[2] = ((color >> 16) & 0xff);   /* L */
-                /* V */ Dest[1] = ((color >> 8 ) & 0xff);   /* V */
-                /* U */ Dest[0] = (color         & 0xff);   /* U */
-                /* I */ Dest[3] = 255;                      /* X */
-                Dest += 4;
-            }
+            convert_row((const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch),
+                    (DWORD *)(dst + z * dst_slice_pitch + y * dst_row_pitch), width);
         }
     }
 }
@@ -658,25 +759,20 @@ static void convert_r8g8_snorm_l8x8_unorm_nv(const BYTE *src, BYTE *dst, UINT sr
 static void convert_r8g8b8a8_snorm(const BYTE *src, BYTE *dst, UINT src_row_pitch, UINT src_slice_pitch,
         UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth)
 {
-    unsigned int x, y, z;
-    const DWORD *Source;
-    unsigned char *Dest;
+    void (*convert_row)(const DWORD *src, DWORD *dst, unsigned int width) = convert_r8g8b8a8_snorm_row;
+    unsigned int y, z;
+
+#ifdef SSE2_FUNC
+    if (sse2_supported())
+        convert_row = convert_r8g8b8a8_snorm_row_sse2;
+#endif
 
     for (z = 0; z < depth; z++)
     {
         for (y = 0; y < height; y++)
         {
-            Source = (const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch);
-            Dest = dst + z * dst_slice_pitch + y * dst_row_pitch;
-            for (x = 0; x < width; x++ )
-            {
-                LONG color = (*Source++);
-                /* B */ Dest[0] = ((color >> 16) & 0xff) + 128; /* W */
-                /* G */ Dest[1] = ((color >> 8 ) & 0xff) + 128; /* V */
-                /* R */ Dest[2] = (color         & 0xff) + 128; /* U */
-                /* A */ Dest[3] = ((color >> 24) & 0xff) + 128; /* Q */
-                Dest += 4;
-            }
+            convert_row((const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch),
+                    (DWORD *)(dst + z * dst_slice_pitch + y * dst_row_pitch), width);
         }
     }
 }
@@ -83,6 +83,8 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* Don't force a specific sample count by default. */
     FALSE,          /* No strict draw ordering. */
     FALSE,          /* Don't range check relative addressing indices in float constants. */
+    FALSE,          /* No multithreaded command stream. */
+    FALSE,          /* No persistent GLSL program cache. */
     ~0U,            /* No VS shader model limit by default. */
     ~0U,            /* No HS shader model limit by default. */
     ~0U,            /* No DS shader model limit by default. */
@@ -309,6 +311,14 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Checking relative addressing indices in float constants.\n");
             wined3d_settings.check_float_constants = TRUE;
         }
+        if (!get_config_key_dword(hkey, appkey, "csmt", &wined3d_settings.cs_multithreaded))
+            ERR_(winediag)("Setting multithreaded command stream to %#x.\n", wined3d_settings.cs_multithreaded);
+        if (!get_config_key(hkey, appkey, "ProgramCache", buffer, size)
+                && !strcmp(buffer, "enabled"))
+        {
+            TRACE("Enabling the persistent GLSL program cache.\n");
+            wined3d_settings.program_cache = TRUE;
+        }
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelVS", &wined3d_settings.max_sm_vs))
             TRACE("Limiting VS shader model to %u.\n", wined3d_settings.max_sm_vs);
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelHS", &wined3d_settings.max_sm_hs))
@@ -358,6 +368,8 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     }
     HeapFree(GetProcessHeap(), 0, wndproc_table.entries);
 
+    wined3d_program_cache_cleanup();
+
     HeapFree(GetProcessHeap(), 0, wined3d_settings.logo);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
@@ -384,6 +384,8 @@ struct wined3d_settings
     unsigned int sample_count;
     BOOL strict_draw_ordering;
     BOOL check_float_constants;
+    unsigned int cs_multithreaded;
+    BOOL program_cache;
     unsigned int max_sm_vs;
     unsigned int max_sm_hs;
     unsigned int max_sm_ds;
@@ -1604,6 +1606,8 @@ void wined3d_event_query_destroy(struct wined3d_event_query *query) DECLSPEC_HID
 enum wined3d_event_query_result wined3d_event_query_finish(const struct wined3d_event_query *query,
         const struct wined3d_device *device) DECLSPEC_HIDDEN;
 void wined3d_event_query_issue(struct wined3d_event_query *query, const struct wined3d_device *device) DECLSPEC_HIDDEN;
+enum wined3d_event_query_result wined3d_event_query_test(const struct wined3d_event_query *query,
+        const struct wined3d_device *device, DWORD flags) DECLSPEC_HIDDEN;
 BOOL wined3d_event_query_supported(const struct wined3d_gl_info *gl_info) DECLSPEC_HIDDEN;
 
 struct wined3d_occlusion_query
@@ -1697,6 +1701,16 @@ struct wined3d_context
     DWORD active_texture;
     DWORD *texture_type;
 
+    /* Shadow of frequently toggled GL capabilities, see context_set_gl_cap(). */
+    DWORD gl_caps_valid;
+    DWORD gl_caps_enabled;
+    struct
+    {
+        unsigned int applied_states;
+        unsigned int applied_caps;
+        unsigned int filtered_caps;
+    } state_stats;
+
     UINT instance_count;
 
     /* The actual opengl context */
@@ -1915,6 +1929,7 @@ void context_active_texture(struct wined3d_context *context, const struct wined3
 void context_bind_dummy_textures(const struct wined3d_device *device,
         const struct wined3d_context *context) DECLSPEC_HIDDEN;
 void context_bind_texture(struct wined3d_context *context, GLenum target, GLuint name) DECLSPEC_HIDDEN;
+void context_set_gl_cap(struct wined3d_context *context, GLenum cap, BOOL enable) DECLSPEC_HIDDEN;
 void context_check_fbo_status(const struct wined3d_context *context, GLenum target) DECLSPEC_HIDDEN;
 struct wined3d_context *context_create(struct wined3d_swapchain *swapchain, struct wined3d_texture *target,
         const struct wined3d_format *ds_format) DECLSPEC_HIDDEN;
@@ -2655,6 +2670,8 @@ struct wined3d_device
     struct list             resources; /* a linked list to track resources created by the device */
     struct list             shaders;   /* a linked list to track shaders (pixel and vertex)      */
     struct wine_rb_tree samplers;
+    struct list retired_bos;   /* persistently mapped BOs waiting for the GPU, see buffer.c */
+    unsigned int retired_bo_count;
 
     /* Render Target Support */
     struct wined3d_fb_state fb;
@@ -3199,10 +3216,26 @@ enum wined3d_push_constants
     WINED3D_PUSH_CONSTANTS_PS_B,
 };
 
+#define WINED3D_CS_QUEUE_SIZE           0x100000u
+#define WINED3D_CS_SPIN_COUNT           10000000u
+
+struct wined3d_cs_packet
+{
+    size_t size;
+    BYTE data[1];
+};
+
+struct wined3d_cs_queue
+{
+    LONG head, tail;
+    BYTE data[WINED3D_CS_QUEUE_SIZE];
+};
+
 struct wined3d_cs_ops
 {
     void *(*require_space)(struct wined3d_cs *cs, size_t size);
     void (*submit)(struct wined3d_cs *cs);
+    void (*finish)(struct wined3d_cs *cs);
     void (*push_constants)(struct wined3d_cs *cs, enum wined3d_push_constants p,
             unsigned int start_idx, unsigned int count, const void *constants);
 };
@@ -3213,11 +3246,20 @@ struct wined3d_cs
     struct wined3d_device *device;
     struct wined3d_fb_state fb;
     struct wined3d_state state;
+    HMODULE wined3d_module;
+    HANDLE thread;
+    DWORD thread_id;
 
+    struct wined3d_cs_queue queue;
     size_t data_size, start, end;
     void *data;
+
+    HANDLE event;
+    LONG waiting_for_event;
+    LONG pending_presents;
 };
 
+void wined3d_cs_call(struct wined3d_cs *cs, void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy_object(struct wined3d_cs *cs,
@@ -3233,6 +3275,7 @@ void wined3d_cs_emit_dispatch(struct wined3d_cs *cs,
 void wined3d_cs_emit_draw(struct wined3d_cs *cs, GLenum primitive_type, int base_vertex_idx,
         unsigned int start_idx, unsigned int index_count, unsigned int start_instance,
         unsigned int instance_count, BOOL indexed) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_flush(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_preload_resource(struct wined3d_cs *cs, struct wined3d_resource *resource) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain,
         const RECT *src_rect, const RECT *dst_rect, HWND dst_window_override, DWORD flags) DECLSPEC_HIDDEN;
@@ -3316,6 +3359,16 @@ struct wined3d_map_range
     UINT size;
 };
 
+/* A persistently mapped buffer object backing a dynamic buffer. */
+struct wined3d_persistent_bo
+{
+    struct list entry;
+    GLuint name;
+    unsigned int size;
+    BYTE *map_ptr;
+    struct wined3d_event_query *query;
+};
+
 struct wined3d_buffer
 {
     struct wined3d_resource resource;
@@ -3323,6 +3376,7 @@ struct wined3d_buffer
     struct wined3d_buffer_desc desc;
 
     GLuint buffer_object;
+    struct wined3d_persistent_bo *persistent_bo;
     GLenum buffer_object_usage;
     GLenum buffer_type_hint;
     unsigned int bind_flags;
@@ -3355,6 +3409,8 @@ void wined3d_buffer_load(struct wined3d_buffer *buffer, struct wined3d_context *
 BOOL wined3d_buffer_load_location(struct wined3d_buffer *buffer,
         struct wined3d_context *context, DWORD location) DECLSPEC_HIDDEN;
 BYTE *wined3d_buffer_load_sysmem(struct wined3d_buffer *buffer, struct wined3d_context *context) DECLSPEC_HIDDEN;
+void buffer_destroy_retired_bos(struct wined3d_device *device,
+        const struct wined3d_context *context) DECLSPEC_HIDDEN;
 HRESULT wined3d_buffer_copy(struct wined3d_buffer *dst_buffer, unsigned int dst_offset,
         struct wined3d_buffer *src_buffer, unsigned int src_offset, unsigned int size) DECLSPEC_HIDDEN;
 void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
@@ -3802,6 +3858,13 @@ struct ps_np2fixup_info {
 void print_glsl_info_log(const struct wined3d_gl_info *gl_info, GLuint id, BOOL program) DECLSPEC_HIDDEN;
 void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint program) DECLSPEC_HIDDEN;
 
+UINT64 wined3d_program_cache_hash(UINT64 hash, const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+BOOL wined3d_program_cache_load(const struct wined3d_gl_info *gl_info,
+        GLuint program_id, UINT64 key) DECLSPEC_HIDDEN;
+void wined3d_program_cache_store(const struct wined3d_gl_info *gl_info,
+        GLuint program_id, UINT64 key) DECLSPEC_HIDDEN;
+void wined3d_program_cache_cleanup(void) DECLSPEC_HIDDEN;
+
 struct wined3d_palette
 {
     LONG ref;
@@ -393,6 +393,8 @@ static inline BOOL call_event_handler( Display *display, XEvent *event )
 
     TRACE( "%lu %s for hwnd/window %p/%lx\n",
            event->xany.serial, dbgstr_event( event->type ), hwnd, event->xany.window );
+    /* pending mouse moves have to reach the server before any other input */
+    if (event->type != MotionNotify && event->type != GenericEvent) X11DRV_flush_mouse_input();
     thread_data = x11drv_thread_data();
     prev = thread_data->current_event;
     thread_data->current_event = event;
@@ -467,6 +469,7 @@ static BOOL process_events( Display *display, Bool (*filter)(Display*, XEvent*,X
     }
     if (prev_event.type) queued |= call_event_handler( display, &prev_event );
     free_event_data( &prev_event );
+    X11DRV_flush_mouse_input();
     XFlush( gdi_display );
     if (count) TRACE( "processed %d events, returning %d\n", count, queued );
     return queued;
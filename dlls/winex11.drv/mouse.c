@@ -554,6 +554,40 @@ static BOOL is_old_motion_event( unsigned long serial )
 }
 
 
+/***********************************************************************
+ *		X11DRV_flush_mouse_input
+ *
+ * Send the buffered desktop mouse inputs to the server in a single batch.
+ */
+void X11DRV_flush_mouse_input(void)
+{
+    struct x11drv_thread_data *thread_data = x11drv_thread_data();
+    UINT count;
+
+    if (!thread_data || !(count = thread_data->pending_input_count)) return;
+    thread_data->pending_input_count = 0;
+    TRACE( "sending %u buffered inputs\n", count );
+    __wine_send_inputs( 0, thread_data->pending_inputs, count );
+}
+
+
+/***********************************************************************
+ *		queue_mouse_input
+ *
+ * Buffer a mouse input that isn't targeted at a specific window; it will be
+ * sent along with the following ones once the current batch of X events has
+ * been processed, or before any event that needs to be ordered after it.
+ */
+static void queue_mouse_input( const INPUT *input )
+{
+    struct x11drv_thread_data *thread_data = x11drv_thread_data();
+    const UINT max_count = sizeof(thread_data->pending_inputs) / sizeof(thread_data->pending_inputs[0]);
+
+    if (thread_data->pending_input_count == max_count) X11DRV_flush_mouse_input();
+    thread_data->pending_inputs[thread_data->pending_input_count++] = *input;
+}
+
+
 /***********************************************************************
  *		send_mouse_input
  *
@@ -581,10 +615,12 @@ static void send_mouse_input( HWND hwnd, Window window, unsigned int state, INPU
         }
         input->u.mi.dx += clip_rect.left;
         input->u.mi.dy += clip_rect.top;
-        __wine_send_input( hwnd, input );
+        queue_mouse_input( input );
         return;
     }
 
+    X11DRV_flush_mouse_input();
+
     if (window != root_window)
     {
         pt.x = input->u.mi.dx;
@@ -1749,7 +1785,7 @@ static BOOL X11DRV_RawMotion( XGenericEventCookie *xev )
     TRACE( "pos %d,%d (event %f,%f)\n", input.u.mi.dx, input.u.mi.dy, dx, dy );
 
     input.type = INPUT_MOUSE;
-    __wine_send_input( 0, &input );
+    queue_mouse_input( &input );
     return TRUE;
 }
 
@@ -64,6 +64,9 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
@@ -273,6 +276,37 @@ static CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static CRITICAL_SECTION csWSgetXXXbyYYY = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* client-side copy of the socket state needed by the send/recv paths */
+#define SOCK_CACHE_SIZE 256
+
+struct sock_cache_entry
+{
+    SOCKET            s;      /* socket handle, 0 if the entry is unused */
+    dev_t             dev;    /* identity of the unix socket the entry was filled for, */
+    ino_t             ino;    /* used to detect that the handle was closed and reused */
+    const sock_shm_t *shm;    /* state kept up to date by the server, NULL if not available */
+    BOOL              no_shm; /* the server has no shared state for the socket */
+};
+
+static struct sock_cache_entry sock_cache[SOCK_CACHE_SIZE];
+static void *sock_shm_base;  /* view of the shared socket states of the process */
+
+static struct
+{
+    LONG hits;             /* state lookups satisfied from the cache */
+    LONG misses;           /* state lookups that needed a server call */
+    LONG events_skipped;   /* event re-enable server calls avoided */
+} sock_cache_stats;
+
+static CRITICAL_SECTION sock_cache_cs;
+static CRITICAL_SECTION_DEBUG sock_cache_cs_debug =
+{
+    0, 0, &sock_cache_cs,
+    { &sock_cache_cs_debug.ProcessLocksList, &sock_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": sock_cache_cs") }
+};
+static CRITICAL_SECTION sock_cache_cs = { &sock_cache_cs_debug, -1, 0, 0, 0, 0 };
+
 union generic_unix_sockaddr
 {
     struct sockaddr addr;
@@ -1115,6 +1149,164 @@ static unsigned int _get_sock_mask(SOCKET s)
     return ret;
 }
 
+static inline struct sock_cache_entry *get_sock_cache_entry( SOCKET s )
+{
+    return &sock_cache[(s >> 2) % SOCK_CACHE_SIZE];
+}
+
+/* the handle may have been closed with CloseHandle or from another thread or
+ * process and then reused for a different socket, which may even get the same
+ * unix fd number; the socket inode is what really identifies it */
+static BOOL get_sock_identity( int fd, dev_t *dev, ino_t *ino )
+{
+    struct stat st;
+
+    if (fstat( fd, &st )) return FALSE;
+    *dev = st.st_dev;
+    *ino = st.st_ino;
+    return TRUE;
+}
+
+/* map the shared state of a socket, returns NULL if it isn't available */
+static const sock_shm_t *get_sock_shm( SOCKET s )
+{
+    obj_handle_t mapping = 0;
+    unsigned int index = 0;
+    NTSTATUS status;
+
+    SERVER_START_REQ( get_socket_shm )
+    {
+        req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
+        req->map    = !sock_shm_base;
+        if (!(status = wine_server_call( req )))
+        {
+            mapping = reply->mapping;
+            index   = reply->index;
+        }
+    }
+    SERVER_END_REQ;
+    if (status) return NULL;
+
+    if (mapping)
+    {
+        void *base = NULL;
+        SIZE_T size = 0;
+
+        if (!NtMapViewOfSection( wine_server_ptr_handle( mapping ), GetCurrentProcess(), &base, 0, 0,
+                                 NULL, &size, ViewShare, 0, PAGE_READONLY ) &&
+            InterlockedCompareExchangePointer( &sock_shm_base, base, NULL ))
+            NtUnmapViewOfSection( GetCurrentProcess(), base );  /* another thread was faster */
+        CloseHandle( wine_server_ptr_handle( mapping ));
+    }
+
+    if (!sock_shm_base) return NULL;
+    return (const sock_shm_t *)sock_shm_base + index;
+}
+
+/* make sure that reads of the shared socket state are not reordered across the sequence
+ * number reads; the mapping is read-only so interlocked operations can't be used here */
+static inline void read_barrier(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "" : : : "memory" );  /* loads are not reordered with other loads */
+#else
+    __sync_synchronize();
+#endif
+}
+
+/* retrieve the socket state and event mask; the server updates the shared copy of every
+ * process using the socket, so changes made through other handles are seen as well */
+static NTSTATUS get_sock_state( SOCKET s, int fd, unsigned int *state, unsigned int *mask )
+{
+    struct sock_cache_entry *entry = get_sock_cache_entry( s );
+    const sock_shm_t *shm = NULL;
+    dev_t dev;
+    ino_t ino;
+    BOOL known = get_sock_identity( fd, &dev, &ino );
+    BOOL no_shm = !known;
+    NTSTATUS status;
+    int seq;
+
+    EnterCriticalSection( &sock_cache_cs );
+    if (known && entry->s == s && entry->dev == dev && entry->ino == ino)
+    {
+        shm = entry->shm;
+        no_shm = entry->no_shm;
+    }
+    LeaveCriticalSection( &sock_cache_cs );
+
+    if (shm) InterlockedIncrement( &sock_cache_stats.hits );
+    else if (!no_shm)
+    {
+        shm = get_sock_shm( s );
+        InterlockedIncrement( &sock_cache_stats.misses );
+        EnterCriticalSection( &sock_cache_cs );
+        entry->s      = s;
+        entry->dev    = dev;
+        entry->ino    = ino;
+        entry->shm    = shm;
+        entry->no_shm = !shm;
+        LeaveCriticalSection( &sock_cache_cs );
+    }
+
+    if (shm)
+    {
+        do
+        {
+            seq    = shm->seq;
+            read_barrier();
+            *state = shm->state;
+            *mask  = shm->mask;
+            read_barrier();
+        } while ((seq & 1) || seq != shm->seq);
+        return STATUS_SUCCESS;
+    }
+
+    SERVER_START_REQ( get_socket_event )
+    {
+        req->handle  = wine_server_obj_handle( SOCKET2HANDLE(s) );
+        req->service = FALSE;
+        req->c_event = 0;
+        status = wine_server_call( req );
+        *state = reply->state;
+        *mask  = reply->mask;
+    }
+    SERVER_END_REQ;
+    InterlockedIncrement( &sock_cache_stats.misses );
+    return status;
+}
+
+static void remove_sock_state( SOCKET s )
+{
+    struct sock_cache_entry *entry = get_sock_cache_entry( s );
+
+    EnterCriticalSection( &sock_cache_cs );
+    if (entry->s == s) memset( entry, 0, sizeof(*entry) );
+    LeaveCriticalSection( &sock_cache_cs );
+}
+
+static NTSTATUS _is_blocking_fd( SOCKET s, int fd, BOOL *ret )
+{
+    unsigned int state, mask;
+    NTSTATUS status = get_sock_state( s, fd, &state, &mask );
+
+    if (!status) *ret = (state & FD_WINE_NONBLOCKING) == 0;
+    return status;
+}
+
+/* re-enable a held network event, which only matters if events have been selected */
+static void _reenable_event( SOCKET s, int fd, unsigned int event )
+{
+    unsigned int state, mask;
+
+    if (!get_sock_state( s, fd, &state, &mask ) && !mask)
+    {
+        InterlockedIncrement( &sock_cache_stats.events_skipped );
+        return;
+    }
+    _enable_event( SOCKET2HANDLE(s), event, 0, 0 );
+}
+
 static void _sync_sock_state(SOCKET s)
 {
     BOOL dummy;
@@ -1292,8 +1484,11 @@ BOOL WINAPI DllMain(HINSTANCE hInstDLL, DWORD fdwReason, LPVOID fImpLoad)
         break;
     case DLL_PROCESS_DETACH:
         if (fImpLoad) break;
+        TRACE("socket state cache: %d hits, %d misses, %d event requests skipped\n",
+              sock_cache_stats.hits, sock_cache_stats.misses, sock_cache_stats.events_skipped);
         free_per_thread_data();
         DeleteCriticalSection(&csWSgetXXXbyYYY);
+        DeleteCriticalSection(&sock_cache_cs);
         break;
     case DLL_THREAD_DETACH:
         free_per_thread_data();
@@ -3411,6 +3606,7 @@ int WINAPI WS_closesocket(SOCKET s)
         if (fd >= 0)
         {
             release_sock_fd(s, fd);
+            remove_sock_state(s);
             if (CloseHandle(SOCKET2HANDLE(s)))
                 res = 0;
         }
@@ -5663,7 +5859,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         return 0;
     }
 
-    if ((err = _is_blocking( s, &is_blocking )))
+    if ((err = _is_blocking_fd( s, fd, &is_blocking )))
     {
         err = NtStatusToWSAError( err );
         goto error;
@@ -5713,7 +5909,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     else  /* non-blocking */
     {
         if (n < totalLength)
-            _enable_event(SOCKET2HANDLE(s), FD_WRITE, 0, 0);
+            _reenable_event( s, fd, FD_WRITE );
         if (n == -1)
         {
             err = WSAEWOULDBLOCK;
@@ -7843,7 +8039,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
         if (n != -1) break;
 
-        if ((err = _is_blocking( s, &is_blocking )))
+        if ((err = _is_blocking_fd( s, fd, &is_blocking )))
         {
             err = NtStatusToWSAError( err );
             goto error;
@@ -7870,13 +8066,13 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             {
                 err = WSAETIMEDOUT;
                 /* a timeout is not fatal */
-                _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+                _reenable_event( s, fd, FD_READ );
                 goto error;
             }
         }
         else
         {
-            _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+            _reenable_event( s, fd, FD_READ );
             err = WSAEWOULDBLOCK;
             goto error;
         }
@@ -7884,8 +8080,8 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
     TRACE(" -> %i bytes\n", n);
     if (wsa != &localwsa) HeapFree( GetProcessHeap(), 0, wsa );
+    _reenable_event( s, fd, FD_READ );
     release_sock_fd( s, fd );
-    _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
     SetLastError(ERROR_SUCCESS);
 
     return 0;
@@ -5259,6 +5259,97 @@ static void test_ioctlsocket(void)
     closesocket(src);
 }
 
+static void test_blocking_state_changes(void)
+{
+    SOCKET src, dst, dup;
+    WSAEVENT event;
+    DWORD timeout = 100;
+    char buffer[4];
+    int ret;
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(0, "creating socket pair failed, skipping test\n");
+        return;
+    }
+    ret = setsockopt(dst, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+    ok(!ret, "setsockopt(SO_RCVTIMEO) failed, error %d\n", WSAGetLastError());
+
+    /* the state used by recv must follow every mode change */
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+    ok(WSAGetLastError() == WSAETIMEDOUT, "expected WSAETIMEDOUT, got %d\n", WSAGetLastError());
+
+    set_blocking(dst, FALSE);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+    ok(WSAGetLastError() == WSAEWOULDBLOCK, "expected WSAEWOULDBLOCK, got %d\n", WSAGetLastError());
+
+    set_blocking(dst, TRUE);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+    ok(WSAGetLastError() == WSAETIMEDOUT, "expected WSAETIMEDOUT, got %d\n", WSAGetLastError());
+
+    event = WSACreateEvent();
+    ret = WSAEventSelect(dst, event, FD_READ);
+    ok(!ret, "WSAEventSelect failed, error %d\n", WSAGetLastError());
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+    ok(WSAGetLastError() == WSAEWOULDBLOCK, "expected WSAEWOULDBLOCK, got %d\n", WSAGetLastError());
+
+    ok(send(src, "TEST", 4, 0) == 4, "failed to send test data\n");
+    ret = WaitForSingleObject(event, 1000);
+    ok(ret == WAIT_OBJECT_0, "FD_READ was not signaled, ret %d\n", ret);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == 4, "expected 4, got %d\n", ret);
+
+    /* clearing the event mask keeps the socket non-blocking */
+    ret = WSAEventSelect(dst, NULL, 0);
+    ok(!ret, "WSAEventSelect failed, error %d\n", WSAGetLastError());
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+    ok(WSAGetLastError() == WSAEWOULDBLOCK, "expected WSAEWOULDBLOCK, got %d\n", WSAGetLastError());
+
+    set_blocking(dst, TRUE);
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+    ok(WSAGetLastError() == WSAETIMEDOUT, "expected WSAETIMEDOUT, got %d\n", WSAGetLastError());
+
+    /* data received while no events are selected doesn't leave a stale FD_READ */
+    ok(send(src, "TEST", 4, 0) == 4, "failed to send test data\n");
+    ret = recv(dst, buffer, sizeof(buffer), 0);
+    ok(ret == 4, "expected 4, got %d\n", ret);
+    ResetEvent(event);
+    ret = WSAEventSelect(dst, event, FD_READ);
+    ok(!ret, "WSAEventSelect failed, error %d\n", WSAGetLastError());
+    ret = WaitForSingleObject(event, 100);
+    ok(ret == WAIT_TIMEOUT, "FD_READ was signaled without data, ret %d\n", ret);
+    ret = WSAEventSelect(dst, NULL, 0);
+    ok(!ret, "WSAEventSelect failed, error %d\n", WSAGetLastError());
+    set_blocking(dst, TRUE);
+
+    /* mode changes made through another handle to the same socket */
+    if (DuplicateHandle(GetCurrentProcess(), (HANDLE)dst, GetCurrentProcess(), (HANDLE *)&dup,
+                        0, FALSE, DUPLICATE_SAME_ACCESS))
+    {
+        set_blocking(dup, FALSE);
+        ret = recv(dst, buffer, sizeof(buffer), 0);
+        ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+        ok(WSAGetLastError() == WSAEWOULDBLOCK, "expected WSAEWOULDBLOCK, got %d\n", WSAGetLastError());
+
+        set_blocking(dup, TRUE);
+        ret = recv(dst, buffer, sizeof(buffer), 0);
+        ok(ret == SOCKET_ERROR, "expected -1, got %d\n", ret);
+        ok(WSAGetLastError() == WSAETIMEDOUT, "expected WSAETIMEDOUT, got %d\n", WSAGetLastError());
+        CloseHandle((HANDLE)dup);
+    }
+    else win_skip("DuplicateHandle doesn't work on sockets\n");
+
+    WSACloseEvent(event);
+    closesocket(dst);
+    closesocket(src);
+}
+
 static BOOL drain_pause = FALSE;
 static DWORD WINAPI drain_socket_thread(LPVOID arg)
 {
@@ -10250,6 +10341,7 @@ START_TEST( sock )
     test_inet_addr();
     test_addr_to_print();
     test_ioctlsocket();
+    test_blocking_state_changes();
     test_dns();
     test_gethostbyname();
     test_gethostbyname_hack();
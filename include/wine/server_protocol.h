@@ -701,6 +701,26 @@ typedef struct
     unsigned int   checksum;
 } pe_image_info_t;
 
+
+typedef volatile struct
+{
+    int            seq;
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_mask;
+    unsigned int   __pad[3];
+} queue_shm_t;
+
+
+typedef volatile struct
+{
+    int            seq;
+    unsigned int   state;
+    unsigned int   mask;
+    unsigned int   __pad;
+} sock_shm_t;
+
 struct rawinput_device
 {
     unsigned short usage_page;
@@ -1639,6 +1659,22 @@ struct get_socket_event_reply
 
 
 
+struct get_socket_shm_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    int          map;
+    char __pad_20[4];
+};
+struct get_socket_shm_reply
+{
+    struct reply_header __header;
+    obj_handle_t mapping;
+    unsigned int index;
+};
+
+
+
 struct get_socket_info_request
 {
     struct request_header __header;
@@ -2903,6 +2939,20 @@ struct get_msg_queue_reply
 
 
 
+struct get_queue_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_queue_shm_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    unsigned int index;
+};
+
+
+
 struct set_queue_fd_request
 {
     struct request_header __header;
@@ -3027,6 +3077,32 @@ struct send_hardware_message_reply
 
 
 
+struct send_hardware_messages_request
+{
+    struct request_header __header;
+    user_handle_t   win;
+    unsigned int    flags;
+    /* VARARG(inputs,hw_inputs); */
+    char __pad_20[4];
+};
+struct send_hardware_messages_reply
+{
+    struct reply_header __header;
+    unsigned int    count;
+    int             wait;
+    unsigned int    queued;
+    unsigned int    merged;
+    unsigned int    dropped;
+    int             prev_x;
+    int             prev_y;
+    int             new_x;
+    int             new_y;
+    /* VARARG(keystate,bytes); */
+    char __pad_44[4];
+};
+
+
+
 struct get_message_request
 {
     struct request_header __header;
@@ -5603,6 +5679,7 @@ enum request
     REQ_accept_into_socket,
     REQ_set_socket_event,
     REQ_get_socket_event,
+    REQ_get_socket_shm,
     REQ_get_socket_info,
     REQ_enable_socket_event,
     REQ_set_socket_deferred,
@@ -5675,6 +5752,7 @@ enum request
     REQ_empty_atom_table,
     REQ_init_atom_table,
     REQ_get_msg_queue,
+    REQ_get_queue_shm,
     REQ_set_queue_fd,
     REQ_set_queue_mask,
     REQ_get_queue_status,
@@ -5682,6 +5760,7 @@ enum request
     REQ_send_message,
     REQ_post_quit_message,
     REQ_send_hardware_message,
+    REQ_send_hardware_messages,
     REQ_get_message,
     REQ_reply_message,
     REQ_accept_hardware_message,
@@ -5893,6 +5972,7 @@ union generic_request
     struct accept_into_socket_request accept_into_socket_request;
     struct set_socket_event_request set_socket_event_request;
     struct get_socket_event_request get_socket_event_request;
+    struct get_socket_shm_request get_socket_shm_request;
     struct get_socket_info_request get_socket_info_request;
     struct enable_socket_event_request enable_socket_event_request;
     struct set_socket_deferred_request set_socket_deferred_request;
@@ -5965,6 +6045,7 @@ union generic_request
     struct empty_atom_table_request empty_atom_table_request;
     struct init_atom_table_request init_atom_table_request;
     struct get_msg_queue_request get_msg_queue_request;
+    struct get_queue_shm_request get_queue_shm_request;
     struct set_queue_fd_request set_queue_fd_request;
     struct set_queue_mask_request set_queue_mask_request;
     struct get_queue_status_request get_queue_status_request;
@@ -5972,6 +6053,7 @@ union generic_request
     struct send_message_request send_message_request;
     struct post_quit_message_request post_quit_message_request;
     struct send_hardware_message_request send_hardware_message_request;
+    struct send_hardware_messages_request send_hardware_messages_request;
     struct get_message_request get_message_request;
     struct reply_message_request reply_message_request;
     struct accept_hardware_message_request accept_hardware_message_request;
@@ -6181,6 +6263,7 @@ union generic_reply
     struct accept_into_socket_reply accept_into_socket_reply;
     struct set_socket_event_reply set_socket_event_reply;
     struct get_socket_event_reply get_socket_event_reply;
+    struct get_socket_shm_reply get_socket_shm_reply;
     struct get_socket_info_reply get_socket_info_reply;
     struct enable_socket_event_reply enable_socket_event_reply;
     struct set_socket_deferred_reply set_socket_deferred_reply;
@@ -6253,6 +6336,7 @@ union generic_reply
     struct empty_atom_table_reply empty_atom_table_reply;
     struct init_atom_table_reply init_atom_table_reply;
     struct get_msg_queue_reply get_msg_queue_reply;
+    struct get_queue_shm_reply get_queue_shm_reply;
     struct set_queue_fd_reply set_queue_fd_reply;
     struct set_queue_mask_reply set_queue_mask_reply;
     struct get_queue_status_reply get_queue_status_reply;
@@ -6260,6 +6344,7 @@ union generic_reply
     struct send_message_reply send_message_reply;
     struct post_quit_message_reply post_quit_message_reply;
     struct send_hardware_message_reply send_hardware_message_reply;
+    struct send_hardware_messages_reply send_hardware_messages_reply;
     struct get_message_reply get_message_reply;
     struct reply_message_reply reply_message_reply;
     struct accept_hardware_message_reply accept_hardware_message_reply;
@@ -6412,6 +6497,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 524
+#define SERVER_PROTOCOL_VERSION 528
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -4162,6 +4162,7 @@ WORD        WINAPI SYSTEM_KillSystemTimer( WORD );
 
 #ifdef __WINESRC__
 WINUSERAPI BOOL CDECL __wine_send_input( HWND hwnd, const INPUT *input );
+WINUSERAPI UINT CDECL __wine_send_inputs( HWND hwnd, const INPUT *inputs, UINT count );
 #endif
 
 #ifdef __cplusplus
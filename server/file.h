@@ -145,6 +145,8 @@ extern struct mapping *get_mapping_obj( struct process *process, obj_handle_t ha
 extern obj_handle_t open_mapping_file( struct process *process, struct mapping *mapping,
                                        unsigned int access, unsigned int sharing );
 extern struct mapping *grab_mapping_unless_removable( struct mapping *mapping );
+extern struct mapping *create_shared_mapping( mem_size_t size, void **ptr );
+extern void release_shared_mapping( struct mapping *mapping, void *ptr );
 extern int get_page_size(void);
 
 /* device functions */
@@ -634,6 +634,35 @@ struct mapping *grab_mapping_unless_removable( struct mapping *mapping )
     return (struct mapping *)grab_object( mapping );
 }
 
+/* create an anonymous read-write mapping that is also mapped in the server address space */
+struct mapping *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    struct mapping *mapping;
+    void *base;
+
+    if (!(mapping = (struct mapping *)create_mapping( NULL, NULL, 0, size, SEC_COMMIT,
+                                                      VPROT_READ | VPROT_WRITE, 0, NULL )))
+        return NULL;
+
+    base = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 get_unix_fd( mapping->fd ), 0 );
+    if (base == MAP_FAILED)
+    {
+        file_set_error();
+        release_object( mapping );
+        return NULL;
+    }
+    *ptr = base;
+    return mapping;
+}
+
+/* unmap and release a mapping created with create_shared_mapping */
+void release_shared_mapping( struct mapping *mapping, void *ptr )
+{
+    munmap( ptr, mapping->size );
+    release_object( mapping );
+}
+
 static void mapping_dump( struct object *obj, int verbose )
 {
     struct mapping *mapping = (struct mapping *)obj;
@@ -81,6 +81,7 @@ struct pipe_server
     struct pipe_client  *client;     /* client that this server is connected to */
     struct named_pipe   *pipe;
     struct timeout_user *flush_poll;
+    timeout_t            flush_delay; /* current flush polling interval */
     unsigned int         options;    /* pipe options */
 };
 
@@ -513,6 +514,11 @@ struct object *create_named_pipe_device( struct object *root, const struct unico
     return &dev->obj;
 }
 
+/* flush polling starts with a short interval so that a reader that is keeping
+ * up with the writer completes the flush quickly, and backs off from there */
+#define FLUSH_POLL_MIN_DELAY  (TICKS_PER_SEC / 1000)
+#define FLUSH_POLL_MAX_DELAY  (TICKS_PER_SEC / 10)
+
 static int pipe_data_remaining( struct pipe_server *server )
 {
     struct pollfd pfd;
@@ -539,7 +545,8 @@ static void check_flushed( void *arg )
 
     if (pipe_data_remaining( server ))
     {
-        server->flush_poll = add_timeout_user( -TICKS_PER_SEC / 10, check_flushed, server );
+        server->flush_delay = min( server->flush_delay * 2, FLUSH_POLL_MAX_DELAY );
+        server->flush_poll = add_timeout_user( -server->flush_delay, check_flushed, server );
     }
     else
     {
@@ -572,7 +579,10 @@ static obj_handle_t pipe_server_flush( struct fd *fd, struct async *async, int b
 
     /* there's no unix way to be alerted when a pipe becomes empty, so resort to polling */
     if (handle && !server->flush_poll)
-        server->flush_poll = add_timeout_user( -TICKS_PER_SEC / 10, check_flushed, server );
+    {
+        server->flush_delay = FLUSH_POLL_MIN_DELAY;
+        server->flush_poll = add_timeout_user( -server->flush_delay, check_flushed, server );
+    }
     return handle;
 }
 
@@ -692,6 +702,7 @@ static struct pipe_server *create_pipe_server( struct named_pipe *pipe, unsigned
     server->pipe = pipe;
     server->client = NULL;
     server->flush_poll = NULL;
+    server->flush_delay = 0;
     server->options = options;
     init_pipe_end( &server->pipe_end, pipe_flags );
 
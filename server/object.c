@@ -50,6 +50,22 @@ struct namespace
 };
 
 
+/* pool of freed objects of a given type, kept around for reuse */
+struct object_pool
+{
+    struct object_pool      *next;        /* next pool in the hash bucket */
+    const struct object_ops *ops;         /* type of the pooled objects */
+    void                    *free_list;   /* freed objects, linked through their first pointer */
+    unsigned int             free_count;  /* number of objects in the free list */
+    unsigned int             live;        /* number of currently allocated objects */
+    unsigned int             peak;        /* highest number of allocated objects */
+};
+
+#define OBJECT_POOL_HASH_SIZE 61  /* number of buckets in the pool hash table */
+#define OBJECT_POOL_MAX_FREE  64  /* max number of freed objects kept in a pool */
+
+static struct object_pool *object_pools[OBJECT_POOL_HASH_SIZE];
+
 #ifdef DEBUG_OBJECTS
 static struct list object_list = LIST_INIT(object_list);
 static struct list static_object_list = LIST_INIT(static_object_list);
@@ -74,6 +90,65 @@ void dump_objects(void)
     }
 }
 
+/* find a live object of a given type, to identify a pool in the dump */
+static struct object *find_pool_sample( const struct object_ops *ops )
+{
+    struct list *p;
+
+    LIST_FOR_EACH( p, &object_list )
+    {
+        struct object *ptr = LIST_ENTRY( p, struct object, obj_list );
+        if (ptr->ops == ops) return ptr;
+    }
+    LIST_FOR_EACH( p, &static_object_list )
+    {
+        struct object *ptr = LIST_ENTRY( p, struct object, obj_list );
+        if (ptr->ops == ops) return ptr;
+    }
+    return NULL;
+}
+
+void dump_object_pools(void)
+{
+    struct object_pool *pool;
+    struct object *sample;
+    unsigned int i;
+
+    for (i = 0; i < OBJECT_POOL_HASH_SIZE; i++)
+    {
+        for (pool = object_pools[i]; pool; pool = pool->next)
+        {
+            fprintf( stderr, "pool %p: size=%u live=%u peak=%u free=%u ",
+                     pool->ops, (unsigned int)pool->ops->size, pool->live, pool->peak, pool->free_count );
+            if ((sample = find_pool_sample( pool->ops ))) sample->ops->dump( sample, 0 );
+            else fputc( '\n', stderr );
+        }
+    }
+}
+
+/* release the memory held by the object pools */
+static void free_object_pools(void)
+{
+    struct object_pool *pool, *next;
+    unsigned int i;
+    void *ptr;
+
+    for (i = 0; i < OBJECT_POOL_HASH_SIZE; i++)
+    {
+        for (pool = object_pools[i]; pool; pool = next)
+        {
+            next = pool->next;
+            while ((ptr = pool->free_list))
+            {
+                pool->free_list = *(void **)ptr;
+                free( ptr );
+            }
+            free( pool );
+        }
+        object_pools[i] = NULL;
+    }
+}
+
 void close_objects(void)
 {
     struct list *ptr;
@@ -89,6 +164,7 @@ void close_objects(void)
     }
 
     dump_objects();  /* dump any remaining objects */
+    free_object_pools();
 }
 
 #endif  /* DEBUG_OBJECTS */
@@ -125,6 +201,69 @@ void *memdup( const void *data, size_t len )
 }
 
 
+/*****************************************************************/
+
+/* get the allocation pool for a given object type, creating it if needed */
+static struct object_pool *get_object_pool( const struct object_ops *ops )
+{
+    unsigned int hash = ((unsigned long)ops >> 4) % OBJECT_POOL_HASH_SIZE;
+    struct object_pool *pool;
+
+    for (pool = object_pools[hash]; pool; pool = pool->next)
+        if (pool->ops == ops) return pool;
+
+    if (!(pool = mem_alloc( sizeof(*pool) ))) return NULL;
+    pool->ops        = ops;
+    pool->free_list  = NULL;
+    pool->free_count = 0;
+    pool->live       = 0;
+    pool->peak       = 0;
+    pool->next       = object_pools[hash];
+    object_pools[hash] = pool;
+    return pool;
+}
+
+/* allocate memory for an object, reusing a previously freed one if possible */
+static void *pool_alloc( const struct object_ops *ops )
+{
+    struct object_pool *pool = get_object_pool( ops );
+    void *ptr;
+
+    if (!pool) return NULL;
+    if ((ptr = pool->free_list))
+    {
+        pool->free_list = *(void **)ptr;
+        pool->free_count--;
+        mark_block_uninitialized( ptr, ops->size );
+    }
+    else if (!(ptr = mem_alloc( ops->size ))) return NULL;
+
+    if (++pool->live > pool->peak) pool->peak = pool->live;
+    return ptr;
+}
+
+/* return the memory of a destroyed object to its pool */
+static void pool_free( const struct object_ops *ops, void *ptr )
+{
+    struct object_pool *pool = get_object_pool( ops );
+
+    if (!pool)
+    {
+        free( ptr );
+        return;
+    }
+    pool->live--;
+    if (pool->free_count >= OBJECT_POOL_MAX_FREE)
+    {
+        free( ptr );
+        return;
+    }
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+    pool->free_count++;
+}
+
+
 /*****************************************************************/
 
 static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
@@ -197,7 +336,7 @@ WCHAR *get_object_full_name( struct object *obj, data_size_t *ret_len )
 /* allocate and initialize an object */
 void *alloc_object( const struct object_ops *ops )
 {
-    struct object *obj = mem_alloc( ops->size );
+    struct object *obj = pool_alloc( ops );
     if (obj)
     {
         obj->refcount     = 1;
@@ -217,12 +356,14 @@ void *alloc_object( const struct object_ops *ops )
 /* free an object once it has been destroyed */
 void free_object( struct object *obj )
 {
+    const struct object_ops *ops = obj->ops;
+
     free( obj->sd );
 #ifdef DEBUG_OBJECTS
     list_remove( &obj->obj_list );
-    memset( obj, 0xaa, obj->ops->size );
+    memset( obj, 0xaa, ops->size );
 #endif
-    free( obj );
+    pool_free( ops, obj );
 }
 
 /* find an object by name starting from the specified root */
@@ -167,6 +167,7 @@ extern int no_close_handle( struct object *obj, struct process *process, obj_han
 extern void no_destroy( struct object *obj );
 #ifdef DEBUG_OBJECTS
 extern void dump_objects(void);
+extern void dump_object_pools(void);
 extern void close_objects(void);
 #endif
 
@@ -197,6 +198,7 @@ int get_serial_async_timeout(struct object *obj, int type, int count);
 /* socket functions */
 
 extern void sock_init(void);
+extern void free_process_sock_shm( struct process *process );
 
 /* debugger functions */
 
@@ -27,6 +27,8 @@ struct atom_table;
 struct handle_table;
 struct startup_info;
 struct job;
+struct queue_shm_block;
+struct sock_shm_block;
 
 /* process startup state */
 enum startup_state { STARTUP_IN_PROGRESS, STARTUP_DONE, STARTUP_ABORTED };
@@ -96,6 +98,8 @@ struct process
     struct list          rawinput_devices;/* list of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
+    struct queue_shm_block *queue_shm;    /* shared states of the process message queues */
+    struct sock_shm_block *sock_shm;      /* shared states of the sockets used by the process */
 };
 
 struct process_snapshot
@@ -140,6 +140,8 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    queue_shm_t           *shm;             /* state shared with the client, or NULL */
+    struct queue_shm_block *shm_block;      /* shared states block holding shm */
 };
 
 struct hotkey
@@ -223,6 +225,29 @@ static const struct object_ops thread_input_ops =
 /* pointer to input structure of foreground thread */
 static unsigned int last_input_time;
 
+#define QUEUE_SHM_COUNT 128  /* max number of queues with a shared state per process */
+
+/* shared states of the queues of a process, only ever mapped by that process */
+struct queue_shm_block
+{
+    struct mapping *mapping;                 /* mapping holding the shared queue states */
+    queue_shm_t    *entries;                 /* server view of the mapping */
+    unsigned int    refcount;                /* one for the process and one per allocated entry */
+    unsigned int    count;                   /* number of entries handed out so far */
+    int             free_list;               /* first free entry, chained through next */
+    int             next[QUEUE_SHM_COUNT];
+};
+
+static int queue_shm_disabled;  /* set once creating a shared mapping failed */
+
+/* hardware message statistics, reported by the send_hardware_messages request */
+static struct
+{
+    unsigned int queued;   /* messages added to a thread input queue */
+    unsigned int merged;   /* mouse moves merged into an already queued message */
+    unsigned int dropped;  /* messages discarded without being queued */
+} hw_msg_stats;
+
 static void queue_hardware_message( struct desktop *desktop, struct message *msg, int always_queue );
 static void free_message( struct message *msg );
 
@@ -268,6 +293,90 @@ static struct thread_input *create_thread_input( struct thread *thread )
     return input;
 }
 
+static void release_queue_shm_block( struct queue_shm_block *block )
+{
+    if (--block->refcount) return;
+    release_shared_mapping( block->mapping, (void *)block->entries );
+    free( block );
+}
+
+/* allocate an entry in the shared states of the queue process, queues without one always go through the server */
+static void alloc_queue_shm( struct msg_queue *queue, struct process *process )
+{
+    struct queue_shm_block *block = process->queue_shm;
+    int index;
+
+    if (!block)
+    {
+        if (queue_shm_disabled || !(block = mem_alloc( sizeof(*block) )))
+        {
+            clear_error();
+            return;
+        }
+        if (!(block->mapping = create_shared_mapping( QUEUE_SHM_COUNT * sizeof(queue_shm_t),
+                                                      (void **)&block->entries )))
+        {
+            /* don't try again for every new queue */
+            queue_shm_disabled = 1;
+            clear_error();
+            free( block );
+            return;
+        }
+        block->refcount  = 1;
+        block->count     = 0;
+        block->free_list = -1;
+        process->queue_shm = block;
+    }
+
+    if (block->free_list != -1)
+    {
+        index = block->free_list;
+        block->free_list = block->next[index];
+    }
+    else if (block->count < QUEUE_SHM_COUNT) index = block->count++;
+    else return;
+
+    block->refcount++;
+    queue->shm = &block->entries[index];
+    queue->shm_block = block;
+}
+
+static void free_queue_shm( struct msg_queue *queue )
+{
+    struct queue_shm_block *block = queue->shm_block;
+    int index = queue->shm - block->entries;
+
+    block->next[index] = block->free_list;
+    block->free_list = index;
+    queue->shm = NULL;
+    queue->shm_block = NULL;
+    release_queue_shm_block( block );
+}
+
+/* free the shared queue states of a process, its queues may still hold references to them */
+void free_process_queue_shm( struct process *process )
+{
+    if (!process->queue_shm) return;
+    release_queue_shm_block( process->queue_shm );
+    process->queue_shm = NULL;
+}
+
+/* publish the queue state to the client, must be called after every change */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    queue_shm_t *shm = queue->shm;
+
+    if (!shm) return;
+    /* the interlocked increments order the field stores against the sequence number
+     * stores, clients retry until they see the same even value before and after */
+    interlocked_xchg_add( (int *)&shm->seq, 1 );
+    shm->wake_bits    = queue->wake_bits;
+    shm->changed_bits = queue->changed_bits;
+    shm->wake_mask    = queue->wake_mask;
+    shm->changed_mask = queue->changed_mask;
+    interlocked_xchg_add( (int *)&shm->seq, 1 );
+}
+
 /* create a message queue object */
 static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_input *input )
 {
@@ -298,11 +407,15 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->shm             = NULL;
+        queue->shm_block       = NULL;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        alloc_queue_shm( queue, thread->process );
+        update_queue_shm( queue );
 
         thread->queue = queue;
     }
@@ -440,6 +553,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shm( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -448,6 +562,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shm( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -957,6 +1072,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_queue_shm( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -995,6 +1111,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shm) free_queue_shm( queue );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1519,6 +1636,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     {
         if (input) update_input_key_state( input->desktop, input->keystate, msg );
         free_message( msg );
+        hw_msg_stats.dropped++;
         return;
     }
     input = thread->queue->input;
@@ -1526,9 +1644,19 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     if (win != desktop->cursor.win) always_queue = 1;
     desktop->cursor.win = win;
 
-    if (!always_queue || merge_message( input, msg )) free_message( msg );
+    if (!always_queue)
+    {
+        free_message( msg );
+        hw_msg_stats.dropped++;
+    }
+    else if (merge_message( input, msg ))
+    {
+        free_message( msg );
+        hw_msg_stats.merged++;
+    }
     else
     {
+        hw_msg_stats.queued++;
         msg->unique_id = 0;  /* will be set once we return it to the app */
         list_add_tail( &input->msg_list, &msg->entry );
         set_queue_bits( thread->queue, get_hardware_msg_bit(msg) );
@@ -2222,6 +2350,18 @@ DECL_HANDLER(get_msg_queue)
 }
 
 
+/* get the shared memory state of the current thread queue */
+DECL_HANDLER(get_queue_shm)
+{
+    struct msg_queue *queue = get_current_queue();
+
+    if (!queue || !queue->shm) return;
+    reply->index  = queue->shm - queue->shm_block->entries;
+    reply->handle = alloc_handle( current->process, queue->shm_block->mapping,
+                                  SECTION_MAP_READ | SECTION_QUERY, 0 );
+}
+
+
 /* set the file descriptor associated to the current thread queue */
 DECL_HANDLER(set_queue_fd)
 {
@@ -2264,6 +2404,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_queue_shm( queue );
     }
 }
 
@@ -2277,6 +2418,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shm( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2362,46 +2504,92 @@ DECL_HANDLER(send_message)
     release_object( thread );
 }
 
+/* queue a single hardware input; return non-zero if the caller has to wait for a hook reply */
+static int queue_hardware_input( struct desktop *desktop, user_handle_t win, const hw_input_t *input,
+                                 unsigned int flags, struct msg_queue *sender )
+{
+    switch (input->type)
+    {
+    case INPUT_MOUSE:
+        return queue_mouse_message( desktop, win, input, flags, sender );
+    case INPUT_KEYBOARD:
+        return queue_keyboard_message( desktop, win, input, flags, sender );
+    case INPUT_HARDWARE:
+        queue_custom_hardware_message( desktop, win, input );
+        return 0;
+    default:
+        set_error( STATUS_INVALID_PARAMETER );
+        return 0;
+    }
+}
+
+/* get the desktop of the current thread, checking that the target window belongs to it */
+static struct desktop *get_hardware_input_desktop( user_handle_t win )
+{
+    struct thread *thread;
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return NULL;
+    if (!win) return desktop;
+
+    if ((thread = get_window_thread( win )))
+    {
+        /* don't allow queuing events to a different desktop */
+        int ok = (desktop == thread->queue->input->desktop);
+        release_object( thread );
+        if (ok) return desktop;
+    }
+    release_object( desktop );
+    return NULL;
+}
+
 /* send a hardware message to a thread queue */
 DECL_HANDLER(send_hardware_message)
 {
-    struct thread *thread = NULL;
     struct desktop *desktop;
     struct msg_queue *sender = get_current_queue();
     data_size_t size = min( 256, get_reply_max_size() );
 
-    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (!(desktop = get_hardware_input_desktop( req->win ))) return;
 
-    if (req->win)
-    {
-        if (!(thread = get_window_thread( req->win ))) return;
-        if (desktop != thread->queue->input->desktop)
-        {
-            /* don't allow queuing events to a different desktop */
-            release_object( desktop );
-            return;
-        }
-    }
+    reply->prev_x = desktop->cursor.x;
+    reply->prev_y = desktop->cursor.y;
+
+    reply->wait = queue_hardware_input( desktop, req->win, &req->input, req->flags, sender );
+
+    reply->new_x = desktop->cursor.x;
+    reply->new_y = desktop->cursor.y;
+    set_reply_data( desktop->keystate, size );
+    release_object( desktop );
+}
+
+/* send several hardware messages; stops after the first one that needs a hook reply */
+DECL_HANDLER(send_hardware_messages)
+{
+    struct desktop *desktop;
+    struct msg_queue *sender = get_current_queue();
+    const hw_input_t *input = get_req_data();
+    data_size_t count = get_req_data_size() / sizeof(*input);
+    data_size_t size = min( 256, get_reply_max_size() );
+    unsigned int queued = hw_msg_stats.queued, merged = hw_msg_stats.merged;
+    unsigned int dropped = hw_msg_stats.dropped;
+
+    if (!(desktop = get_hardware_input_desktop( req->win ))) return;
 
     reply->prev_x = desktop->cursor.x;
     reply->prev_y = desktop->cursor.y;
 
-    switch (req->input.type)
+    while (reply->count < count)
     {
-    case INPUT_MOUSE:
-        reply->wait = queue_mouse_message( desktop, req->win, &req->input, req->flags, sender );
-        break;
-    case INPUT_KEYBOARD:
-        reply->wait = queue_keyboard_message( desktop, req->win, &req->input, req->flags, sender );
-        break;
-    case INPUT_HARDWARE:
-        queue_custom_hardware_message( desktop, req->win, &req->input );
-        break;
-    default:
-        set_error( STATUS_INVALID_PARAMETER );
+        reply->wait = queue_hardware_input( desktop, req->win, &input[reply->count], req->flags, sender );
+        if (get_error()) break;
+        reply->count++;
+        if (reply->wait) break;
     }
-    if (thread) release_object( thread );
 
+    reply->queued = hw_msg_stats.queued - queued;
+    reply->merged = hw_msg_stats.merged - merged;
+    reply->dropped = hw_msg_stats.dropped - dropped;
     reply->new_x = desktop->cursor.x;
     reply->new_y = desktop->cursor.y;
     set_reply_data( desktop->keystate, size );
@@ -2452,6 +2640,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shm( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2506,6 +2695,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_queue_shm( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
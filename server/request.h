@@ -166,6 +166,7 @@ DECL_HANDLER(accept_socket);
 DECL_HANDLER(accept_into_socket);
 DECL_HANDLER(set_socket_event);
 DECL_HANDLER(get_socket_event);
+DECL_HANDLER(get_socket_shm);
 DECL_HANDLER(get_socket_info);
 DECL_HANDLER(enable_socket_event);
 DECL_HANDLER(set_socket_deferred);
@@ -238,6 +239,7 @@ DECL_HANDLER(set_atom_information);
 DECL_HANDLER(empty_atom_table);
 DECL_HANDLER(init_atom_table);
 DECL_HANDLER(get_msg_queue);
+DECL_HANDLER(get_queue_shm);
 DECL_HANDLER(set_queue_fd);
 DECL_HANDLER(set_queue_mask);
 DECL_HANDLER(get_queue_status);
@@ -245,6 +247,7 @@ DECL_HANDLER(get_process_idle_event);
 DECL_HANDLER(send_message);
 DECL_HANDLER(post_quit_message);
 DECL_HANDLER(send_hardware_message);
+DECL_HANDLER(send_hardware_messages);
 DECL_HANDLER(get_message);
 DECL_HANDLER(reply_message);
 DECL_HANDLER(accept_hardware_message);
@@ -455,6 +458,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_accept_into_socket,
     (req_handler)req_set_socket_event,
     (req_handler)req_get_socket_event,
+    (req_handler)req_get_socket_shm,
     (req_handler)req_get_socket_info,
     (req_handler)req_enable_socket_event,
     (req_handler)req_set_socket_deferred,
@@ -527,6 +531,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_empty_atom_table,
     (req_handler)req_init_atom_table,
     (req_handler)req_get_msg_queue,
+    (req_handler)req_get_queue_shm,
     (req_handler)req_set_queue_fd,
     (req_handler)req_set_queue_mask,
     (req_handler)req_get_queue_status,
@@ -534,6 +539,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_send_message,
     (req_handler)req_post_quit_message,
     (req_handler)req_send_hardware_message,
+    (req_handler)req_send_hardware_messages,
     (req_handler)req_get_message,
     (req_handler)req_reply_message,
     (req_handler)req_accept_hardware_message,
@@ -1059,6 +1065,12 @@ C_ASSERT( FIELD_OFFSET(struct get_socket_event_reply, mask) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_socket_event_reply, pmask) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_socket_event_reply, state) == 16 );
 C_ASSERT( sizeof(struct get_socket_event_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_socket_shm_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_socket_shm_request, map) == 16 );
+C_ASSERT( sizeof(struct get_socket_shm_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_socket_shm_reply, mapping) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_socket_shm_reply, index) == 12 );
+C_ASSERT( sizeof(struct get_socket_shm_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_socket_info_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_socket_info_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_socket_info_reply, family) == 8 );
@@ -1467,6 +1479,10 @@ C_ASSERT( sizeof(struct init_atom_table_reply) == 16 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
+C_ASSERT( sizeof(struct get_queue_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_queue_shm_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_queue_shm_reply, index) == 12 );
+C_ASSERT( sizeof(struct get_queue_shm_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_mask_request, wake_mask) == 12 );
@@ -1506,6 +1522,19 @@ C_ASSERT( FIELD_OFFSET(struct send_hardware_message_reply, prev_y) == 16 );
 C_ASSERT( FIELD_OFFSET(struct send_hardware_message_reply, new_x) == 20 );
 C_ASSERT( FIELD_OFFSET(struct send_hardware_message_reply, new_y) == 24 );
 C_ASSERT( sizeof(struct send_hardware_message_reply) == 32 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_request, win) == 12 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_request, flags) == 16 );
+C_ASSERT( sizeof(struct send_hardware_messages_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, count) == 8 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, wait) == 12 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, queued) == 16 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, merged) == 20 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, dropped) == 24 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, prev_x) == 28 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, prev_y) == 32 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, new_x) == 36 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, new_y) == 40 );
+C_ASSERT( sizeof(struct send_hardware_messages_reply) == 48 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, flags) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, get_win) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, get_first) == 20 );
@@ -178,6 +178,7 @@ static void sighup_callback(void)
 {
 #ifdef DEBUG_OBJECTS
     dump_objects();
+    dump_object_pools();
 #endif
 }
 
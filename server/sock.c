@@ -22,6 +22,7 @@
  */
 
 #include "config.h"
+#include "wine/port.h"
 
 #include <assert.h>
 #include <fcntl.h>
@@ -117,8 +118,33 @@ struct sock
     struct async_queue *ifchange_q;  /* queue for interface change notifications */
     struct object      *ifchange_obj; /* the interface change notification object */
     struct list         ifchange_entry; /* entry in ifchange notification list */
+    struct list         shm_refs;    /* entries in the shared states of the processes using it */
 };
 
+#define SOCK_SHM_COUNT 1024  /* max number of sockets with a shared state per process */
+
+/* shared states of the sockets used by a process, only ever mapped by that process */
+struct sock_shm_block
+{
+    struct mapping *mapping;                 /* mapping holding the shared socket states */
+    sock_shm_t     *entries;                 /* server view of the mapping */
+    unsigned int    refcount;                /* one for the process and one per allocated entry */
+    int             dead;                    /* process is gone, entries are freed on the next update */
+    unsigned int    count;                   /* number of entries handed out so far */
+    int             free_list;               /* first free entry, chained through next */
+    int             next[SOCK_SHM_COUNT];
+};
+
+/* entry of a socket in the shared states of one process */
+struct sock_shm_ref
+{
+    struct list             entry;           /* entry in the socket shm_refs list */
+    struct sock_shm_block  *block;           /* shared states block holding the entry */
+    int                     index;           /* index of the entry in the block */
+};
+
+static int sock_shm_disabled;  /* set once creating a shared mapping failed */
+
 static void sock_dump( struct object *obj, int verbose );
 static int sock_signaled( struct object *obj, struct wait_queue_entry *entry );
 static struct fd *sock_get_fd( struct object *obj );
@@ -604,6 +630,104 @@ static void sock_reselect_async( struct fd *fd, struct async_queue *queue )
         sock_reselect( sock );
 }
 
+static void release_sock_shm_block( struct sock_shm_block *block )
+{
+    if (--block->refcount) return;
+    release_shared_mapping( block->mapping, (void *)block->entries );
+    free( block );
+}
+
+static void free_sock_shm_ref( struct sock_shm_ref *ref )
+{
+    struct sock_shm_block *block = ref->block;
+
+    block->next[ref->index] = block->free_list;
+    block->free_list = ref->index;
+    list_remove( &ref->entry );
+    free( ref );
+    release_sock_shm_block( block );
+}
+
+/* free the shared socket states of a process, the sockets may still hold references to them */
+void free_process_sock_shm( struct process *process )
+{
+    if (!process->sock_shm) return;
+    process->sock_shm->dead = 1;
+    release_sock_shm_block( process->sock_shm );
+    process->sock_shm = NULL;
+}
+
+/* publish the socket state to the clients, must be called after every change of the
+ * non-blocking flag or of the event mask, which are the only fields clients rely on */
+static void sock_update_shm( struct sock *sock )
+{
+    struct sock_shm_ref *ref, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( ref, next, &sock->shm_refs, struct sock_shm_ref, entry )
+    {
+        sock_shm_t *shm = &ref->block->entries[ref->index];
+
+        if (ref->block->dead)
+        {
+            free_sock_shm_ref( ref );
+            continue;
+        }
+        /* same protocol as the shared queue states */
+        interlocked_xchg_add( (int *)&shm->seq, 1 );
+        shm->state = sock->state;
+        shm->mask  = sock->mask;
+        interlocked_xchg_add( (int *)&shm->seq, 1 );
+    }
+}
+
+/* get the entry of a socket in the shared states of a process, allocating it if needed;
+ * sockets without one always go through the server */
+static struct sock_shm_ref *get_sock_shm_ref( struct sock *sock, struct process *process )
+{
+    struct sock_shm_block *block = process->sock_shm;
+    struct sock_shm_ref *ref;
+    int index;
+
+    if (block)
+    {
+        LIST_FOR_EACH_ENTRY( ref, &sock->shm_refs, struct sock_shm_ref, entry )
+            if (ref->block == block) return ref;
+    }
+    else
+    {
+        if (sock_shm_disabled || !(block = mem_alloc( sizeof(*block) ))) return NULL;
+        if (!(block->mapping = create_shared_mapping( SOCK_SHM_COUNT * sizeof(sock_shm_t),
+                                                      (void **)&block->entries )))
+        {
+            /* don't try again for every socket */
+            sock_shm_disabled = 1;
+            free( block );
+            return NULL;
+        }
+        block->refcount  = 1;
+        block->dead      = 0;
+        block->count     = 0;
+        block->free_list = -1;
+        process->sock_shm = block;
+    }
+
+    if (block->free_list != -1) index = block->free_list;
+    else if (block->count < SOCK_SHM_COUNT) index = block->count;
+    else return NULL;
+
+    if (!(ref = mem_alloc( sizeof(*ref) ))) return NULL;
+    if (index == block->free_list) block->free_list = block->next[index];
+    else block->count++;
+
+    block->refcount++;
+    ref->block = block;
+    ref->index = index;
+    list_add_tail( &sock->shm_refs, &ref->entry );
+    block->entries[index].seq = 0;
+    sock_update_shm( sock );
+    return ref;
+}
+
 static struct fd *sock_get_fd( struct object *obj )
 {
     struct sock *sock = (struct sock *)obj;
@@ -625,6 +749,8 @@ static void sock_destroy( struct object *obj )
     async_wake_up( sock->ifchange_q, STATUS_CANCELLED );
     sock_destroy_ifchange_q( sock );
     if (sock->event) release_object( sock->event );
+    while (!list_empty( &sock->shm_refs ))
+        free_sock_shm_ref( LIST_ENTRY( list_head( &sock->shm_refs ), struct sock_shm_ref, entry ));
     if (sock->fd)
     {
         /* shut the socket down to force pending poll() calls in the client to return */
@@ -653,6 +779,7 @@ static void init_sock(struct sock *sock)
     sock->write_q = NULL;
     sock->ifchange_q = NULL;
     sock->ifchange_obj = NULL;
+    list_init( &sock->shm_refs );
     memset( sock->errors, 0, sizeof(sock->errors) );
 }
 
@@ -1247,6 +1374,9 @@ DECL_HANDLER(set_socket_event)
     if (!(sock = (struct sock *)get_handle_obj( current->process, req->handle,
                                                 FILE_WRITE_ATTRIBUTES, &sock_ops))) return;
     old_event = sock->event;
+    /* clients don't re-enable events while none are selected, so the
+     * level-triggered ones may be stale; the next poll will report them again */
+    if (!sock->mask) sock->pmask &= ~(FD_READ | FD_WRITE | FD_OOB);
     sock->mask    = req->mask;
     sock->hmask   &= ~req->mask; /* re-enable held events */
     sock->event   = NULL;
@@ -1260,6 +1390,7 @@ DECL_HANDLER(set_socket_event)
     sock_reselect( sock );
 
     sock->state |= FD_WINE_NONBLOCKING;
+    sock_update_shm( sock );
 
     /* if a network event is pending, signal the event object
        it is possible that FD_CONNECT or FD_ACCEPT network events has happened
@@ -1312,6 +1443,25 @@ DECL_HANDLER(get_socket_event)
     release_object( &sock->obj );
 }
 
+/* get the shared memory state of a socket */
+DECL_HANDLER(get_socket_shm)
+{
+    struct sock *sock;
+    struct sock_shm_ref *ref;
+
+    if (!(sock = (struct sock *)get_handle_obj( current->process, req->handle,
+                                                FILE_READ_ATTRIBUTES, &sock_ops ))) return;
+    if ((ref = get_sock_shm_ref( sock, current->process )))
+    {
+        reply->index = ref->index;
+        if (req->map)
+            reply->mapping = alloc_handle( current->process, ref->block->mapping,
+                                           SECTION_MAP_READ | SECTION_QUERY, 0 );
+    }
+    else set_error( STATUS_NO_MEMORY );
+    release_object( &sock->obj );
+}
+
 /* re-enable pending socket events */
 DECL_HANDLER(enable_socket_event)
 {
@@ -1328,6 +1478,7 @@ DECL_HANDLER(enable_socket_event)
     sock->state |= req->sstate;
     sock->state &= ~req->cstate;
     if ( sock->type != SOCK_STREAM ) sock->state &= ~STREAM_FLAG_MASK;
+    if ((req->sstate | req->cstate) & FD_WINE_NONBLOCKING) sock_update_shm( sock );
 
     sock_reselect( sock );
 